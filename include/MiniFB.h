@@ -35,8 +35,83 @@ mfb_update_state    mfb_update(struct mfb_window *window, void *buffer);
 
 mfb_update_state    mfb_update_ex(struct mfb_window *window, void *buffer, unsigned width, unsigned height);
 
+// Input buffer format for mfb_update / mfb_update_ex (FORMAT_ARGB8888 by default)
+// With FORMAT_RGBA32F the buffer holds 4 floats per pixel and is tone mapped to 32-bit once per update
+// Returns false (and changes nothing) for an unknown format, or for another format while the window has a mailbox
+bool                mfb_set_input_format(struct mfb_window *window, mfb_input_format format);
+mfb_input_format    mfb_get_input_format(struct mfb_window *window);
+// exposure is in stops (0 => x1). gamma <= 0 uses the default (2.2). Returns false (and changes nothing) for an unknown mode
+bool                mfb_set_tone_mapping(struct mfb_window *window, mfb_tone_mapping mode, float exposure, float gamma);
+// Scaling filter, run on the GPU by the OpenGL backends (GL 3.3; the fixed function fallback only has nearest and bilinear).
+// Vulkan and X11 with XRender have nearest and bilinear (sharp and area use bilinear); the other backends always use nearest.
+// Returns false (and changes nothing) for an unknown filter
+bool                mfb_set_scale_filter(struct mfb_window *window, mfb_scale_filter filter);
+mfb_scale_filter    mfb_get_scale_filter(struct mfb_window *window);
+
+// Skip the present when the buffer has the same content as the last presented one (hashed on every update). Off by default
+void                mfb_set_skip_identical_frames(struct mfb_window *window, bool enable);
+void                mfb_get_frame_stats(struct mfb_window *window, mfb_frame_stats *stats);
+
+// Asynchronous present (0 frames in flight => disabled, the default)
+// mfb_update_async queues the buffer and returns; a presenter thread puts it on screen.
+// It only blocks when max_frames_in_flight frames are already queued.
+// The buffer must not be modified until its fence is reached or the present callback is called for it.
+// Returns false if the backend cannot present from another thread (mfb_update_async then presents synchronously).
+bool                mfb_set_async_present(struct mfb_window *window, unsigned max_frames_in_flight);
+mfb_update_state    mfb_update_async(struct mfb_window *window, void *buffer, unsigned width, unsigned height);
+uint64_t            mfb_get_present_fence(struct mfb_window *window);                  // Fence of the last queued frame
+bool                mfb_wait_present_fence(struct mfb_window *window, uint64_t fence);  // Blocks until that frame is on screen
+
+// Triple buffer mailbox, to render from another thread while this one owns the window
+// The library owns three buffers of the given size (in the current input format, that can't change while the mailbox exists).
+// Producer thread: draw into mfb_get_mailbox_buffer and call mfb_publish_mailbox, which returns the buffer to draw next.
+// Window thread: mfb_update_mailbox presents the newest published frame; older unshown frames are dropped.
+// No locks nor copies are involved.
+// The producer only uses the mailbox, never the window. Once the window is destroyed the mailbox is closed,
+// its buffers stay valid until the producer calls mfb_destroy_mailbox.
+struct mfb_mailbox * mfb_create_mailbox(struct mfb_window *window, unsigned width, unsigned height);
+void *              mfb_get_mailbox_buffer(struct mfb_mailbox *mailbox);
+void *              mfb_publish_mailbox(struct mfb_mailbox *mailbox);
+bool                mfb_is_mailbox_closed(struct mfb_mailbox *mailbox);
+void                mfb_destroy_mailbox(struct mfb_mailbox *mailbox);
+mfb_update_state    mfb_update_mailbox(struct mfb_window *window);
+
+// Input thread: the display connection is read on its own thread, so input is not delayed by slow frames.
+// Input events (keyboard, char input, mouse, active) are then queued with a timestamp instead of calling their callbacks,
+// and read in batches with mfb_poll_events. Resize and close still go through the callbacks in mfb_update_*.
+// Returns false if the backend does not support it (X11 and Wayland do)
+bool                mfb_set_input_thread(struct mfb_window *window, bool enable);
+// Returns the number of events copied (0 if there are none or the input thread is off)
+unsigned            mfb_poll_events(struct mfb_window *window, mfb_event *events, unsigned max);
+
+// Timestamps of the input event being handled (call it from a callback) or of the last one read
+// native_time: display server time in milliseconds (0 if unknown). receive_time: seconds, same clock as mfb_timer
+void                mfb_get_event_time(struct mfb_window *window, uint32_t *native_time, double *receive_time);
+// Time from the arrival of the first input event after a present to the end of the next present (X11 and Wayland)
+void                mfb_get_input_latency(struct mfb_window *window, mfb_latency_stats *stats);
+void                mfb_reset_input_latency(struct mfb_window *window);
+
+// Event classes to receive (mfb_event_mask flags, EVENT_MASK_ALL by default).
+// The display server stops sending the others (X11: XSelectInput, Wayland: only the needed seat devices are requested)
+// Returns false if the backend keeps receiving everything
+bool                mfb_set_event_mask(struct mfb_window *window, unsigned mask);
+unsigned            mfb_get_event_mask(struct mfb_window *window);
+// Coalesce the mouse moves read in the same update into the last position (X11). Off by default
+void                mfb_set_motion_compression(struct mfb_window *window, bool enable);
+// Events read from the display and dispatched by the last update that read any (X11)
+void                mfb_get_event_counts(struct mfb_window *window, unsigned *read, unsigned *dispatched);
+
+// Raw relative mouse motion at the device rate (X11: XInput2 XI_RawMotion, Wayland: zwp_relative_pointer_v1).
+// Returns false if the display server doesn't support it
+bool                mfb_set_raw_motion(struct mfb_window *window, bool enable);
+// Copies up to max queued motions, oldest first. Poll every frame: when the queue is full new motions are dropped
+unsigned            mfb_poll_raw_motion(struct mfb_window *window, mfb_raw_motion *events, unsigned max);
+
 // Only updates the window events
 mfb_update_state    mfb_update_events(struct mfb_window *window);
+// Updates the events of every open window in one pass (the windows share one display connection).
+// Closed windows are still released by their own mfb_update*. Returns STATE_EXIT when all of them are closed
+mfb_update_state    mfb_update_events_all(void);
 
 // Close the window
 void                mfb_close(struct mfb_window *window);
@@ -65,11 +140,19 @@ void                mfb_set_char_input_callback(struct mfb_window *window, mfb_c
 void                mfb_set_mouse_button_callback(struct mfb_window *window, mfb_mouse_button_func callback);
 void                mfb_set_mouse_move_callback(struct mfb_window *window, mfb_mouse_move_func callback);
 void                mfb_set_mouse_scroll_callback(struct mfb_window *window, mfb_mouse_scroll_func callback);
+// Called once the buffer has been presented. With async present it runs on the presenter thread
+void                mfb_set_present_callback(struct mfb_window *window, mfb_present_func callback);
+// Called when the window gets minimized, unmapped or fully covered, and when it can be seen again (X11 and Wayland)
+void                mfb_set_visibility_callback(struct mfb_window *window, mfb_visibility_func callback);
+
+// While the window can't be seen, mfb_update_ex only updates the events and mfb_wait_sync waits at a low idle rate. Off by default
+void                mfb_set_idle_when_hidden(struct mfb_window *window, bool enable);
 
 // Getters
 const char *        mfb_get_key_name(mfb_key key);
 
 bool                mfb_is_window_active(struct mfb_window *window);
+bool                mfb_is_window_visible(struct mfb_window *window);           // False if minimized, unmapped or fully covered
 unsigned            mfb_get_window_width(struct mfb_window *window);
 unsigned            mfb_get_window_height(struct mfb_window *window);
 int                 mfb_get_mouse_x(struct mfb_window *window);             // Last mouse pos X
@@ -80,10 +163,30 @@ const uint8_t *     mfb_get_mouse_button_buffer(struct mfb_window *window); // O
 const uint8_t *     mfb_get_key_buffer(struct mfb_window *window);          // One byte for every key. Press (1), Release 0.
 
 // FPS
+// The global target fps is the default for the windows without their own
 void                mfb_set_target_fps(uint32_t fps);
 unsigned            mfb_get_target_fps(void);
+void                mfb_set_window_target_fps(struct mfb_window *window, uint32_t fps);
+void                mfb_reset_window_target_fps(struct mfb_window *window);    // Back to the global target fps
+unsigned            mfb_get_window_target_fps(struct mfb_window *window);
+// True if the window is paced by the swap interval of its GL context (mfb_wait_sync then returns right away)
+bool                mfb_get_window_hardware_sync(struct mfb_window *window);
 bool                mfb_wait_sync(struct mfb_window *window);
 
+// Frame scheduler: drives several windows, each at its own rate, with one wait for all of them.
+// fps 0 uses the target fps of the window. Windows are removed when they are destroyed
+bool                mfb_scheduler_add(struct mfb_window *window, unsigned fps);
+void                mfb_scheduler_remove(struct mfb_window *window);
+// Sleeps (pumping the events of every window) until at least one window is due, and returns the due ones (up to max).
+// Closed windows are returned right away so they can be released by mfb_update*. Returns 0 if no window is scheduled
+unsigned            mfb_scheduler_wait(struct mfb_window **windows, unsigned max);
+
+// Backend
+// On Linux with USE_RUNTIME_BACKEND the probe times a few presents on each X11 path (OpenGL and XImage) when the
+// first window is opened and keeps the fastest. The result is cached per display. Call it before opening a window. Off by default
+void                mfb_set_backend_probe(bool enable);
+bool                mfb_get_backend_info(mfb_backend_info *info);
+
 // Timer
 struct mfb_timer *  mfb_timer_create(void);
 void                mfb_timer_destroy(struct mfb_timer *tmr);
@@ -22,6 +22,8 @@ void mfb_set_char_input_callback  (std::function<void(struct mfb_window *, unsig
 void mfb_set_mouse_button_callback(std::function<void(struct mfb_window *, mfb_mouse_button, mfb_key_mod, bool)> func, struct mfb_window *window);
 void mfb_set_mouse_move_callback  (std::function<void(struct mfb_window *, int, int)>                            func, struct mfb_window *window);
 void mfb_set_mouse_scroll_callback(std::function<void(struct mfb_window *, mfb_key_mod, float, float)>           func, struct mfb_window *window);
+void mfb_set_present_callback     (std::function<void(struct mfb_window *, void *)>                              func, struct mfb_window *window);
+void mfb_set_visibility_callback  (std::function<void(struct mfb_window *, bool)>                                func, struct mfb_window *window);
 //-------------------------------------
 
 //-------------------------------------
@@ -45,6 +47,12 @@ void mfb_set_mouse_move_callback(struct mfb_window *window, T *obj, void (T::*me
 
 template <class T>
 void mfb_set_mouse_scroll_callback(struct mfb_window *window, T *obj, void (T::*method)(struct mfb_window *, mfb_key_mod, float, float));
+
+template <class T>
+void mfb_set_present_callback(struct mfb_window *window, T *obj, void (T::*method)(struct mfb_window *, void *));
+
+template <class T>
+void mfb_set_visibility_callback(struct mfb_window *window, T *obj, void (T::*method)(struct mfb_window *, bool));
 //-------------------------------------
 
 //-------------------------------------
@@ -61,6 +69,8 @@ class mfb_stub {
     friend void mfb_set_mouse_button_callback(std::function<void(struct mfb_window *, mfb_mouse_button, mfb_key_mod, bool)> func, struct mfb_window *window);
     friend void mfb_set_mouse_move_callback  (std::function<void(struct mfb_window *, int, int)>                            func, struct mfb_window *window);
     friend void mfb_set_mouse_scroll_callback(std::function<void(struct mfb_window *, mfb_key_mod, float, float)>           func, struct mfb_window *window);
+    friend void mfb_set_present_callback     (std::function<void(struct mfb_window *, void *)>                              func, struct mfb_window *window);
+    friend void mfb_set_visibility_callback  (std::function<void(struct mfb_window *, bool)>                                func, struct mfb_window *window);
 
     template <class T>
     friend void mfb_set_active_callback(struct mfb_window *window, T *obj, void (T::*method)(struct mfb_window *, bool));
@@ -80,6 +90,10 @@ class mfb_stub {
     friend void mfb_set_mouse_move_callback(struct mfb_window *window, T *obj, void (T::*method)(struct mfb_window *, int, int));
     template <class T>
     friend void mfb_set_mouse_scroll_callback(struct mfb_window *window, T *obj, void (T::*method)(struct mfb_window *, mfb_key_mod, float, float));
+    template <class T>
+    friend void mfb_set_present_callback(struct mfb_window *window, T *obj, void (T::*method)(struct mfb_window *, void *));
+    template <class T>
+    friend void mfb_set_visibility_callback(struct mfb_window *window, T *obj, void (T::*method)(struct mfb_window *, bool));
 
     static mfb_stub *GetInstance(struct mfb_window *window);
 
@@ -91,6 +105,8 @@ class mfb_stub {
     static void mouse_btn_stub(struct mfb_window *window, mfb_mouse_button button, mfb_key_mod mod, bool isPressed);
     static void mouse_move_stub(struct mfb_window *window, int x, int y);
     static void scroll_stub(struct mfb_window *window, mfb_key_mod mod, float deltaX, float deltaY);
+    static void present_stub(struct mfb_window *window, void *buffer);
+    static void visibility_stub(struct mfb_window *window, bool isVisible);
 
     struct mfb_window                                                           *m_window;
     std::function<void(struct mfb_window *window, bool)>                        m_active;
@@ -101,6 +117,8 @@ class mfb_stub {
     std::function<void(struct mfb_window *window, mfb_mouse_button, mfb_key_mod, bool)>   m_mouse_btn;
     std::function<void(struct mfb_window *window, int, int)>                    m_mouse_move;
     std::function<void(struct mfb_window *window, mfb_key_mod, float, float)>   m_scroll;
+    std::function<void(struct mfb_window *window, void *)>                      m_present;
+    std::function<void(struct mfb_window *window, bool)>                        m_visibility;
 };
 
 //-------------------------------------
@@ -183,4 +201,24 @@ inline void mfb_set_mouse_scroll_callback(struct mfb_window *window, T *obj, voi
     mfb_set_mouse_scroll_callback(window, mfb_stub::scroll_stub);
 }
 
+//-------------------------------------
+template <class T>
+inline void mfb_set_present_callback(struct mfb_window *window, T *obj, void (T::*method)(struct mfb_window *window, void *)) {
+    using namespace std::placeholders;
+
+    mfb_stub    *stub = mfb_stub::GetInstance(window);
+    stub->m_present = std::bind(method, obj, _1, _2);
+    mfb_set_present_callback(window, mfb_stub::present_stub);
+}
+
+//-------------------------------------
+template <class T>
+inline void mfb_set_visibility_callback(struct mfb_window *window, T *obj, void (T::*method)(struct mfb_window *window, bool)) {
+    using namespace std::placeholders;
+
+    mfb_stub    *stub = mfb_stub::GetInstance(window);
+    stub->m_visibility = std::bind(method, obj, _1, _2);
+    mfb_set_visibility_callback(window, mfb_stub::visibility_stub);
+}
+
 #endif
@@ -168,11 +168,102 @@ typedef enum {
     WF_FULLSCREEN_DESKTOP = 0x04,
     WF_BORDERLESS         = 0x08,
     WF_ALWAYS_ON_TOP      = 0x10,
+    WF_FULLSCREEN_EXCLUSIVE = 0x20,     // With WF_FULLSCREEN: X11 switches to the video mode closest to the buffer size (XRandR)
 } mfb_window_flags;
 
+typedef enum {
+    FORMAT_ARGB8888      = 0,   // 32-bit packed pixels (default)
+    FORMAT_RGBA32F       = 1,   // 4 linear floats per pixel, tone mapped before presenting
+} mfb_input_format;
+
+typedef enum {
+    TONE_MAP_CLAMP       = 0,
+    TONE_MAP_REINHARD    = 1,
+} mfb_tone_mapping;
+
+// How the frame is scaled to the viewport (see mfb_set_scale_filter)
+typedef enum {
+    FILTER_NEAREST          = 0,    // Default
+    FILTER_BILINEAR         = 1,
+    FILTER_SHARP_BILINEAR   = 2,    // Nearest up to the integer scale, bilinear for the rest: sharp pixels that don't shimmer
+    FILTER_AREA             = 3,    // Each pixel gets the average of the area it covers: for downscales
+} mfb_scale_filter;
+
+typedef enum {
+    EVENT_ACTIVE         = 0,
+    EVENT_KEYBOARD       = 1,
+    EVENT_CHAR_INPUT     = 2,
+    EVENT_MOUSE_BUTTON   = 3,
+    EVENT_MOUSE_MOVE     = 4,
+    EVENT_MOUSE_SCROLL   = 5,
+} mfb_event_type;
+
+// Event classes a window subscribes to (see mfb_set_event_mask). Resize and close are always delivered
+typedef enum {
+    EVENT_MASK_KEYBOARD     = 0x01,     // Keys and char input
+    EVENT_MASK_MOUSE_BUTTON = 0x02,     // Buttons and wheel
+    EVENT_MASK_MOUSE_MOVE   = 0x04,
+    EVENT_MASK_FOCUS        = 0x08,     // Active
+    EVENT_MASK_ALL          = 0x0f,
+} mfb_event_mask;
+
+// Input event record (see mfb_poll_events)
+typedef struct {
+    double              time;           // Seconds (same clock as mfb_timer) when the event was read from the display
+    uint32_t            native_time;    // Display server timestamp in milliseconds (X11 / Wayland event time), 0 if unknown
+    mfb_event_type      type;
+    mfb_key_mod         mod;            // KEYBOARD, MOUSE_BUTTON, MOUSE_SCROLL
+    int32_t             code;           // KEYBOARD: mfb_key, CHAR_INPUT: code point, MOUSE_BUTTON: mfb_mouse_button
+    bool                is_pressed;     // KEYBOARD, MOUSE_BUTTON. ACTIVE: is active
+    int32_t             x;              // MOUSE_MOVE
+    int32_t             y;
+    float               delta_x;        // MOUSE_SCROLL
+    float               delta_y;
+} mfb_event;
+
+// Relative mouse motion straight from the device, no acceleration (see mfb_poll_raw_motion)
+typedef struct {
+    double              time;           // Seconds (same clock as mfb_timer) when the event was read from the display
+    uint64_t            native_time;    // Display server timestamp in microseconds
+    float               delta_x;        // Device units, with the sub-pixel part
+    float               delta_y;
+} mfb_raw_motion;
+
+// Input latency probe (see mfb_get_input_latency). Seconds
+typedef struct {
+    double              last;
+    double              min;
+    double              max;
+    double              average;
+    uint32_t            count;
+} mfb_latency_stats;
+
+// Frames given to mfb_update_ex (see mfb_set_skip_identical_frames)
+typedef struct {
+    uint64_t            presented;
+    uint64_t            skipped;        // Same content as the last presented one
+} mfb_frame_stats;
+
+// Backend used by the windows (see mfb_get_backend_info)
+#define MFB_MAX_BACKEND_TIMINGS     4
+
+typedef struct {
+    const char          *name;
+    double              present_ms;     // Average time of one present during the probe, < 0 if it failed
+} mfb_backend_timing;
+
+typedef struct {
+    const char          *backend;       // 0x0 until the first window is opened (run time selection)
+    bool                probed;         // Chosen by the startup probe, the timings are valid
+    bool                from_cache;     // The probe result was read from the cache instead of measured
+    uint32_t            num_timings;
+    mfb_backend_timing  timings[MFB_MAX_BACKEND_TIMINGS];
+} mfb_backend_info;
+
 // Opaque pointer
 struct mfb_window;
 struct mfb_timer;
+struct mfb_mailbox;
 
 // Event callbacks
 typedef void(*mfb_active_func)(struct mfb_window *window, bool isActive);
@@ -183,4 +274,6 @@ typedef void(*mfb_char_input_func)(struct mfb_window *window, unsigned int code)
 typedef void(*mfb_mouse_button_func)(struct mfb_window *window, mfb_mouse_button button, mfb_key_mod mod, bool isPressed);
 typedef void(*mfb_mouse_move_func)(struct mfb_window *window, int x, int y);
 typedef void(*mfb_mouse_scroll_func)(struct mfb_window *window, mfb_key_mod mod, float deltaX, float deltaY);
+typedef void(*mfb_present_func)(struct mfb_window *window, void *buffer);
+typedef void(*mfb_visibility_func)(struct mfb_window *window, bool isVisible);
 
@@ -0,0 +1,245 @@
+#include "MiniFB_internal.h"
+#include "MiniFB_thread.h"
+#include <stdlib.h>
+
+#define kMaxFramesInFlight  8
+
+//-------------------------------------
+typedef struct {
+    void        *buffer;
+    uint32_t    width;
+    uint32_t    height;
+} SPresentRequest;
+
+typedef struct {
+    SWindowData         *window_data;
+    mfb_thread_t        thread;
+    mfb_mutex_t         mutex;          // queue, fences and state
+    mfb_cond_t          cond_work;      // presenter waits for frames
+    mfb_cond_t          cond_done;      // producers wait for a free slot or a fence
+    mfb_mutex_t         present_mutex;  // held while a frame is presented
+    SPresentRequest     queue[kMaxFramesInFlight];
+    uint32_t            head;
+    uint32_t            count;
+    uint32_t            max_in_flight;
+    mfb_update_state    state;          // first error since the last mfb_update_async
+    bool                quit;
+} SAsyncPresent;
+
+//-------------------------------------
+static void
+presenter_thread(void *param) {
+    SAsyncPresent   *async       = (SAsyncPresent *) param;
+    SWindowData     *window_data = async->window_data;
+    SPresentRequest request;
+    mfb_update_state state;
+
+    mutex_lock(&async->mutex);
+    while (true) {
+        // Pending frames are still presented when asked to quit
+        while (async->count == 0 && async->quit == false) {
+            cond_wait(&async->cond_work, &async->mutex);
+        }
+        if (async->count == 0) {
+            break;
+        }
+        request = async->queue[async->head];
+        mutex_unlock(&async->mutex);
+
+        mutex_lock(&async->present_mutex);
+        state = window_data->present_frame(window_data, request.buffer, request.width, request.height);
+        mutex_unlock(&async->present_mutex);
+        kCall(present_func, request.buffer);
+
+        mutex_lock(&async->mutex);
+        async->head = (async->head + 1) % kMaxFramesInFlight;
+        --async->count;
+        ++window_data->present_completed;
+        if (state != STATE_OK && async->state == STATE_OK) {
+            async->state = state;
+        }
+        cond_broadcast(&async->cond_done);
+    }
+    mutex_unlock(&async->mutex);
+
+    // Leave the context free for whoever presents next
+    if (window_data->release_context != 0x0) {
+        window_data->release_context(window_data);
+    }
+}
+
+//-------------------------------------
+static void
+free_async_present(SAsyncPresent *async) {
+    cond_destroy(&async->cond_done);
+    cond_destroy(&async->cond_work);
+    mutex_destroy(&async->present_mutex);
+    mutex_destroy(&async->mutex);
+    free(async);
+}
+
+//-------------------------------------
+void
+stop_async_present(SWindowData *window_data) {
+    SAsyncPresent *async = (SAsyncPresent *) window_data->async_present;
+    if (async == 0x0) {
+        return;
+    }
+
+    mutex_lock(&async->mutex);
+    async->quit = true;
+    cond_signal(&async->cond_work);
+    mutex_unlock(&async->mutex);
+
+    thread_join(async->thread);
+    window_data->async_present = 0x0;
+    free_async_present(async);
+}
+
+//-------------------------------------
+void
+lock_present(SWindowData *window_data) {
+    SAsyncPresent *async = (SAsyncPresent *) window_data->async_present;
+    if (async != 0x0) {
+        mutex_lock(&async->present_mutex);
+    }
+}
+
+//-------------------------------------
+void
+unlock_present(SWindowData *window_data) {
+    SAsyncPresent *async = (SAsyncPresent *) window_data->async_present;
+    if (async != 0x0) {
+        mutex_unlock(&async->present_mutex);
+    }
+}
+
+//-------------------------------------
+bool
+mfb_set_async_present(struct mfb_window *window, unsigned max_frames_in_flight) {
+    if (window == 0x0) {
+        return false;
+    }
+
+    SWindowData *window_data = (SWindowData *) window;
+    stop_async_present(window_data);
+    if (max_frames_in_flight == 0) {
+        return true;
+    }
+    if (window_data->present_frame == 0x0) {
+        return false;
+    }
+    if (max_frames_in_flight > kMaxFramesInFlight) {
+        max_frames_in_flight = kMaxFramesInFlight;
+    }
+
+    SAsyncPresent *async = (SAsyncPresent *) calloc(1, sizeof(SAsyncPresent));
+    if (async == 0x0) {
+        return false;
+    }
+    async->window_data   = window_data;
+    async->max_in_flight = max_frames_in_flight;
+    async->state         = STATE_OK;
+    mutex_init(&async->mutex);
+    mutex_init(&async->present_mutex);
+    cond_init(&async->cond_work);
+    cond_init(&async->cond_done);
+
+    // The calling thread may own the context (ex: after a synchronous update)
+    if (window_data->release_context != 0x0) {
+        window_data->release_context(window_data);
+    }
+
+    if (thread_create(&async->thread, presenter_thread, async) == false) {
+        free_async_present(async);
+        return false;
+    }
+    window_data->async_present = async;
+
+    return true;
+}
+
+//-------------------------------------
+mfb_update_state
+mfb_update_async(struct mfb_window *window, void *buffer, unsigned width, unsigned height) {
+    if (window == 0x0) {
+        return STATE_INVALID_WINDOW;
+    }
+
+    SWindowData     *window_data = (SWindowData *) window;
+    SAsyncPresent   *async       = (SAsyncPresent *) window_data->async_present;
+    mfb_update_state state;
+
+    if (async == 0x0 || window_data->close) {
+        // No presenter: the frame is on screen when this returns
+        state = mfb_update_ex(window, buffer, width, height);
+        if (state == STATE_OK) {
+            ++window_data->present_fence;
+            ++window_data->present_completed;
+            kCall(present_func, buffer);
+        }
+        return state;
+    }
+
+    if (buffer == 0x0) {
+        return STATE_INVALID_BUFFER;
+    }
+
+    mutex_lock(&async->mutex);
+    while (async->count >= async->max_in_flight) {
+        cond_wait(&async->cond_done, &async->mutex);
+    }
+    SPresentRequest *request = &async->queue[(async->head + async->count) % kMaxFramesInFlight];
+    request->buffer = buffer;
+    request->width  = width;
+    request->height = height;
+    ++async->count;
+    ++window_data->present_fence;
+    state = async->state;
+    async->state = STATE_OK;
+    cond_signal(&async->cond_work);
+    mutex_unlock(&async->mutex);
+
+    if (state != STATE_OK) {
+        return state;
+    }
+
+    return mfb_update_events(window);
+}
+
+//-------------------------------------
+uint64_t
+mfb_get_present_fence(struct mfb_window *window) {
+    if (window == 0x0) {
+        return 0;
+    }
+
+    SWindowData *window_data = (SWindowData *) window;
+    return window_data->present_fence;
+}
+
+//-------------------------------------
+bool
+mfb_wait_present_fence(struct mfb_window *window, uint64_t fence) {
+    if (window == 0x0) {
+        return false;
+    }
+
+    SWindowData     *window_data = (SWindowData *) window;
+    SAsyncPresent   *async       = (SAsyncPresent *) window_data->async_present;
+    bool            reached;
+
+    if (async == 0x0) {
+        return window_data->present_completed >= fence;
+    }
+
+    mutex_lock(&async->mutex);
+    // A fence never queued would never be reached
+    while (window_data->present_completed < fence && fence <= window_data->present_fence) {
+        cond_wait(&async->cond_done, &async->mutex);
+    }
+    reached = window_data->present_completed >= fence;
+    mutex_unlock(&async->mutex);
+
+    return reached;
+}
@@ -1,6 +1,8 @@
 #include <MiniFB.h>
 #include "WindowData.h"
 #include "MiniFB_internal.h"
+#include <stdlib.h>
+#include <string.h>
 
 //-------------------------------------
 short int g_keycodes[512] = { 0 };
@@ -96,6 +98,33 @@ mfb_set_mouse_scroll_callback(struct mfb_window *window, mfb_mouse_scroll_func c
     }
 }
 
+//-------------------------------------
+void
+mfb_set_present_callback(struct mfb_window *window, mfb_present_func callback) {
+    if(window != 0x0) {
+        SWindowData *window_data = (SWindowData *) window;
+        window_data->present_func = callback;
+    }
+}
+
+//-------------------------------------
+void
+mfb_set_visibility_callback(struct mfb_window *window, mfb_visibility_func callback) {
+    if(window != 0x0) {
+        SWindowData *window_data = (SWindowData *) window;
+        window_data->visibility_func = callback;
+    }
+}
+
+//-------------------------------------
+void
+mfb_set_idle_when_hidden(struct mfb_window *window, bool enable) {
+    if(window != 0x0) {
+        SWindowData *window_data = (SWindowData *) window;
+        window_data->idle_when_hidden = enable;
+    }
+}
+
 //-------------------------------------
 void
 mfb_set_user_data(struct mfb_window *window, void *user_data) {
@@ -116,6 +145,82 @@ mfb_get_user_data(struct mfb_window *window) {
     return 0x0;
 }
 
+//-------------------------------------
+bool
+mfb_set_input_format(struct mfb_window *window, mfb_input_format format) {
+    if(window != 0x0) {
+        SWindowData *window_data = (SWindowData *) window;
+        if (format != FORMAT_ARGB8888 && format != FORMAT_RGBA32F) {
+            return false;
+        }
+        // The mailbox buffers are sized for the format it was created with
+        if (window_data->mailbox != 0x0 && format != window_data->input_format) {
+            return false;
+        }
+        window_data->input_format = format;
+        return true;
+    }
+
+    return false;
+}
+
+//-------------------------------------
+mfb_input_format
+mfb_get_input_format(struct mfb_window *window) {
+    if(window != 0x0) {
+        SWindowData *window_data = (SWindowData *) window;
+        return window_data->input_format;
+    }
+
+    return FORMAT_ARGB8888;
+}
+
+//-------------------------------------
+bool
+mfb_set_tone_mapping(struct mfb_window *window, mfb_tone_mapping mode, float exposure, float gamma) {
+    if(window != 0x0) {
+        SWindowData *window_data = (SWindowData *) window;
+        if (mode != TONE_MAP_CLAMP && mode != TONE_MAP_REINHARD) {
+            return false;
+        }
+        window_data->tone_mapping  = mode;
+        window_data->tone_exposure = exposure;
+        window_data->tone_gamma    = gamma;
+        // Same buffer, different colors
+        window_data->frame_hash_valid = false;
+        return true;
+    }
+
+    return false;
+}
+
+//-------------------------------------
+bool
+mfb_set_scale_filter(struct mfb_window *window, mfb_scale_filter filter) {
+    if(window != 0x0) {
+        SWindowData *window_data = (SWindowData *) window;
+        if ((unsigned) filter > FILTER_AREA) {
+            return false;
+        }
+        window_data->scale_filter     = filter;
+        window_data->frame_hash_valid = false;
+        return true;
+    }
+
+    return false;
+}
+
+//-------------------------------------
+mfb_scale_filter
+mfb_get_scale_filter(struct mfb_window *window) {
+    if(window != 0x0) {
+        SWindowData *window_data = (SWindowData *) window;
+        return window_data->scale_filter;
+    }
+
+    return FILTER_NEAREST;
+}
+
 // [Deprecated]
 //-------------------------------------
 void
@@ -132,6 +237,32 @@ mfb_close(struct mfb_window *window) {
     }
 }
 
+// Frees the resources owned by the platform independent part.
+// The backends call it right before releasing window_data.
+//-------------------------------------
+void
+destroy_window_data_common(SWindowData *window_data) {
+    if(window_data == 0x0)
+        return;
+
+    // Backends with worker threads must have stopped them before releasing their own resources
+    stop_input_thread(window_data);
+    stop_async_present(window_data);
+    destroy_mailbox(window_data);
+    destroy_raw_motion(window_data);
+    mfb_scheduler_remove((struct mfb_window *) window_data);
+
+    if(window_data->convert_buffer != 0x0) {
+        free(window_data->convert_buffer);
+        window_data->convert_buffer      = 0x0;
+        window_data->convert_buffer_size = 0;
+    }
+    if(window_data->tone_lut != 0x0) {
+        free(window_data->tone_lut);
+        window_data->tone_lut = 0x0;
+    }
+}
+
 //-------------------------------------
 void
 keyboard_default(struct mfb_window *window, mfb_key key, mfb_key_mod mod, bool isPressed) {
@@ -184,6 +315,16 @@ mfb_is_window_active(struct mfb_window *window) {
     return false;
 }
 
+//-------------------------------------
+bool
+mfb_is_window_visible(struct mfb_window *window) {
+    if(window != 0x0) {
+        SWindowData *window_data = (SWindowData *) window;
+        return window_data->is_hidden == false;
+    }
+    return false;
+}
+
 //-------------------------------------
 unsigned
 mfb_get_window_width(struct mfb_window *window) {
@@ -636,3 +777,55 @@ mfb_get_key_name(mfb_key key) {
 
     return "Unknown";
 }
+
+// With USE_RUNTIME_BACKEND the backend is chosen by src/linux/LinuxMiniFB.c, otherwise at build time
+#if !defined(USE_RUNTIME_BACKEND)
+
+#if defined(_WIN32) || defined(WIN32)
+    #if defined(USE_OPENGL_API)
+        #define kBackendName    "windows-gl"
+    #else
+        #define kBackendName    "windows-gdi"
+    #endif
+#elif defined(__APPLE__)
+    #include <TargetConditionals.h>
+    #if TARGET_OS_IPHONE
+        #define kBackendName    "ios-metal"
+    #elif defined(USE_METAL_API)
+        #define kBackendName    "macos-metal"
+    #else
+        #define kBackendName    "macos-cg"
+    #endif
+#elif defined(__ANDROID__)
+    #define kBackendName        "android"
+#elif defined(__EMSCRIPTEN__)
+    #define kBackendName        "web"
+#elif defined(USE_WAYLAND_API) && defined(USE_OPENGL_API)
+    #define kBackendName        "wayland-gl"
+#elif defined(USE_WAYLAND_API)
+    #define kBackendName        "wayland"
+#elif defined(USE_OPENGL_API)
+    #define kBackendName        "x11-gl"
+#else
+    #define kBackendName        "x11"
+#endif
+
+//-------------------------------------
+void
+mfb_set_backend_probe(bool enable) {
+    kUnused(enable);
+}
+
+//-------------------------------------
+bool
+mfb_get_backend_info(mfb_backend_info *info) {
+    if (info == 0x0) {
+        return false;
+    }
+
+    memset(info, 0, sizeof(mfb_backend_info));
+    info->backend = kBackendName;
+    return true;
+}
+
+#endif
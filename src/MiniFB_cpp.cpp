@@ -90,6 +90,20 @@ mfb_stub::scroll_stub(struct mfb_window *window, mfb_key_mod mod, float deltaX,
     stub->m_scroll(window, mod, deltaX, deltaY);
 }
 
+//-------------------------------------
+void
+mfb_stub::present_stub(struct mfb_window *window, void *buffer) {
+    mfb_stub    *stub = mfb_stub::GetInstance(window);
+    stub->m_present(window, buffer);
+}
+
+//-------------------------------------
+void
+mfb_stub::visibility_stub(struct mfb_window *window, bool isVisible) {
+    mfb_stub    *stub = mfb_stub::GetInstance(window);
+    stub->m_visibility(window, isVisible);
+}
+
 //-------------------------------------
 
 //-------------------------------------
@@ -171,3 +185,23 @@ mfb_set_mouse_scroll_callback(std::function<void(struct mfb_window *, mfb_key_mo
     stub->m_scroll = std::bind(func, _1, _2, _3, _4);
     mfb_set_mouse_scroll_callback(window, mfb_stub::scroll_stub);
 }
+
+//-------------------------------------
+void
+mfb_set_present_callback(std::function<void(struct mfb_window *, void *)> func, struct mfb_window *window) {
+    using namespace std::placeholders;
+
+    mfb_stub    *stub = mfb_stub::GetInstance(window);
+    stub->m_present = std::bind(func, _1, _2);
+    mfb_set_present_callback(window, mfb_stub::present_stub);
+}
+
+//-------------------------------------
+void
+mfb_set_visibility_callback(std::function<void(struct mfb_window *, bool)> func, struct mfb_window *window) {
+    using namespace std::placeholders;
+
+    mfb_stub    *stub = mfb_stub::GetInstance(window);
+    stub->m_visibility = std::bind(func, _1, _2);
+    mfb_set_visibility_callback(window, mfb_stub::visibility_stub);
+}
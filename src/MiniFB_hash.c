@@ -0,0 +1,180 @@
+#include "MiniFB_internal.h"
+#include <string.h>
+
+#if defined(__SSE2__) || defined(_M_X64)
+    #define kUseSSE2
+    #include <emmintrin.h>
+#endif
+
+// XXH3 style: 8 lanes of 64 bits accumulate (data ^ key).lo32 * (data ^ key).hi32 plus the data of the neighbour lane.
+// The keys change every stripe so that moving blocks around changes the hash. Not a stable format: only compared in memory
+#define kStripeSize         64
+#define kStripesPerBlock    16
+#define kPrime32            0x9E3779B1u
+#define kPrime64_1          0x9E3779B185EBCA87ull
+#define kPrime64_2          0xC2B2AE3D27D4EB4Full
+#define kPrime64_3          0x165667B19E3779F9ull
+
+//-------------------------------------
+static const uint64_t s_keys[8] = {
+    0xbe4ba423396cfeb8ull, 0x1cad21f72c81017cull, 0xdb979083e96dd4deull, 0x1f67b3b7a4a44072ull,
+    0x78e5c0cc4ee679cbull, 0x2172ffcc7dd05a82ull, 0x8e2443f7744608b8ull, 0x4c263a81e69035e0ull,
+};
+
+//-------------------------------------
+static inline uint64_t
+read64(const uint8_t *p) {
+    uint64_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+//-------------------------------------
+static inline uint64_t
+avalanche(uint64_t h) {
+    h ^= h >> 33;
+    h *= kPrime64_2;
+    h ^= h >> 29;
+    h *= kPrime64_3;
+    h ^= h >> 32;
+    return h;
+}
+
+//-------------------------------------
+static void
+accumulate_scalar(uint64_t *acc, const uint8_t *data, size_t stripes) {
+    uint64_t keys[8];
+
+    memcpy(keys, s_keys, sizeof(keys));
+    for (size_t s = 0; s < stripes; ++s, data += kStripeSize) {
+        for (int i = 0; i < 8; ++i) {
+            uint64_t d = read64(data + i * 8);
+            uint64_t k = d ^ keys[i];
+            acc[i ^ 1] += d;
+            acc[i]     += (k & 0xffffffffu) * (k >> 32);
+            keys[i]    += kPrime64_1;
+        }
+        // Keeps the high bits moving
+        if ((s + 1) % kStripesPerBlock == 0) {
+            for (int i = 0; i < 8; ++i) {
+                acc[i] = (acc[i] ^ (acc[i] >> 47)) * kPrime32;
+            }
+        }
+    }
+}
+
+#if defined(kUseSSE2)
+
+// Same results as accumulate_scalar
+//-------------------------------------
+static void
+accumulate_sse2(uint64_t *acc, const uint8_t *data, size_t stripes) {
+    const __m128i   step   = _mm_set1_epi64x((long long) kPrime64_1);
+    const __m128i   prime  = _mm_set1_epi32((int) kPrime32);
+    __m128i         a[4], keys[4];
+
+    for (int i = 0; i < 4; ++i) {
+        a[i]    = _mm_loadu_si128((const __m128i *) (acc + i * 2));
+        keys[i] = _mm_loadu_si128((const __m128i *) (s_keys + i * 2));
+    }
+
+    for (size_t s = 0; s < stripes; ++s, data += kStripeSize) {
+        for (int i = 0; i < 4; ++i) {
+            __m128i d    = _mm_loadu_si128((const __m128i *) (data + i * 16));
+            __m128i k    = _mm_xor_si128(d, keys[i]);
+            __m128i prod = _mm_mul_epu32(k, _mm_shuffle_epi32(k, _MM_SHUFFLE(0, 3, 0, 1)));
+            __m128i swap = _mm_shuffle_epi32(d, _MM_SHUFFLE(1, 0, 3, 2));
+            a[i]    = _mm_add_epi64(a[i], _mm_add_epi64(prod, swap));
+            keys[i] = _mm_add_epi64(keys[i], step);
+        }
+        if ((s + 1) % kStripesPerBlock == 0) {
+            for (int i = 0; i < 4; ++i) {
+                __m128i x  = _mm_xor_si128(a[i], _mm_srli_epi64(a[i], 47));
+                __m128i lo = _mm_mul_epu32(x, prime);
+                __m128i hi = _mm_mul_epu32(_mm_srli_epi64(x, 32), prime);
+                a[i] = _mm_add_epi64(lo, _mm_slli_epi64(hi, 32));
+            }
+        }
+    }
+
+    for (int i = 0; i < 4; ++i) {
+        _mm_storeu_si128((__m128i *) (acc + i * 2), a[i]);
+    }
+}
+
+#endif
+
+//-------------------------------------
+static uint64_t
+hash_buffer(const void *buffer, size_t size, uint64_t seed) {
+    const uint8_t   *data    = (const uint8_t *) buffer;
+    size_t          stripes  = size / kStripeSize;
+    uint64_t        acc[8]   = { kPrime32, kPrime64_1, kPrime64_2, kPrime64_3, seed, kPrime64_2 ^ seed, kPrime64_1 ^ seed, kPrime32 ^ seed };
+    uint64_t        h        = seed ^ (size * kPrime64_1);
+
+#if defined(kUseSSE2)
+    accumulate_sse2(acc, data, stripes);
+#else
+    accumulate_scalar(acc, data, stripes);
+#endif
+    data += stripes * kStripeSize;
+    size -= stripes * kStripeSize;
+
+    for (; size >= 8; size -= 8, data += 8) {
+        h = (h ^ avalanche(read64(data))) * kPrime64_1;
+    }
+    for (; size > 0; --size, ++data) {
+        h = (h ^ *data) * kPrime64_3;
+    }
+
+    for (int i = 0; i < 8; ++i) {
+        h = (h ^ avalanche(acc[i] + s_keys[i])) * kPrime64_1;
+    }
+
+    return avalanche(h);
+}
+
+//-------------------------------------
+void
+mfb_set_skip_identical_frames(struct mfb_window *window, bool enable) {
+    if(window != 0x0) {
+        SWindowData *window_data = (SWindowData *) window;
+        window_data->skip_identical_frames = enable;
+        window_data->frame_hash_valid      = false;
+    }
+}
+
+//-------------------------------------
+void
+mfb_get_frame_stats(struct mfb_window *window, mfb_frame_stats *stats) {
+    if(stats == 0x0) {
+        return;
+    }
+
+    if(window != 0x0) {
+        *stats = ((SWindowData *) window)->frame_stats;
+    }
+    else {
+        memset(stats, 0, sizeof(mfb_frame_stats));
+    }
+}
+
+//-------------------------------------
+bool
+is_same_frame(SWindowData *window_data, const void *buffer, uint32_t width, uint32_t height) {
+    if (window_data->skip_identical_frames) {
+        size_t      pixel_size = window_data->input_format == FORMAT_RGBA32F ? 4 * sizeof(float) : sizeof(uint32_t);
+        uint64_t    seed       = ((uint64_t) width << 32) ^ height ^ ((uint64_t) window_data->input_format << 60);
+        uint64_t    hash       = hash_buffer(buffer, (size_t) width * height * pixel_size, seed);
+
+        if (window_data->frame_hash_valid && window_data->frame_hash == hash) {
+            ++window_data->frame_stats.skipped;
+            return true;
+        }
+        window_data->frame_hash       = hash;
+        window_data->frame_hash_valid = true;
+    }
+
+    ++window_data->frame_stats.presented;
+    return false;
+}
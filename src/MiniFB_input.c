@@ -0,0 +1,428 @@
+#include "MiniFB_internal.h"
+#include "MiniFB_thread.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define kEventQueueSize     1024    // Power of two
+#define kInputTimeout       10      // ms. Bounds how long stopping the thread can take
+#define kRawMotionQueueSize 1024    // Power of two. ~1s of a 1000 Hz mouse
+
+//-------------------------------------
+// Single producer (input thread) / single consumer (mfb_poll_events) ring.
+// head and tail only grow; the difference is the number of queued events.
+typedef struct {
+    mfb_event       events[kEventQueueSize];
+    uint32_t        head;
+    uint32_t        tail;
+} SEventQueue;
+
+typedef struct {
+    SEventQueue     queue;
+    SWindowData     *window_data;
+    mfb_thread_t    thread;
+    uint32_t        quit;
+} SInputThread;
+
+// Same ring for the raw motions. The producer is whoever reads the display
+typedef struct {
+    mfb_raw_motion  events[kRawMotionQueueSize];
+    uint32_t        head;
+    uint32_t        tail;
+} SRawMotionQueue;
+
+extern double       g_timer_resolution;
+extern uint64_t     mfb_timer_tick(void);
+
+//-------------------------------------
+static mfb_event *
+begin_event(SWindowData *window_data, mfb_event_type type) {
+    SInputThread    *input = (SInputThread *) window_data->input_thread;
+    uint32_t        head   = input->queue.head;
+
+    // Full: the newest events are dropped rather than overwriting unread ones
+    if (head - atomic_load_u32(&input->queue.tail) >= kEventQueueSize) {
+        return 0x0;
+    }
+
+    mfb_event *event = &input->queue.events[head & (kEventQueueSize - 1)];
+    memset(event, 0, sizeof(mfb_event));
+    event->time        = (double) window_data->event_receive_tick * g_timer_resolution;
+    event->native_time = window_data->event_native_time;
+    event->type        = type;
+
+    return event;
+}
+
+//-------------------------------------
+static void
+end_event(SWindowData *window_data) {
+    SInputThread *input = (SInputThread *) window_data->input_thread;
+    atomic_store_u32(&input->queue.head, input->queue.head + 1);
+}
+
+//-------------------------------------
+void
+record_event_time(SWindowData *window_data, uint32_t native_time) {
+    uint64_t now = mfb_timer_tick();
+
+    window_data->event_native_time  = native_time;
+    window_data->event_receive_tick = now;
+    // Only the first event since the last present starts the measure
+    atomic_cas_u64(&window_data->latency_start_tick, 0, now);
+}
+
+//-------------------------------------
+void
+record_present(SWindowData *window_data) {
+    uint64_t start = atomic_exchange_u64(&window_data->latency_start_tick, 0);
+    if (start == 0) {
+        return;
+    }
+
+    mfb_latency_stats *latency = &window_data->latency;
+    latency->last = (double) (mfb_timer_tick() - start) * g_timer_resolution;
+    if (latency->count == 0 || latency->last < latency->min)
+        latency->min = latency->last;
+    if (latency->last > latency->max)
+        latency->max = latency->last;
+    window_data->latency_sum += latency->last;
+    ++latency->count;
+    latency->average = window_data->latency_sum / latency->count;
+}
+
+//-------------------------------------
+void
+mfb_get_event_time(struct mfb_window *window, uint32_t *native_time, double *receive_time) {
+    SWindowData *window_data = (SWindowData *) window;
+
+    if (native_time != 0x0) {
+        *native_time = window_data != 0x0 ? window_data->event_native_time : 0;
+    }
+    if (receive_time != 0x0) {
+        *receive_time = window_data != 0x0 ? (double) window_data->event_receive_tick * g_timer_resolution : 0.0;
+    }
+}
+
+//-------------------------------------
+void
+mfb_get_input_latency(struct mfb_window *window, mfb_latency_stats *stats) {
+    if (window != 0x0 && stats != 0x0) {
+        SWindowData *window_data = (SWindowData *) window;
+        *stats = window_data->latency;
+    }
+}
+
+//-------------------------------------
+void
+mfb_reset_input_latency(struct mfb_window *window) {
+    if (window != 0x0) {
+        SWindowData *window_data = (SWindowData *) window;
+        memset(&window_data->latency, 0, sizeof(window_data->latency));
+        window_data->latency_sum = 0.0;
+    }
+}
+
+//-------------------------------------
+bool
+mfb_set_event_mask(struct mfb_window *window, unsigned mask) {
+    if (window == 0x0) {
+        return false;
+    }
+
+    SWindowData *window_data = (SWindowData *) window;
+    window_data->disabled_events = EVENT_MASK_ALL & ~mask;
+    if (window_data->apply_event_mask == 0x0) {
+        return false;
+    }
+
+    // Backends may destroy objects the input thread dispatches
+    bool restart = (window_data->input_thread != 0x0);
+    stop_input_thread(window_data);
+    window_data->apply_event_mask(window_data);
+    if (restart) {
+        mfb_set_input_thread(window, true);
+    }
+
+    return true;
+}
+
+//-------------------------------------
+unsigned
+mfb_get_event_mask(struct mfb_window *window) {
+    if (window == 0x0) {
+        return 0;
+    }
+
+    SWindowData *window_data = (SWindowData *) window;
+    return EVENT_MASK_ALL & ~window_data->disabled_events;
+}
+
+//-------------------------------------
+void
+mfb_set_motion_compression(struct mfb_window *window, bool enable) {
+    if (window != 0x0) {
+        SWindowData *window_data = (SWindowData *) window;
+        window_data->compress_motion = enable;
+    }
+}
+
+//-------------------------------------
+void
+mfb_get_event_counts(struct mfb_window *window, unsigned *read, unsigned *dispatched) {
+    SWindowData *window_data = (SWindowData *) window;
+
+    if (read != 0x0) {
+        *read = window_data != 0x0 ? window_data->events_read : 0;
+    }
+    if (dispatched != 0x0) {
+        *dispatched = window_data != 0x0 ? window_data->events_dispatched : 0;
+    }
+}
+
+//-------------------------------------
+void
+queue_active(SWindowData *window_data, bool is_active) {
+    mfb_event *event = begin_event(window_data, EVENT_ACTIVE);
+    if (event != 0x0) {
+        event->is_pressed = is_active;
+        end_event(window_data);
+    }
+}
+
+//-------------------------------------
+void
+queue_keyboard(SWindowData *window_data, mfb_key key, mfb_key_mod mod, bool is_pressed) {
+    mfb_event *event = begin_event(window_data, EVENT_KEYBOARD);
+    if (event != 0x0) {
+        event->code       = key;
+        event->mod        = mod;
+        event->is_pressed = is_pressed;
+        end_event(window_data);
+    }
+}
+
+//-------------------------------------
+void
+queue_char_input(SWindowData *window_data, unsigned int code) {
+    mfb_event *event = begin_event(window_data, EVENT_CHAR_INPUT);
+    if (event != 0x0) {
+        event->code = (int32_t) code;
+        end_event(window_data);
+    }
+}
+
+//-------------------------------------
+void
+queue_mouse_btn(SWindowData *window_data, mfb_mouse_button button, mfb_key_mod mod, bool is_pressed) {
+    mfb_event *event = begin_event(window_data, EVENT_MOUSE_BUTTON);
+    if (event != 0x0) {
+        event->code       = button;
+        event->mod        = mod;
+        event->is_pressed = is_pressed;
+        end_event(window_data);
+    }
+}
+
+//-------------------------------------
+void
+queue_mouse_move(SWindowData *window_data, int x, int y) {
+    mfb_event *event = begin_event(window_data, EVENT_MOUSE_MOVE);
+    if (event != 0x0) {
+        event->x = x;
+        event->y = y;
+        end_event(window_data);
+    }
+}
+
+//-------------------------------------
+void
+queue_mouse_wheel(SWindowData *window_data, mfb_key_mod mod, float delta_x, float delta_y) {
+    mfb_event *event = begin_event(window_data, EVENT_MOUSE_SCROLL);
+    if (event != 0x0) {
+        event->mod     = mod;
+        event->delta_x = delta_x;
+        event->delta_y = delta_y;
+        end_event(window_data);
+    }
+}
+
+//-------------------------------------
+void
+queue_raw_motion(SWindowData *window_data, uint64_t native_time, float delta_x, float delta_y) {
+    SRawMotionQueue *queue = (SRawMotionQueue *) window_data->raw_motion;
+    if (queue == 0x0) {
+        return;
+    }
+
+    uint32_t head = queue->head;
+    if (head - atomic_load_u32(&queue->tail) >= kRawMotionQueueSize) {
+        return;
+    }
+
+    mfb_raw_motion *event = &queue->events[head & (kRawMotionQueueSize - 1)];
+    event->time        = (double) mfb_timer_tick() * g_timer_resolution;
+    event->native_time = native_time;
+    event->delta_x     = delta_x;
+    event->delta_y     = delta_y;
+    atomic_store_u32(&queue->head, head + 1);
+}
+
+//-------------------------------------
+void
+destroy_raw_motion(SWindowData *window_data) {
+    free(window_data->raw_motion);
+    window_data->raw_motion = 0x0;
+}
+
+//-------------------------------------
+static void
+input_thread(void *param) {
+    SInputThread *input = (SInputThread *) param;
+
+    while (atomic_load_u32(&input->quit) == 0) {
+        input->window_data->pump_input(input->window_data, kInputTimeout);
+    }
+}
+
+//-------------------------------------
+void
+stop_input_thread(SWindowData *window_data) {
+    SInputThread *input = (SInputThread *) window_data->input_thread;
+    if (input == 0x0) {
+        return;
+    }
+
+    atomic_store_u32(&input->quit, 1);
+    thread_join(input->thread);
+    // Callbacks again from here on
+    window_data->input_thread = 0x0;
+    if (window_data->setup_input_thread != 0x0) {
+        window_data->setup_input_thread(window_data, false);
+    }
+    free(input);
+}
+
+//-------------------------------------
+bool
+mfb_set_input_thread(struct mfb_window *window, bool enable) {
+    if (window == 0x0) {
+        return false;
+    }
+
+    SWindowData *window_data = (SWindowData *) window;
+    if (enable == false) {
+        stop_input_thread(window_data);
+        return true;
+    }
+    if (window_data->input_thread != 0x0) {
+        return true;
+    }
+    if (window_data->pump_input == 0x0) {
+        return false;
+    }
+
+    SInputThread *input = (SInputThread *) calloc(1, sizeof(SInputThread));
+    if (input == 0x0) {
+        return false;
+    }
+    input->window_data = window_data;
+
+    if (window_data->setup_input_thread != 0x0 && window_data->setup_input_thread(window_data, true) == false) {
+        free(input);
+        return false;
+    }
+
+    // Must be set before the thread starts so events are queued from the first one
+    window_data->input_thread = input;
+    if (thread_create(&input->thread, input_thread, input) == false) {
+        window_data->input_thread = 0x0;
+        if (window_data->setup_input_thread != 0x0) {
+            window_data->setup_input_thread(window_data, false);
+        }
+        free(input);
+        return false;
+    }
+
+    return true;
+}
+
+//-------------------------------------
+bool
+mfb_set_raw_motion(struct mfb_window *window, bool enable) {
+    if (window == 0x0) {
+        return false;
+    }
+
+    SWindowData *window_data = (SWindowData *) window;
+    if (window_data->setup_raw_motion == 0x0) {
+        return enable == false;
+    }
+
+    // The queue lives until the window is destroyed, so the reader never sees it go away
+    if (enable && window_data->raw_motion == 0x0) {
+        window_data->raw_motion = calloc(1, sizeof(SRawMotionQueue));
+        if (window_data->raw_motion == 0x0) {
+            return false;
+        }
+    }
+
+    // Backends may create or destroy objects the input thread dispatches
+    bool restart = (window_data->input_thread != 0x0);
+    stop_input_thread(window_data);
+    bool result = window_data->setup_raw_motion(window_data, enable);
+    if (restart) {
+        mfb_set_input_thread(window, true);
+    }
+
+    return result;
+}
+
+//-------------------------------------
+unsigned
+mfb_poll_raw_motion(struct mfb_window *window, mfb_raw_motion *events, unsigned max) {
+    if (window == 0x0 || events == 0x0) {
+        return 0;
+    }
+
+    SRawMotionQueue *queue = (SRawMotionQueue *) ((SWindowData *) window)->raw_motion;
+    if (queue == 0x0) {
+        return 0;
+    }
+
+    uint32_t tail  = queue->tail;
+    uint32_t count = atomic_load_u32(&queue->head) - tail;
+    if (count > max) {
+        count = max;
+    }
+    for (uint32_t i = 0; i < count; ++i) {
+        events[i] = queue->events[(tail + i) & (kRawMotionQueueSize - 1)];
+    }
+    atomic_store_u32(&queue->tail, tail + count);
+
+    return count;
+}
+
+//-------------------------------------
+unsigned
+mfb_poll_events(struct mfb_window *window, mfb_event *events, unsigned max) {
+    if (window == 0x0 || events == 0x0) {
+        return 0;
+    }
+
+    SInputThread *input = (SInputThread *) ((SWindowData *) window)->input_thread;
+    if (input == 0x0) {
+        return 0;
+    }
+
+    uint32_t tail  = input->queue.tail;
+    uint32_t count = atomic_load_u32(&input->queue.head) - tail;
+    if (count > max) {
+        count = max;
+    }
+    for (uint32_t i = 0; i < count; ++i) {
+        events[i] = input->queue.events[(tail + i) & (kEventQueueSize - 1)];
+    }
+    atomic_store_u32(&input->queue.tail, tail + count);
+
+    return count;
+}
@@ -92,6 +92,8 @@ calc_dst_factor(SWindowData *window_data, uint32_t width, uint32_t height) {
     }
     window_data->factor_y      = (float) window_data->dst_offset_y / (float) height;
     window_data->factor_height = (float) window_data->dst_height   / (float) height;
+    // The viewport changed: the next frame must be drawn even if it is the same
+    window_data->frame_hash_valid = false;
 }
 
 //-------------------------------------
@@ -101,13 +103,21 @@ resize_dst(SWindowData *window_data, uint32_t width, uint32_t height) {
     window_data->dst_offset_y = (uint32_t) (height * window_data->factor_y);
     window_data->dst_width    = (uint32_t) (width  * window_data->factor_width);
     window_data->dst_height   = (uint32_t) (height * window_data->factor_height);
+    window_data->frame_hash_valid = false;
 }
 
-#if !defined(USE_OPENGL_API) && !defined(USE_METAL_API)
-
 //-------------------------------------
 void
-set_target_fps_aux() {
+set_window_hidden(SWindowData *window_data, bool is_hidden) {
+    if (window_data->is_hidden != is_hidden) {
+        window_data->is_hidden = is_hidden;
+        window_data->frame_hash_valid = false;
+        kCall(visibility_func, !is_hidden);
+    }
 }
 
-#endif
+//-------------------------------------
+bool
+is_window_idle(SWindowData *window_data) {
+    return window_data->is_hidden && window_data->idle_when_hidden;
+}
@@ -5,6 +5,8 @@
 
 #define kCall(func, ...)    if(window_data && window_data->func) window_data->func((struct mfb_window *) window_data, __VA_ARGS__);
 #define kUnused(var)        (void) var;
+// Input events go to the event queue while the input thread runs, to their callback otherwise
+#define kEvent(name, ...)   if(window_data && window_data->input_thread) queue_##name(window_data, __VA_ARGS__); else kCall(name##_func, __VA_ARGS__)
 
 typedef struct mfb_timer {
     int64_t     start_time;
@@ -20,7 +22,43 @@ extern "C" {
 
     void calc_dst_factor(SWindowData *window_data, uint32_t width, uint32_t height);
     void resize_dst(SWindowData *window_data, uint32_t width, uint32_t height);
-    void set_target_fps_aux();
+    double get_time_for_frame(SWindowData *window_data);
+    // Backends report the visibility here (calls the callback on changes)
+    void set_window_hidden(SWindowData *window_data, bool is_hidden);
+    // Hidden and idle_when_hidden: don't present, wait at the idle rate
+    bool is_window_idle(SWindowData *window_data);
+    // Skip identical frames: true if the buffer has the same content as the last presented one
+    bool is_same_frame(SWindowData *window_data, const void *buffer, uint32_t width, uint32_t height);
+
+    // Returns the buffer as it is when it is not a float one, or when the backend tone maps on the GPU
+    void *convert_input_buffer(SWindowData *window_data, void *buffer, uint32_t width, uint32_t height);
+    // Exposure scale and 1 / gamma, for the shaders
+    void get_tone_mapping(SWindowData *window_data, float *scale, float *inv_gamma);
+    // FORMAT_RGBA32F frames scaled on the CPU: tone mapped by the scaling pass itself (nearest, like stretch_image)
+    bool tonemap_stretch_image(SWindowData *window_data, const void *buffer, uint32_t width, uint32_t height,
+                               uint32_t *dst, uint32_t dst_width, uint32_t dst_height, uint32_t dst_pitch);
+    void destroy_window_data_common(SWindowData *window_data);
+
+    // Async present. lock_present guards the state the presenter reads while the event pump changes it (no-op if async is off)
+    void stop_async_present(SWindowData *window_data);
+    void lock_present(SWindowData *window_data);
+    void unlock_present(SWindowData *window_data);
+
+    void destroy_mailbox(SWindowData *window_data);
+
+    void stop_input_thread(SWindowData *window_data);
+    // native_time: display server timestamp (ms). Call before the event is dispatched
+    void record_event_time(SWindowData *window_data, uint32_t native_time);
+    // Call once a frame has been presented (input latency probe)
+    void record_present(SWindowData *window_data);
+    void queue_active(SWindowData *window_data, bool is_active);
+    void queue_keyboard(SWindowData *window_data, mfb_key key, mfb_key_mod mod, bool is_pressed);
+    void queue_char_input(SWindowData *window_data, unsigned int code);
+    void queue_mouse_btn(SWindowData *window_data, mfb_mouse_button button, mfb_key_mod mod, bool is_pressed);
+    void queue_mouse_move(SWindowData *window_data, int x, int y);
+    void queue_mouse_wheel(SWindowData *window_data, mfb_key_mod mod, float delta_x, float delta_y);
+    void queue_raw_motion(SWindowData *window_data, uint64_t native_time, float delta_x, float delta_y);
+    void destroy_raw_motion(SWindowData *window_data);
 
 #if defined(__cplusplus)
 }
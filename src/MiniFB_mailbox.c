@@ -0,0 +1,156 @@
+#include "MiniFB_internal.h"
+#include "MiniFB_thread.h"
+#include <stdlib.h>
+
+// The producer owns 'back', the presenter owns 'front' and the published
+// frame sits in 'middle'. Publishing and taking are a single atomic exchange
+// of the middle slot, so nobody waits and a newer frame simply replaces an
+// older one that was not shown yet.
+#define kMailboxIndexMask   0x3
+#define kMailboxFresh       0x4
+
+//-------------------------------------
+typedef struct {
+    void            *buffers[3];
+    uint32_t        width;
+    uint32_t        height;
+    uint32_t        back;       // producer thread only
+    uint32_t        front;      // presenting thread only
+    uint32_t        middle;     // index | kMailboxFresh, shared
+    uint32_t        closed;     // set once the window let it go
+    uint32_t        ref_count;  // the window and the producer
+} SMailbox;
+
+//-------------------------------------
+static void
+release_mailbox(SMailbox *mailbox) {
+    if (atomic_decrement_u32(&mailbox->ref_count) > 0) {
+        return;
+    }
+
+    for (int i = 0; i < 3; ++i) {
+        free(mailbox->buffers[i]);
+    }
+    free(mailbox);
+}
+
+//-------------------------------------
+// The producer may still be drawing: it keeps the buffers until mfb_destroy_mailbox
+void
+destroy_mailbox(SWindowData *window_data) {
+    SMailbox *mailbox = (SMailbox *) window_data->mailbox;
+    if (mailbox == 0x0) {
+        return;
+    }
+
+    window_data->mailbox = 0x0;
+    atomic_store_u32(&mailbox->closed, 1);
+    release_mailbox(mailbox);
+}
+
+//-------------------------------------
+struct mfb_mailbox *
+mfb_create_mailbox(struct mfb_window *window, unsigned width, unsigned height) {
+    if (window == 0x0 || width == 0 || height == 0) {
+        return 0x0;
+    }
+
+    SWindowData *window_data = (SWindowData *) window;
+    destroy_mailbox(window_data);
+
+    SMailbox *mailbox = (SMailbox *) calloc(1, sizeof(SMailbox));
+    if (mailbox == 0x0) {
+        return 0x0;
+    }
+
+    mailbox->ref_count = 1;
+    size_t size = (size_t) width * height * (window_data->input_format == FORMAT_RGBA32F ? 16 : 4);
+    for (int i = 0; i < 3; ++i) {
+        mailbox->buffers[i] = calloc(1, size);
+        if (mailbox->buffers[i] == 0x0) {
+            release_mailbox(mailbox);
+            return 0x0;
+        }
+    }
+    mailbox->width     = width;
+    mailbox->height    = height;
+    mailbox->back      = 0;
+    mailbox->middle    = 1;
+    mailbox->front     = 2;
+    mailbox->ref_count = 2;
+    window_data->mailbox = mailbox;
+
+    return (struct mfb_mailbox *) mailbox;
+}
+
+//-------------------------------------
+void
+mfb_destroy_mailbox(struct mfb_mailbox *mailbox) {
+    if (mailbox == 0x0) {
+        return;
+    }
+
+    release_mailbox((SMailbox *) mailbox);
+}
+
+//-------------------------------------
+bool
+mfb_is_mailbox_closed(struct mfb_mailbox *mailbox) {
+    if (mailbox == 0x0) {
+        return true;
+    }
+
+    return atomic_load_u32(&((SMailbox *) mailbox)->closed) != 0;
+}
+
+//-------------------------------------
+void *
+mfb_get_mailbox_buffer(struct mfb_mailbox *mailbox) {
+    if (mailbox == 0x0) {
+        return 0x0;
+    }
+
+    SMailbox *data = (SMailbox *) mailbox;
+    return data->buffers[data->back];
+}
+
+//-------------------------------------
+// Still works once closed, nobody takes the frames anymore
+void *
+mfb_publish_mailbox(struct mfb_mailbox *mailbox) {
+    if (mailbox == 0x0) {
+        return 0x0;
+    }
+
+    SMailbox *data = (SMailbox *) mailbox;
+
+    // We get back either the stale unshown frame or the one the presenter released
+    uint32_t previous = atomic_exchange_u32(&data->middle, data->back | kMailboxFresh);
+    data->back = previous & kMailboxIndexMask;
+
+    return data->buffers[data->back];
+}
+
+//-------------------------------------
+mfb_update_state
+mfb_update_mailbox(struct mfb_window *window) {
+    if (window == 0x0) {
+        return STATE_INVALID_WINDOW;
+    }
+
+    SWindowData *window_data = (SWindowData *) window;
+    SMailbox    *mailbox     = (SMailbox *) window_data->mailbox;
+    if (mailbox == 0x0 || window_data->close) {
+        return mfb_update_events(window);
+    }
+
+    // Nothing new: don't present the same frame again
+    if ((atomic_load_u32(&mailbox->middle) & kMailboxFresh) == 0) {
+        return mfb_update_events(window);
+    }
+
+    uint32_t previous = atomic_exchange_u32(&mailbox->middle, mailbox->front);
+    mailbox->front = previous & kMailboxIndexMask;
+
+    return mfb_update_ex(window, mailbox->buffers[mailbox->front], mailbox->width, mailbox->height);
+}
@@ -0,0 +1,109 @@
+#include <MiniFB.h>
+#include "MiniFB_internal.h"
+#include "MiniFB_thread.h"
+#include "WindowData.h"
+
+// Same margin as mfb_wait_sync: a frame a bit early is better than one late
+#define kEarlyFactor        0.04
+// Below this we spin instead of sleeping, sleeps are not precise enough
+#define kSpinSeconds        0.002
+
+//-------------------------------------
+static SWindowData  *s_scheduled = 0x0;
+
+extern double       g_timer_frequency;
+extern double       g_timer_resolution;
+extern uint64_t     mfb_timer_tick(void);
+
+//-------------------------------------
+static uint64_t
+get_period(SWindowData *window_data) {
+    // Hidden windows go at the idle rate (mfb_set_idle_when_hidden) whatever their fps
+    double time_for_frame = window_data->scheduler_fps != 0 && is_window_idle(window_data) == false ? 1.0 / window_data->scheduler_fps : get_time_for_frame(window_data);
+    return (uint64_t) (time_for_frame * g_timer_frequency);
+}
+
+//-------------------------------------
+bool
+mfb_scheduler_add(struct mfb_window *window, unsigned fps) {
+    if (window == 0x0) {
+        return false;
+    }
+
+    SWindowData *window_data = (SWindowData *) window;
+    window_data->scheduler_fps = fps;
+    if (window_data->scheduled == false) {
+        // mfb_timer_create initializes the timer, so ticks are valid here
+        window_data->scheduler_due  = mfb_timer_tick();
+        window_data->scheduler_next = s_scheduled;
+        window_data->scheduled      = true;
+        s_scheduled = window_data;
+    }
+
+    return true;
+}
+
+//-------------------------------------
+void
+mfb_scheduler_remove(struct mfb_window *window) {
+    if (window == 0x0) {
+        return;
+    }
+
+    SWindowData *window_data = (SWindowData *) window;
+    if (window_data->scheduled == false) {
+        return;
+    }
+
+    for (SWindowData **link = &s_scheduled; *link != 0x0; link = &(*link)->scheduler_next) {
+        if (*link == window_data) {
+            *link = window_data->scheduler_next;
+            break;
+        }
+    }
+    window_data->scheduler_next = 0x0;
+    window_data->scheduled      = false;
+}
+
+//-------------------------------------
+unsigned
+mfb_scheduler_wait(struct mfb_window **windows, unsigned max) {
+    SWindowData *window_data;
+    uint64_t    now, period, next;
+    unsigned    count;
+
+    if (windows == 0x0 || max == 0) {
+        return 0;
+    }
+
+    while (s_scheduled != 0x0) {
+        now   = mfb_timer_tick();
+        next  = UINT64_MAX;
+        count = 0;
+        for (window_data = s_scheduled; window_data != 0x0; window_data = window_data->scheduler_next) {
+            period = get_period(window_data);
+            // Closed windows are due right away so their update releases them
+            if (window_data->close || now + (uint64_t) (period * kEarlyFactor) >= window_data->scheduler_due) {
+                if (count < max) {
+                    windows[count++] = (struct mfb_window *) window_data;
+                    window_data->scheduler_due += period;
+                    // Too late: start again from now instead of catching up with a burst
+                    if (window_data->scheduler_due < now) {
+                        window_data->scheduler_due = now + period;
+                    }
+                }
+            }
+            else if (window_data->scheduler_due < next) {
+                next = window_data->scheduler_due;
+            }
+        }
+        if (count > 0) {
+            return count;
+        }
+
+        thread_sleep_ms((next - now) * g_timer_resolution > kSpinSeconds ? 1 : 0);
+        mfb_update_events_all();
+    }
+
+    return 0;
+}
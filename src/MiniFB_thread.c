@@ -0,0 +1,167 @@
+#include "MiniFB_thread.h"
+#include <stdlib.h>
+#if !defined(_WIN32) && !defined(WIN32)
+    #include <unistd.h>
+    #include <sched.h>
+#endif
+#if defined(__EMSCRIPTEN__)
+    #include <emscripten.h>
+#endif
+
+//-------------------------------------
+typedef struct {
+    mfb_thread_func func;
+    void            *arg;
+} SThreadStart;
+
+#if defined(_WIN32) || defined(WIN32)
+
+//-------------------------------------
+static DWORD WINAPI
+thread_start(LPVOID param) {
+    SThreadStart start = *(SThreadStart *) param;
+    free(param);
+    start.func(start.arg);
+    return 0;
+}
+
+//-------------------------------------
+bool
+thread_create(mfb_thread_t *thread, mfb_thread_func func, void *arg) {
+    SThreadStart *start = (SThreadStart *) malloc(sizeof(SThreadStart));
+    if (start == 0x0) {
+        return false;
+    }
+    start->func = func;
+    start->arg  = arg;
+
+    *thread = CreateThread(0x0, 0, thread_start, start, 0, 0x0);
+    if (*thread == 0x0) {
+        free(start);
+        return false;
+    }
+
+    return true;
+}
+
+//-------------------------------------
+void
+thread_join(mfb_thread_t thread) {
+    WaitForSingleObject(thread, INFINITE);
+    CloseHandle(thread);
+}
+
+//-------------------------------------
+void mutex_init(mfb_mutex_t *mutex)                 { InitializeCriticalSection(mutex);               }
+void mutex_init_recursive(mfb_mutex_t *mutex)       { InitializeCriticalSection(mutex);               }
+void mutex_destroy(mfb_mutex_t *mutex)              { DeleteCriticalSection(mutex);                   }
+void mutex_lock(mfb_mutex_t *mutex)                 { EnterCriticalSection(mutex);                    }
+void mutex_unlock(mfb_mutex_t *mutex)               { LeaveCriticalSection(mutex);                    }
+
+void cond_init(mfb_cond_t *cond)                    { InitializeConditionVariable(cond);              }
+void cond_destroy(mfb_cond_t *cond)                 { (void) cond;                                    }
+void cond_wait(mfb_cond_t *cond, mfb_mutex_t *mutex){ SleepConditionVariableCS(cond, mutex, INFINITE); }
+void cond_signal(mfb_cond_t *cond)                  { WakeConditionVariable(cond);                    }
+void cond_broadcast(mfb_cond_t *cond)               { WakeAllConditionVariable(cond);                 }
+
+//-------------------------------------
+unsigned
+get_cpu_count(void) {
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return info.dwNumberOfProcessors > 0 ? (unsigned) info.dwNumberOfProcessors : 1;
+}
+
+//-------------------------------------
+void
+thread_sleep_ms(unsigned ms) {
+    Sleep(ms);
+}
+
+#else
+
+//-------------------------------------
+static void *
+thread_start(void *param) {
+    SThreadStart start = *(SThreadStart *) param;
+    free(param);
+    start.func(start.arg);
+    return 0x0;
+}
+
+//-------------------------------------
+bool
+thread_create(mfb_thread_t *thread, mfb_thread_func func, void *arg) {
+    SThreadStart *start = (SThreadStart *) malloc(sizeof(SThreadStart));
+    if (start == 0x0) {
+        return false;
+    }
+    start->func = func;
+    start->arg  = arg;
+
+    if (pthread_create(thread, 0x0, thread_start, start) != 0) {
+        free(start);
+        return false;
+    }
+
+    return true;
+}
+
+//-------------------------------------
+void
+thread_join(mfb_thread_t thread) {
+    pthread_join(thread, 0x0);
+}
+
+//-------------------------------------
+void mutex_init(mfb_mutex_t *mutex)                 { pthread_mutex_init(mutex, 0x0);   }
+void mutex_destroy(mfb_mutex_t *mutex)              { pthread_mutex_destroy(mutex);     }
+void mutex_lock(mfb_mutex_t *mutex)                 { pthread_mutex_lock(mutex);        }
+void mutex_unlock(mfb_mutex_t *mutex)               { pthread_mutex_unlock(mutex);      }
+
+void cond_init(mfb_cond_t *cond)                    { pthread_cond_init(cond, 0x0);     }
+void cond_destroy(mfb_cond_t *cond)                 { pthread_cond_destroy(cond);       }
+void cond_wait(mfb_cond_t *cond, mfb_mutex_t *mutex){ pthread_cond_wait(cond, mutex);   }
+void cond_signal(mfb_cond_t *cond)                  { pthread_cond_signal(cond);        }
+void cond_broadcast(mfb_cond_t *cond)               { pthread_cond_broadcast(cond);     }
+
+//-------------------------------------
+void
+mutex_init_recursive(mfb_mutex_t *mutex) {
+    pthread_mutexattr_t attributes;
+
+    pthread_mutexattr_init(&attributes);
+    pthread_mutexattr_settype(&attributes, PTHREAD_MUTEX_RECURSIVE);
+    pthread_mutex_init(mutex, &attributes);
+    pthread_mutexattr_destroy(&attributes);
+}
+
+//-------------------------------------
+unsigned
+get_cpu_count(void) {
+#if defined(_SC_NPROCESSORS_ONLN)
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    if (count > 0) {
+        return (unsigned) count;
+    }
+#endif
+    return 1;
+}
+
+//-------------------------------------
+void
+thread_sleep_ms(unsigned ms) {
+#if defined(__EMSCRIPTEN__)
+    // Needs ASYNCIFY, as mfb_wait_sync
+    emscripten_sleep(ms);
+#else
+    if (ms == 0) {
+        sched_yield();
+    }
+    else {
+        usleep(ms * 1000);
+    }
+#endif
+}
+
+#endif
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#if defined(_WIN32) || defined(WIN32)
+    #include <windows.h>
+    typedef HANDLE              mfb_thread_t;
+    typedef CRITICAL_SECTION    mfb_mutex_t;
+    typedef CONDITION_VARIABLE  mfb_cond_t;
+#else
+    #include <pthread.h>
+    typedef pthread_t           mfb_thread_t;
+    typedef pthread_mutex_t     mfb_mutex_t;
+    typedef pthread_cond_t      mfb_cond_t;
+#endif
+
+typedef void (*mfb_thread_func)(void *arg);
+
+// Used to hand buffers between threads without locks
+#if defined(_MSC_VER)
+    #define atomic_exchange_u32(ptr, value)     ((uint32_t) InterlockedExchange((volatile LONG *) (ptr), (LONG) (value)))
+    #define atomic_load_u32(ptr)                ((uint32_t) InterlockedCompareExchange((volatile LONG *) (ptr), 0, 0))
+    #define atomic_store_u32(ptr, value)        InterlockedExchange((volatile LONG *) (ptr), (LONG) (value))
+    #define atomic_decrement_u32(ptr)           ((uint32_t) InterlockedDecrement((volatile LONG *) (ptr)))
+    #define atomic_exchange_u64(ptr, value)     ((uint64_t) InterlockedExchange64((volatile LONG64 *) (ptr), (LONG64) (value)))
+    #define atomic_cas_u64(ptr, expected, value)    ((uint64_t) InterlockedCompareExchange64((volatile LONG64 *) (ptr), (LONG64) (value), (LONG64) (expected)))
+#else
+    #define atomic_exchange_u32(ptr, value)     __atomic_exchange_n((ptr), (value), __ATOMIC_ACQ_REL)
+    #define atomic_load_u32(ptr)                __atomic_load_n((ptr), __ATOMIC_ACQUIRE)
+    #define atomic_store_u32(ptr, value)        __atomic_store_n((ptr), (value), __ATOMIC_RELEASE)
+    // Returns the new value
+    #define atomic_decrement_u32(ptr)           __atomic_sub_fetch((ptr), 1, __ATOMIC_ACQ_REL)
+    #define atomic_exchange_u64(ptr, value)     __atomic_exchange_n((ptr), (value), __ATOMIC_ACQ_REL)
+    // Returns the previous value
+    #define atomic_cas_u64(ptr, expected, value)    __sync_val_compare_and_swap((ptr), (expected), (value))
+#endif
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+    // Returns false if the platform cannot spawn threads (ex: wasm without pthreads).
+    // Callers are expected to fall back to do the work on the calling thread.
+    bool        thread_create(mfb_thread_t *thread, mfb_thread_func func, void *arg);
+    void        thread_join(mfb_thread_t thread);
+
+    void        mutex_init(mfb_mutex_t *mutex);
+    // The thread that holds it can lock it again (and has to unlock it as many times)
+    void        mutex_init_recursive(mfb_mutex_t *mutex);
+    void        mutex_destroy(mfb_mutex_t *mutex);
+    void        mutex_lock(mfb_mutex_t *mutex);
+    void        mutex_unlock(mfb_mutex_t *mutex);
+
+    void        cond_init(mfb_cond_t *cond);
+    void        cond_destroy(mfb_cond_t *cond);
+    void        cond_wait(mfb_cond_t *cond, mfb_mutex_t *mutex);
+    void        cond_signal(mfb_cond_t *cond);
+    void        cond_broadcast(mfb_cond_t *cond);
+
+    unsigned    get_cpu_count(void);
+    // 0 just gives the rest of the time slice away
+    void        thread_sleep_ms(unsigned ms);
+
+#if defined(__cplusplus)
+}
+#endif
@@ -6,7 +6,9 @@
 double      g_timer_frequency;
 double      g_timer_resolution;
 double      g_time_for_frame = 1.0 / 60.0;
-bool        g_use_hardware_sync = false;
+
+// 10 fps while nothing can be seen (mfb_set_idle_when_hidden)
+#define kIdleTimeForFrame   0.1
 
 //-------------------------------------
 extern uint64_t mfb_timer_tick(void);
@@ -21,7 +23,7 @@ mfb_set_target_fps(uint32_t fps) {
     else {
         g_time_for_frame = 1.0 / fps;
     }
-    set_target_fps_aux();
+    // Each window applies it (swap interval, ...) on its next present
 }
 
 //-------------------------------------
@@ -35,6 +37,60 @@ mfb_get_target_fps() {
     }
 }
 
+//-------------------------------------
+void
+mfb_set_window_target_fps(struct mfb_window *window, uint32_t fps) {
+    if(window != 0x0) {
+        SWindowData *window_data = (SWindowData *) window;
+        window_data->time_for_frame = fps != 0 ? 1.0 / fps : 0;
+        window_data->has_target_fps = true;
+    }
+}
+
+//-------------------------------------
+void
+mfb_reset_window_target_fps(struct mfb_window *window) {
+    if(window != 0x0) {
+        SWindowData *window_data = (SWindowData *) window;
+        window_data->has_target_fps = false;
+    }
+}
+
+//-------------------------------------
+unsigned
+mfb_get_window_target_fps(struct mfb_window *window) {
+    if(window == 0x0) {
+        return mfb_get_target_fps();
+    }
+
+    double time_for_frame = get_time_for_frame((SWindowData *) window);
+    if (time_for_frame == 0) {
+        return 0;
+    }
+    else {
+        return (unsigned) (1.0 / time_for_frame);
+    }
+}
+
+//-------------------------------------
+bool
+mfb_get_window_hardware_sync(struct mfb_window *window) {
+    if(window == 0x0) {
+        return false;
+    }
+
+    return ((SWindowData *) window)->use_hardware_sync;
+}
+
+//-------------------------------------
+double
+get_time_for_frame(SWindowData *window_data) {
+    if (is_window_idle(window_data)) {
+        return kIdleTimeForFrame;
+    }
+    return window_data->has_target_fps ? window_data->time_for_frame : g_time_for_frame;
+}
+
 //-------------------------------------
 struct mfb_timer *
 mfb_timer_create() {
@@ -0,0 +1,434 @@
+#include "MiniFB_internal.h"
+#include "MiniFB_thread.h"
+#include <stdlib.h>
+#include <math.h>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+    #define kUseAVX2
+    #include <immintrin.h>
+    #if defined(_MSC_VER)
+        #include <intrin.h>
+        #define kTargetAVX2
+    #else
+        #define kTargetAVX2     __attribute__((target("avx2")))
+    #endif
+#endif
+
+#define kGammaLutSize       4096
+#define kDefaultGamma       2.2f
+// Below this size waking the workers costs more than it saves
+#define kMinPixelsForBands  (256 * 1024)
+#define kMaxBands           8
+
+//-------------------------------------
+typedef struct {
+    float           scale;
+    bool            reinhard;
+    const uint32_t  *lut;
+} STonemap;
+
+typedef void (*tonemap_row_func)(const float *src, uint32_t *dst, uint32_t width, const STonemap *tonemap);
+
+// Rows [y_begin, y_end) of the destination. When the sizes differ the band samples the
+// source like stretch_image (nearest), each source row it needs is tone mapped once into 'row'
+typedef struct {
+    const float         *src;
+    uint32_t            src_width;
+    uint32_t            src_height;
+    uint32_t            *dst;
+    uint32_t            dst_width;
+    uint32_t            dst_height;
+    uint32_t            dst_pitch;
+    uint32_t            *row;
+    uint32_t            y_begin;
+    uint32_t            y_end;
+    const STonemap      *tonemap;
+    tonemap_row_func    row_func;
+} SBand;
+
+// Workers kept for the life of the process: the bands of a frame are handed to them instead of
+// creating threads per frame. One frame at a time, a frame that finds it busy is converted on its own thread.
+typedef struct {
+    mfb_mutex_t         mutex;
+    mfb_cond_t          work;       // bands to take
+    mfb_cond_t          done;       // the last band was finished
+    SBand               *bands;
+    uint32_t            num_bands;
+    uint32_t            next_band;
+    uint32_t            pending;    // bands taken and not finished yet
+    uint32_t            num_threads;
+    bool                created;
+    uint32_t            busy;       // atomic: a frame owns the pool
+} SBandPool;
+
+static SBandPool s_pool;
+
+//-------------------------------------
+static void
+build_gamma_lut(uint32_t *lut, float gamma) {
+    double inv_gamma = 1.0 / gamma;
+    for (uint32_t i = 0; i < kGammaLutSize; ++i) {
+        double v = pow((double) i / (kGammaLutSize - 1), inv_gamma);
+        lut[i] = (uint32_t) (v * 255.0 + 0.5);
+    }
+}
+
+// Scalar reference. The AVX2 kernel must produce the same bits.
+//-------------------------------------
+static void
+tonemap_row_scalar(const float *src, uint32_t *dst, uint32_t width, const STonemap *tonemap) {
+    uint32_t c[3];
+
+    for (uint32_t x = 0; x < width; ++x) {
+        for (uint32_t i = 0; i < 3; ++i) {
+            float v = src[i] * tonemap->scale;
+            if (!(v > 0.0f))
+                v = 0.0f;
+            if (tonemap->reinhard)
+                v = v / (v + 1.0f);
+            // Reinhard gives NaN for +Inf (Inf / Inf): 1 like min_ps in the AVX2 kernel
+            if (!(v <= 1.0f))
+                v = 1.0f;
+            c[i] = tonemap->lut[(int32_t) (v * (float) (kGammaLutSize - 1) + 0.5f)];
+        }
+
+        // Alpha is not tone mapped
+        float a = src[3];
+        if (!(a > 0.0f))
+            a = 0.0f;
+        if (a > 1.0f)
+            a = 1.0f;
+
+        dst[x] = (((uint32_t) (int32_t) (a * 255.0f + 0.5f)) << 24) | (c[0] << 16) | (c[1] << 8) | c[2];
+        src += 4;
+    }
+}
+
+#if defined(kUseAVX2)
+
+//-------------------------------------
+static bool
+has_avx2(void) {
+#if defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 1);
+    // OSXSAVE + AVX
+    if ((info[2] & (1 << 27)) == 0 || (info[2] & (1 << 28)) == 0)
+        return false;
+    if ((_xgetbv(0) & 0x6) != 0x6)
+        return false;
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#else
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+#endif
+}
+
+// 8 pixels per iteration: 4 vectors holding 2 RGBA pixels each
+//-------------------------------------
+kTargetAVX2 static void
+tonemap_row_avx2(const float *src, uint32_t *dst, uint32_t width, const STonemap *tonemap) {
+    const __m256    scale     = _mm256_set1_ps(tonemap->scale);
+    const __m256    zero      = _mm256_setzero_ps();
+    const __m256    one       = _mm256_set1_ps(1.0f);
+    const __m256    half      = _mm256_set1_ps(0.5f);
+    const __m256    lut_scale = _mm256_set1_ps((float) (kGammaLutSize - 1));
+    const __m256    a_scale   = _mm256_set1_ps(255.0f);
+    // packus interleaves the 128-bit lanes: [p0 p2 p4 p6 | p1 p3 p5 p7]
+    const __m256i   order     = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+    // RGBA bytes -> BGRA bytes (0xAARRGGBB in little endian)
+    const __m256i   swizzle   = _mm256_setr_epi8(2, 1, 0, 3,  6, 5, 4, 7,  10, 9, 8, 11,  14, 13, 12, 15,
+                                                 2, 1, 0, 3,  6, 5, 4, 7,  10, 9, 8, 11,  14, 13, 12, 15);
+    const int       *lut      = (const int *) tonemap->lut;
+    uint32_t        x;
+
+    for (x = 0; x + 8 <= width; x += 8) {
+        __m256i c[4];
+
+        for (int i = 0; i < 4; ++i) {
+            __m256  v = _mm256_loadu_ps(src + i * 8);
+            __m256  a = _mm256_min_ps(_mm256_max_ps(v, zero), one);
+
+            // max_ps returns the second operand for NaN, so NaN -> 0 like the scalar path
+            v = _mm256_max_ps(_mm256_mul_ps(v, scale), zero);
+            if (tonemap->reinhard)
+                v = _mm256_div_ps(v, _mm256_add_ps(v, one));
+            v = _mm256_min_ps(v, one);
+
+            __m256i index = _mm256_cvttps_epi32(_mm256_add_ps(_mm256_mul_ps(v, lut_scale), half));
+            __m256i rgb   = _mm256_i32gather_epi32(lut, index, 4);
+            __m256i alpha = _mm256_cvttps_epi32(_mm256_add_ps(_mm256_mul_ps(a, a_scale), half));
+            c[i] = _mm256_blend_epi32(rgb, alpha, 0x88);
+        }
+
+        __m256i p01 = _mm256_packus_epi32(c[0], c[1]);
+        __m256i p23 = _mm256_packus_epi32(c[2], c[3]);
+        __m256i p   = _mm256_packus_epi16(p01, p23);
+        p = _mm256_permutevar8x32_epi32(p, order);
+        p = _mm256_shuffle_epi8(p, swizzle);
+        _mm256_storeu_si256((__m256i *) (dst + x), p);
+
+        src += 8 * 4;
+    }
+
+    tonemap_row_scalar(src, dst + x, width - x, tonemap);
+}
+
+#endif
+
+//-------------------------------------
+static tonemap_row_func
+get_row_func(void) {
+#if defined(kUseAVX2)
+    static int s_has_avx2 = -1;
+    if (s_has_avx2 < 0) {
+        s_has_avx2 = has_avx2();
+    }
+    if (s_has_avx2) {
+        return tonemap_row_avx2;
+    }
+#endif
+    return tonemap_row_scalar;
+}
+
+//-------------------------------------
+static void
+tonemap_band(SBand *band) {
+    if (band->dst_width == band->src_width && band->dst_height == band->src_height) {
+        for (uint32_t y = band->y_begin; y < band->y_end; ++y) {
+            band->row_func(band->src + (size_t) y * band->src_width * 4, band->dst + (size_t) y * band->dst_pitch, band->src_width, band->tonemap);
+        }
+        return;
+    }
+
+    // Same steps as stretch_image
+    const uint32_t  delta_x = (band->src_width  << 16) / band->dst_width;
+    const uint32_t  delta_y = (band->src_height << 16) / band->dst_height;
+    uint32_t        src_y   = ~0u;
+
+    for (uint32_t y = band->y_begin; y < band->y_end; ++y) {
+        uint32_t row_y = (uint32_t) (((uint64_t) y * delta_y) >> 16);
+        if (row_y != src_y) {
+            band->row_func(band->src + (size_t) row_y * band->src_width * 4, band->row, band->src_width, band->tonemap);
+            src_y = row_y;
+        }
+
+        uint32_t *dst      = band->dst + (size_t) y * band->dst_pitch;
+        uint32_t offset_x  = 0;
+        for (uint32_t x = 0; x < band->dst_width; ++x) {
+            dst[x]    = band->row[offset_x >> 16];
+            offset_x += delta_x;
+        }
+    }
+}
+
+//-------------------------------------
+static void
+pool_worker(void *param) {
+    kUnused(param);
+
+    mutex_lock(&s_pool.mutex);
+    for (;;) {
+        while (s_pool.next_band >= s_pool.num_bands) {
+            cond_wait(&s_pool.work, &s_pool.mutex);
+        }
+        SBand *band = &s_pool.bands[s_pool.next_band++];
+        ++s_pool.pending;
+        mutex_unlock(&s_pool.mutex);
+
+        tonemap_band(band);
+
+        mutex_lock(&s_pool.mutex);
+        if (--s_pool.pending == 0) {
+            cond_signal(&s_pool.done);
+        }
+    }
+}
+
+// Created by the first frame that needs it. false if another frame has it or there are no workers
+//-------------------------------------
+static bool
+acquire_pool(void) {
+    if (atomic_exchange_u32(&s_pool.busy, 1) != 0) {
+        return false;
+    }
+
+    if (s_pool.created == false) {
+        s_pool.created = true;
+        mutex_init(&s_pool.mutex);
+        cond_init(&s_pool.work);
+        cond_init(&s_pool.done);
+
+        unsigned count = get_cpu_count();
+        if (count > kMaxBands)
+            count = kMaxBands;
+        // The calling thread is the other one
+        for (unsigned i = 1; i < count; ++i) {
+            mfb_thread_t thread;
+            if (thread_create(&thread, pool_worker, 0x0) == false)
+                break;
+            ++s_pool.num_threads;
+        }
+    }
+
+    if (s_pool.num_threads == 0) {
+        atomic_store_u32(&s_pool.busy, 0);
+        return false;
+    }
+    return true;
+}
+
+// The calling thread takes bands too, until there are none left
+//-------------------------------------
+static void
+run_bands(SBand *bands, uint32_t num_bands) {
+    if (num_bands < 2 || acquire_pool() == false) {
+        for (uint32_t i = 0; i < num_bands; ++i) {
+            tonemap_band(&bands[i]);
+        }
+        return;
+    }
+
+    mutex_lock(&s_pool.mutex);
+    s_pool.bands     = bands;
+    s_pool.num_bands = num_bands;
+    s_pool.next_band = 0;
+    s_pool.pending   = 0;
+    cond_broadcast(&s_pool.work);
+    while (s_pool.next_band < s_pool.num_bands) {
+        SBand *band = &s_pool.bands[s_pool.next_band++];
+        ++s_pool.pending;
+        mutex_unlock(&s_pool.mutex);
+
+        tonemap_band(band);
+
+        mutex_lock(&s_pool.mutex);
+        --s_pool.pending;
+    }
+    while (s_pool.pending > 0) {
+        cond_wait(&s_pool.done, &s_pool.mutex);
+    }
+    s_pool.bands     = 0x0;
+    s_pool.num_bands = 0;
+    s_pool.next_band = 0;
+    mutex_unlock(&s_pool.mutex);
+
+    atomic_store_u32(&s_pool.busy, 0);
+}
+
+//-------------------------------------
+void
+get_tone_mapping(SWindowData *window_data, float *scale, float *inv_gamma) {
+    *scale     = powf(2.0f, window_data->tone_exposure);
+    *inv_gamma = 1.0f / (window_data->tone_gamma > 0.0f ? window_data->tone_gamma : kDefaultGamma);
+}
+
+//-------------------------------------
+static bool
+setup_tonemap(SWindowData *window_data, STonemap *tonemap) {
+    float gamma = window_data->tone_gamma > 0.0f ? window_data->tone_gamma : kDefaultGamma;
+    if (window_data->tone_lut == 0x0 || window_data->tone_lut_gamma != gamma) {
+        if (window_data->tone_lut == 0x0) {
+            window_data->tone_lut = (uint32_t *) malloc(kGammaLutSize * sizeof(uint32_t));
+            if (window_data->tone_lut == 0x0) {
+                return false;
+            }
+        }
+        build_gamma_lut(window_data->tone_lut, gamma);
+        window_data->tone_lut_gamma = gamma;
+    }
+
+    tonemap->scale    = powf(2.0f, window_data->tone_exposure);
+    tonemap->reinhard = (window_data->tone_mapping == TONE_MAP_REINHARD);
+    tonemap->lut      = window_data->tone_lut;
+    return true;
+}
+
+//-------------------------------------
+static uint32_t
+get_num_bands(uint32_t width, uint32_t height) {
+    uint32_t num_bands = 1;
+
+    if ((uint64_t) width * height >= kMinPixelsForBands) {
+        num_bands = get_cpu_count();
+        if (num_bands > kMaxBands)
+            num_bands = kMaxBands;
+        if (num_bands > height)
+            num_bands = height;
+    }
+    return num_bands;
+}
+
+//-------------------------------------
+static void
+tonemap_image(const STonemap *tonemap, const float *src, uint32_t src_width, uint32_t src_height,
+              uint32_t *dst, uint32_t dst_width, uint32_t dst_height, uint32_t dst_pitch, uint32_t *rows, uint32_t num_bands) {
+    SBand bands[kMaxBands];
+
+    for (uint32_t i = 0; i < num_bands; ++i) {
+        bands[i].src        = src;
+        bands[i].src_width  = src_width;
+        bands[i].src_height = src_height;
+        bands[i].dst        = dst;
+        bands[i].dst_width  = dst_width;
+        bands[i].dst_height = dst_height;
+        bands[i].dst_pitch  = dst_pitch;
+        bands[i].row        = rows != 0x0 ? rows + (size_t) i * src_width : 0x0;
+        bands[i].y_begin    = (uint32_t) (((uint64_t) dst_height * i) / num_bands);
+        bands[i].y_end      = (uint32_t) (((uint64_t) dst_height * (i + 1)) / num_bands);
+        bands[i].tonemap    = tonemap;
+        bands[i].row_func   = get_row_func();
+    }
+
+    run_bands(bands, num_bands);
+}
+
+//-------------------------------------
+static bool
+reserve_convert_buffer(SWindowData *window_data, size_t size) {
+    if (window_data->convert_buffer_size < size) {
+        void *convert_buffer = realloc(window_data->convert_buffer, size);
+        if (convert_buffer == 0x0) {
+            return false;
+        }
+        window_data->convert_buffer      = convert_buffer;
+        window_data->convert_buffer_size = size;
+    }
+    return true;
+}
+
+//-------------------------------------
+void *
+convert_input_buffer(SWindowData *window_data, void *buffer, uint32_t width, uint32_t height) {
+    STonemap tonemap;
+
+    if (window_data->input_format != FORMAT_RGBA32F || window_data->gpu_tone_mapping) {
+        return buffer;
+    }
+
+    if (reserve_convert_buffer(window_data, (size_t) width * height * 4) == false || setup_tonemap(window_data, &tonemap) == false) {
+        return 0x0;
+    }
+
+    tonemap_image(&tonemap, (const float *) buffer, width, height, (uint32_t *) window_data->convert_buffer, width, height, width, 0x0, get_num_bands(width, height));
+
+    return window_data->convert_buffer;
+}
+
+// The convert buffer only holds one source row per band: the frame is never converted at its own size
+//-------------------------------------
+bool
+tonemap_stretch_image(SWindowData *window_data, const void *buffer, uint32_t width, uint32_t height,
+                      uint32_t *dst, uint32_t dst_width, uint32_t dst_height, uint32_t dst_pitch) {
+    STonemap tonemap;
+    uint32_t num_bands = get_num_bands(dst_width, dst_height);
+
+    if (reserve_convert_buffer(window_data, (size_t) width * num_bands * 4) == false || setup_tonemap(window_data, &tonemap) == false) {
+        return false;
+    }
+
+    tonemap_image(&tonemap, (const float *) buffer, width, height, dst, dst_width, dst_height, dst_pitch, (uint32_t *) window_data->convert_buffer, num_bands);
+
+    return true;
+}
@@ -2,10 +2,11 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include <stddef.h>
 #include <MiniFB_enums.h>
 
 //-------------------------------------
-typedef struct {
+typedef struct SWindowData {
     void                    *specific;
     void                    *user_data;
 
@@ -17,6 +18,8 @@ typedef struct {
     mfb_mouse_button_func   mouse_btn_func;
     mfb_mouse_move_func     mouse_move_func;
     mfb_mouse_scroll_func   mouse_wheel_func;
+    mfb_present_func        present_func;
+    mfb_visibility_func     visibility_func;
 
     uint32_t                window_width;
     uint32_t                window_height;
@@ -34,17 +37,70 @@ typedef struct {
     uint32_t                buffer_width;
     uint32_t                buffer_height;
     uint32_t                buffer_stride;
-    
+
+    mfb_input_format        input_format;
+    mfb_tone_mapping        tone_mapping;
+    mfb_scale_filter        scale_filter;
+    float                   tone_exposure;
+    float                   tone_gamma;
+    float                   tone_lut_gamma;
+    uint32_t                *tone_lut;
+    void                    *convert_buffer;
+    size_t                  convert_buffer_size;
+    bool                    gpu_tone_mapping;   // Set by the backends whose shaders tone map the float frames
+
+    void                    *async_present;
+    void                    *mailbox;
+    void                    *input_thread;
+    uint64_t                present_fence;
+    uint64_t                present_completed;
+    // Set by backends able to present from another thread (see MiniFB_async.c)
+    mfb_update_state        (*present_frame)(struct SWindowData *window_data, void *buffer, uint32_t width, uint32_t height);
+    void                    (*release_context)(struct SWindowData *window_data);
+    // Set by backends able to read input on another thread (see MiniFB_input.c)
+    bool                    (*setup_input_thread)(struct SWindowData *window_data, bool enable);
+    void                    (*pump_input)(struct SWindowData *window_data, int timeout_ms);
+    void                    (*apply_event_mask)(struct SWindowData *window_data);
+    bool                    (*setup_raw_motion)(struct SWindowData *window_data, bool enable);
+    void                    *raw_motion;
+
     int32_t                 mouse_pos_x;
     int32_t                 mouse_pos_y;
     float                   mouse_wheel_x;
     float                   mouse_wheel_y;
     uint8_t                 mouse_button_status[8];
+    uint32_t                event_native_time;
+    uint64_t                event_receive_tick;
+    uint64_t                latency_start_tick;     // first event not presented yet (0: none)
+    mfb_latency_stats       latency;
+    double                  latency_sum;
+    uint32_t                disabled_events;        // mfb_event_mask flags not subscribed
+    bool                    compress_motion;
+    uint32_t                events_read;
+    uint32_t                events_dispatched;
+
+    struct SWindowData      *scheduler_next;
+    uint64_t                scheduler_due;          // Timer tick of the next frame
+    uint32_t                scheduler_fps;          // 0: the window target fps
+    bool                    scheduled;
+
+    double                  time_for_frame;         // Only if has_target_fps, otherwise the global target fps
+    double                  applied_time_for_frame; // The one the swap interval / display link is set up for
+    bool                    has_target_fps;
+    bool                    use_hardware_sync;
+
+    bool                    skip_identical_frames;
+    bool                    frame_hash_valid;       // Cleared when the window must be redrawn (resize, expose, ...)
+    uint64_t                frame_hash;
+    mfb_frame_stats         frame_stats;
+
     uint8_t                 key_status[512];
     uint32_t                mod_keys;
 
     bool                    is_active;
     bool                    is_initialized;
+    bool                    is_hidden;
+    bool                    idle_when_hidden;
 
     bool                    close;
 } SWindowData;
@@ -7,6 +7,7 @@
 #include <unistd.h>
 //--
 #include <MiniFB.h>
+#include <MiniFB_internal.h>
 #include <WindowData.h>
 #include "WindowData_Android.h"
 
@@ -29,6 +30,9 @@ extern void
 stretch_image(uint32_t *srcImage, uint32_t srcX, uint32_t srcY, uint32_t srcWidth, uint32_t srcHeight, uint32_t srcPitch,
               uint32_t *dstImage, uint32_t dstX, uint32_t dstY, uint32_t dstWidth, uint32_t dstHeight, uint32_t dstPitch);
 
+extern void *
+convert_input_buffer(SWindowData *window_data, void *buffer, uint32_t width, uint32_t height);
+
 //-------------------------------------
 extern int
 main(int argc, char *argv[]);
@@ -387,6 +391,16 @@ mfb_update_ex(struct mfb_window *window, void *buffer, unsigned width, unsigned
         return STATE_INVALID_BUFFER;
     }
 
+    // The native window keeps the last posted buffer
+    if (is_same_frame(window_data, buffer, width, height)) {
+        return STATE_OK;
+    }
+
+    buffer = convert_input_buffer(window_data, buffer, width, height);
+    if (buffer == 0x0) {
+        return STATE_INTERNAL_ERROR;
+    }
+
     window_data->draw_buffer   = buffer;
     window_data->buffer_width  = width;
     window_data->buffer_stride = width * 4;
@@ -408,8 +422,26 @@ mfb_update_ex(struct mfb_window *window, void *buffer, unsigned width, unsigned
 }
 
 //-------------------------------------
-extern double   g_time_for_frame;
+mfb_update_state
+mfb_update_events_all(void) {
+    int                         ident;
+    int                         events;
+    struct android_poll_source  *source;
+
+    // The native activity is the only window
+    while ((ident = ALooper_pollAll(0, NULL, &events, (void **) &source)) >= 0) {
+        if (source != NULL) {
+            source->process(gApplication, source);
+        }
+        if (gApplication->destroyRequested != 0) {
+            return STATE_EXIT;
+        }
+    }
 
+    return STATE_OK;
+}
+
+//-------------------------------------
 bool
 mfb_wait_sync(struct mfb_window *window) {
     if (window == 0x0) {
@@ -450,7 +482,7 @@ mfb_wait_sync(struct mfb_window *window) {
         }
 
         current = mfb_timer_now(window_data_android->timer);
-        if (current >= g_time_for_frame) {
+        if (current >= get_time_for_frame(window_data)) {
             break;
         }
     }
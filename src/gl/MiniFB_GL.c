@@ -5,11 +5,18 @@
 #if defined(_WIN32) || defined(WIN32)
     #include <windows/WindowData_Win.h>
     #include <gl/gl.h>
+#elif defined(USE_WAYLAND_API)
+    #include <wayland/WindowData_Way.h>
+    #include <wayland-egl.h>
+    #include <EGL/egl.h>
+    #include <GLES2/gl2.h>
 #elif defined(linux)
     #include <x11/WindowData_X11.h>
     #include <GL/gl.h>
     #include <GL/glx.h>
+    #include <x11/X11Dyn.h>
 #endif
+#include <stddef.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -21,10 +28,8 @@
     #define UseCleanUp(x)
 #endif
 
-extern double   g_time_for_frame;
-extern bool     g_use_hardware_sync;
-
 //-------------------------------------
+#if !defined(USE_WAYLAND_API)
 static bool
 CheckGLExtension(const char *name) {
     static const char *extensions = 0x0;
@@ -61,6 +66,7 @@ CheckGLExtension(const char *name) {
 
     return true;
 }
+#endif
 
 //-------------------------------------
 #if defined(_WIN32) || defined(WIN32)
@@ -108,6 +114,38 @@ typedef int (WINAPI * PFNWGLGETSWAPINTERVALEXTPROC)(void);
 PFNWGLSWAPINTERVALEXTPROC       SwapIntervalEXT    = 0x0;
 PFNWGLGETSWAPINTERVALEXTPROC    GetSwapIntervalEXT = 0x0;
 
+#elif defined(USE_WAYLAND_API)
+
+// A config without alpha: the compositor would blend the window with what is behind it
+static bool
+setup_pixel_format(SWindowData_Way *window_data_way, EGLConfig *config) {
+    EGLint eglAttribs[] = {
+        EGL_SURFACE_TYPE,       EGL_WINDOW_BIT,
+        EGL_RENDERABLE_TYPE,    EGL_OPENGL_ES2_BIT,
+        EGL_RED_SIZE,           8,
+        EGL_GREEN_SIZE,         8,
+        EGL_BLUE_SIZE,          8,
+        EGL_NONE
+    };
+    EGLConfig   configs[32];
+    EGLint      count = 0, alpha;
+
+    if (eglChooseConfig(window_data_way->egl_display, eglAttribs, configs, 32, &count) == EGL_FALSE || count == 0) {
+        fprintf(stderr, "Cannot find a suitable EGL config.\n");
+        return false;
+    }
+
+    *config = configs[0];
+    for (EGLint i = 0; i < count; ++i) {
+        if (eglGetConfigAttrib(window_data_way->egl_display, configs[i], EGL_ALPHA_SIZE, &alpha) && alpha == 0) {
+            *config = configs[i];
+            break;
+        }
+    }
+
+    return true;
+}
+
 #elif defined(linux)
 
 bool
@@ -130,7 +168,6 @@ setup_pixel_format(SWindowData_X11 *window_data_x11) {
     XVisualInfo* visualInfo = glXChooseVisual(window_data_x11->display, window_data_x11->screen, glxAttribs);
     if (visualInfo == 0) {
         fprintf(stderr, "Could not create correct visual window.\n");
-        XCloseDisplay(window_data_x11->display);
         return false;
     }
     window_data_x11->context = glXCreateContext(window_data_x11->display, visualInfo, NULL, GL_TRUE);
@@ -143,6 +180,62 @@ PFNGLXSWAPINTERVALEXTPROC   SwapIntervalEXT = 0x0;
 
 #endif
 
+//-------------------------------------
+// The context of the window must be current (the swap interval is per context on Windows, per drawable on GLX)
+static void
+set_swap_interval(SWindowData *window_data) {
+    double time_for_frame = get_time_for_frame(window_data);
+    // Assuming the monitor refresh rate is 60 hz
+    int interval = (int) ((60.0 * time_for_frame) + 0.5);
+
+    window_data->applied_time_for_frame = time_for_frame;
+
+#if defined(_WIN32) || defined(WIN32)
+
+    if (SwapIntervalEXT != 0x0) {
+        bool success = SwapIntervalEXT(interval);
+        if (GetSwapIntervalEXT != 0x0) {
+            int currentInterval = GetSwapIntervalEXT();
+            if (interval != currentInterval) {
+                fprintf(stderr, "Cannot set target swap interval. Current swap interval is %d\n", currentInterval);
+            }
+        }
+        else if (success == false) {
+            fprintf(stderr, "Cannot set target swap interval.\n");
+        }
+        window_data->use_hardware_sync = true;
+    }
+
+#elif defined(USE_WAYLAND_API)
+
+    // The backend waits for the frame callbacks itself, with a timeout: with an interval the swap
+    // would block for as long as the window is hidden
+    kUnused(interval);
+    SWindowData_Way *window_data_way = (SWindowData_Way *) window_data->specific;
+    eglSwapInterval(window_data_way->egl_display, 0);
+
+#elif defined(linux)
+    #define kGLX_SWAP_INTERVAL_EXT               0x20F1
+    #define kGLX_MAX_SWAP_INTERVAL_EXT           0x20F2
+
+    if (SwapIntervalEXT != 0x0) {
+        SWindowData_X11 *window_data_x11 = (SWindowData_X11 *) window_data->specific;
+        Display         *dpy      = window_data_x11->display;
+        GLXDrawable     drawable  = window_data_x11->window;
+        unsigned int    currentInterval, maxInterval;
+
+        SwapIntervalEXT(dpy, drawable, interval);
+        glXQueryDrawable(dpy, drawable, kGLX_SWAP_INTERVAL_EXT, &currentInterval);
+        if (interval != (int)currentInterval) {
+            glXQueryDrawable(dpy, drawable, kGLX_MAX_SWAP_INTERVAL_EXT, &maxInterval);
+            fprintf(stderr, "Cannot set target swap interval. Current swap interval is %d (max: %d)\n", currentInterval, maxInterval);
+        }
+        window_data->use_hardware_sync = true;
+    }
+
+#endif
+}
+
 //-------------------------------------
 bool
 create_GL_context(SWindowData *window_data) {
@@ -158,18 +251,68 @@ create_GL_context(SWindowData *window_data) {
 
     SwapIntervalEXT    = (PFNWGLSWAPINTERVALEXTPROC)    wglGetProcAddress("wglSwapIntervalEXT");
     GetSwapIntervalEXT = (PFNWGLGETSWAPINTERVALEXTPROC) wglGetProcAddress("wglGetSwapIntervalEXT");
-    set_target_fps_aux();
+    set_swap_interval(window_data);
+
+    return true;
+
+#elif defined(USE_WAYLAND_API)
+    SWindowData_Way *window_data_way = (SWindowData_Way *) window_data->specific;
+    EGLConfig       config;
+
+    window_data_way->egl_display = eglGetDisplay((EGLNativeDisplayType) window_data_way->display);
+    if (window_data_way->egl_display == EGL_NO_DISPLAY || eglInitialize(window_data_way->egl_display, 0x0, 0x0) == EGL_FALSE) {
+        fprintf(stderr, "Cannot initialize EGL.\n");
+        return false;
+    }
+
+    if (eglBindAPI(EGL_OPENGL_ES_API) == EGL_FALSE || setup_pixel_format(window_data_way, &config) == false)
+        return false;
+
+    // GLES 3 for the scaling filters, GLES 2 draws with nearest / bilinear only
+    for (EGLint version = 3; version >= 2 && window_data_way->egl_context == EGL_NO_CONTEXT; --version) {
+        EGLint contextAttribs[] = { EGL_CONTEXT_CLIENT_VERSION, version, EGL_NONE };
+        window_data_way->egl_context = eglCreateContext(window_data_way->egl_display, config, EGL_NO_CONTEXT, contextAttribs);
+    }
+    if (window_data_way->egl_context == EGL_NO_CONTEXT) {
+        fprintf(stderr, "Cannot create the OpenGL ES context.\n");
+        return false;
+    }
+
+    window_data_way->egl_window = wl_egl_window_create(window_data_way->surface, window_data->window_width, window_data->window_height);
+    if (window_data_way->egl_window == 0x0) {
+        fprintf(stderr, "Cannot create the wl_egl_window.\n");
+        return false;
+    }
+
+    window_data_way->egl_surface = eglCreateWindowSurface(window_data_way->egl_display, config, (EGLNativeWindowType) window_data_way->egl_window, 0x0);
+    if (window_data_way->egl_surface == EGL_NO_SURFACE) {
+        fprintf(stderr, "Cannot create the EGL surface.\n");
+        return false;
+    }
+
+    eglMakeCurrent(window_data_way->egl_display, window_data_way->egl_surface, window_data_way->egl_surface, window_data_way->egl_context);
+
+    init_GL(window_data);
+    if (window_data_way->program == 0) {
+        return false;
+    }
+
+    set_swap_interval(window_data);
 
     return true;
 
 #elif defined(linux)
     SWindowData_X11 *window_data_x11 = (SWindowData_X11 *) window_data->specific;
 
+    if (load_gl_library() == false) {
+        fprintf(stderr, "Cannot load the OpenGL library.\n");
+        return false;
+    }
+
     GLint majorGLX, minorGLX = 0;
     glXQueryVersion(window_data_x11->display, &majorGLX, &minorGLX);
     if (majorGLX <= 1 && minorGLX < 2) {
         fprintf(stderr, "GLX 1.2 or greater is required.\n");
-        XCloseDisplay(window_data_x11->display);
         return false;
     }
     else {
@@ -190,8 +333,8 @@ create_GL_context(SWindowData *window_data) {
 
     if (CheckGLExtension("GLX_EXT_swap_control")) {
         SwapIntervalEXT = (PFNGLXSWAPINTERVALEXTPROC) glXGetProcAddress((const GLubyte *)"glXSwapIntervalEXT");
-        set_target_fps_aux();
     }
+    set_swap_interval(window_data);
 
     return true;
 #endif
@@ -209,6 +352,23 @@ destroy_GL_context(SWindowData *window_data) {
         window_data_win->hGLRC = 0;
     }
 
+#elif defined(USE_WAYLAND_API)
+
+    // Also called for a half created window
+    SWindowData_Way *window_data_way = (SWindowData_Way *) window_data->specific;
+    if (window_data_way->egl_display != EGL_NO_DISPLAY) {
+        eglMakeCurrent(window_data_way->egl_display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+        if (window_data_way->egl_context != EGL_NO_CONTEXT)
+            eglDestroyContext(window_data_way->egl_display, window_data_way->egl_context);
+        if (window_data_way->egl_surface != EGL_NO_SURFACE)
+            eglDestroySurface(window_data_way->egl_display, window_data_way->egl_surface);
+    }
+    if (window_data_way->egl_window != 0x0)
+        wl_egl_window_destroy(window_data_way->egl_window);
+    window_data_way->egl_context = EGL_NO_CONTEXT;
+    window_data_way->egl_surface = EGL_NO_SURFACE;
+    window_data_way->egl_window  = 0x0;
+
 #elif defined(linux)
 
     SWindowData_X11 *window_data_x11 = (SWindowData_X11 *) window_data->specific;
@@ -217,6 +377,302 @@ destroy_GL_context(SWindowData *window_data) {
 #endif
 }
 
+// Makes the context not current in the calling thread so another thread can take it
+//-------------------------------------
+void
+release_GL_context(SWindowData *window_data) {
+#if defined(_WIN32) || defined(WIN32)
+
+    kUnused(window_data);
+    wglMakeCurrent(NULL, NULL);
+
+#elif defined(USE_WAYLAND_API)
+
+    SWindowData_Way *window_data_way = (SWindowData_Way *) window_data->specific;
+    eglMakeCurrent(window_data_way->egl_display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+
+#elif defined(linux)
+
+    SWindowData_X11 *window_data_x11 = (SWindowData_X11 *) window_data->specific;
+    glXMakeCurrent(window_data_x11->display, None, NULL);
+
+#endif
+}
+
+// Shader pipeline (GL 3.3 core / GLES 3): a static quad scaled by the vertex shader to the viewport rect.
+// Needs a context of version 3.3 or higher, otherwise the fixed function one below is used.
+// GLES has no fixed function pipeline: GLES 2 gets shaders without the scaling filters
+//-------------------------------------
+#if !defined(APIENTRY)
+    #define APIENTRY
+#endif
+
+#define ARRAY_BUFFER        0x8892  // [ Core in gl 1.5, gles2 2.0 ]
+#define STATIC_DRAW         0x88E4  // [ Core in gl 1.5, gles2 2.0 ]
+#define FRAGMENT_SHADER     0x8B30  // [ Core in gl 2.0, gles2 2.0 ]
+#define VERTEX_SHADER       0x8B31  // [ Core in gl 2.0, gles2 2.0 ]
+#define COMPILE_STATUS      0x8B81  // [ Core in gl 2.0, gles2 2.0 ]
+#define LINK_STATUS         0x8B82  // [ Core in gl 2.0, gles2 2.0 ]
+
+#define kShaderFunctions(F)                                                                                         \
+    F(GLuint,   CreateShader,               (GLenum type))                                                          \
+    F(void,     ShaderSource,               (GLuint shader, GLsizei count, const char **string, const GLint *length)) \
+    F(void,     CompileShader,              (GLuint shader))                                                        \
+    F(void,     GetShaderiv,                (GLuint shader, GLenum name, GLint *params))                            \
+    F(void,     GetShaderInfoLog,           (GLuint shader, GLsizei size, GLsizei *length, char *log))              \
+    F(void,     DeleteShader,               (GLuint shader))                                                        \
+    F(GLuint,   CreateProgram,              (void))                                                                 \
+    F(void,     AttachShader,               (GLuint program, GLuint shader))                                        \
+    F(void,     BindAttribLocation,         (GLuint program, GLuint index, const char *name))                      \
+    F(void,     LinkProgram,                (GLuint program))                                                       \
+    F(void,     GetProgramiv,               (GLuint program, GLenum name, GLint *params))                           \
+    F(void,     DeleteProgram,              (GLuint program))                                                       \
+    F(void,     UseProgram,                 (GLuint program))                                                       \
+    F(GLint,    GetUniformLocation,         (GLuint program, const char *name))                                     \
+    F(void,     Uniform1i,                  (GLint location, GLint v0))                                             \
+    F(void,     Uniform2f,                  (GLint location, GLfloat v0, GLfloat v1))                               \
+    F(void,     Uniform3f,                  (GLint location, GLfloat v0, GLfloat v1, GLfloat v2))                   \
+    F(void,     Uniform4f,                  (GLint location, GLfloat v0, GLfloat v1, GLfloat v2, GLfloat v3))       \
+    F(void,     GenBuffers,                 (GLsizei n, GLuint *buffers))                                           \
+    F(void,     BindBuffer,                 (GLenum target, GLuint buffer))                                         \
+    F(void,     BufferData,                 (GLenum target, ptrdiff_t size, const void *data, GLenum usage))        \
+    F(void,     DeleteBuffers,              (GLsizei n, const GLuint *buffers))                                     \
+    F(void,     VertexAttribPointer,        (GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride, const void *pointer)) \
+    F(void,     EnableVertexAttribArray,    (GLuint index))
+
+// Not in GLES 2
+#define kVertexArrayFunctions(F)                                                                                    \
+    F(void,     GenVertexArrays,            (GLsizei n, GLuint *arrays))                                            \
+    F(void,     BindVertexArray,            (GLuint array))                                                         \
+    F(void,     DeleteVertexArrays,         (GLsizei n, const GLuint *arrays))
+
+#define kDeclareProc(type, name, args)  typedef type (APIENTRY *PFN_##name) args; static PFN_##name name = 0x0;
+#define kLoadProc(type, name, args)     && (name = (PFN_##name) get_proc_address("gl" #name)) != 0x0
+
+kShaderFunctions(kDeclareProc)
+kVertexArrayFunctions(kDeclareProc)
+
+// Prepended to the shaders. GLES has no BGRA upload: the frame is sent as RGBA and CHANNELS swaps it back
+#if defined(USE_WAYLAND_API)
+    #define kShaderHeader       "#version 300 es\nprecision highp float;\n#define CHANNELS bgr\n"
+    #define kShaderHeaderES2    "#version 100\n#define CHANNELS bgr\n"
+#else
+    #define kShaderHeader       "#version 330 core\n#define CHANNELS rgb\n"
+#endif
+
+static const char *s_vertex_shader =
+    "layout(location = 0) in vec2 position;\n"
+    "uniform vec4 rect;\n"          // x, y, width, height of the viewport (window pixels)
+    "uniform vec2 window_size;\n"
+    "out vec2 uv;\n"
+    "void main() {\n"
+    "    vec2 pos = (rect.xy + position * rect.zw) / window_size;\n"
+    "    gl_Position = vec4(pos.x * 2.0 - 1.0, 1.0 - pos.y * 2.0, 0.0, 1.0);\n"
+    "    uv = position;\n"
+    "}\n";
+
+// The texture filter is GL_LINEAR for all but FILTER_NEAREST.
+// A float frame (tone.x: 1 clamp, 2 Reinhard) is filtered before it is tone mapped, like the same frame rendered bigger
+static const char *s_fragment_shader =
+    "uniform sampler2D frame;\n"
+    "uniform vec4 rect;\n"
+    "uniform int scale_filter;\n"
+    "uniform vec3 tone;\n"         // mode (0 for 8-bit frames), exposure scale, 1 / gamma
+    "in vec2 uv;\n"
+    "out vec4 color;\n"
+    // Bilinear only in the border of the texels, of width 1 / scale
+    "vec4 sharp(vec2 texel, vec2 size, vec2 scale) {\n"
+    "    vec2 center = fract(texel) - 0.5;\n"
+    "    vec2 range  = 0.5 - 0.5 / scale;\n"
+    "    vec2 f      = (center - clamp(center, -range, range)) * scale + 0.5;\n"
+    "    return texture(frame, (floor(texel) + f) / size);\n"
+    "}\n"
+    "vec4 area(vec2 texel, vec2 size, vec2 footprint) {\n"
+    "    ivec2 taps  = ivec2(clamp(ceil(footprint), 1.0, 8.0));\n"
+    "    vec2  step  = footprint / vec2(taps);\n"
+    "    vec2  start = texel - 0.5 * footprint + 0.5 * step;\n"
+    "    vec4  sum   = vec4(0.0);\n"
+    "    for (int y = 0; y < taps.y; ++y)\n"
+    "        for (int x = 0; x < taps.x; ++x)\n"
+    "            sum += texture(frame, (start + vec2(x, y) * step) / size);\n"
+    "    return sum / float(taps.x * taps.y);\n"
+    "}\n"
+    "void main() {\n"
+    "    vec2 size  = vec2(textureSize(frame, 0));\n"
+    "    vec2 texel = uv * size;\n"
+    "    vec2 scale = rect.zw / size;\n"
+    "    vec4 c;\n"
+    "    if (scale_filter == 2)\n"
+    "        c = sharp(texel, size, max(floor(scale), 1.0));\n"
+    "    else if (scale_filter == 3 && (scale.x < 1.0 || scale.y < 1.0))\n"
+    "        c = area(texel, size, 1.0 / scale);\n"
+    "    else if (scale_filter == 3)\n"
+    "        c = sharp(texel, size, scale);\n"
+    "    else\n"
+    "        c = texture(frame, uv);\n"
+    "    if (tone.x > 0.0) {\n"
+    "        vec3 v = max(c.rgb * tone.y, 0.0);\n"
+    "        if (tone.x > 1.5)\n"
+    "            v = v / (v + 1.0);\n"
+    "        color = vec4(pow(min(v, 1.0), vec3(tone.z)), 1.0);\n"
+    "    }\n"
+    "    else\n"
+    "        color = vec4(c.CHANNELS, 1.0);\n"
+    "}\n";
+
+#if defined(USE_WAYLAND_API)
+static const char *s_vertex_shader_es2 =
+    "attribute vec2 position;\n"
+    "uniform vec4 rect;\n"
+    "uniform vec2 window_size;\n"
+    "varying vec2 uv;\n"
+    "void main() {\n"
+    "    vec2 pos = (rect.xy + position * rect.zw) / window_size;\n"
+    "    gl_Position = vec4(pos.x * 2.0 - 1.0, 1.0 - pos.y * 2.0, 0.0, 1.0);\n"
+    "    uv = position;\n"
+    "}\n";
+
+// mediump is not precise enough to pick the texels of a 4K frame
+static const char *s_fragment_shader_es2 =
+    "#ifdef GL_FRAGMENT_PRECISION_HIGH\n"
+    "precision highp float;\n"
+    "#else\n"
+    "precision mediump float;\n"
+    "#endif\n"
+    "uniform sampler2D frame;\n"
+    "varying vec2 uv;\n"
+    "void main() {\n"
+    "    gl_FragColor = vec4(texture2D(frame, uv).CHANNELS, 1.0);\n"
+    "}\n";
+#endif
+
+//-------------------------------------
+static void *
+get_proc_address(const char *name) {
+#if defined(_WIN32) || defined(WIN32)
+    return (void *) wglGetProcAddress(name);
+#elif defined(USE_WAYLAND_API)
+    return (void *) eglGetProcAddress(name);
+#elif defined(linux)
+    return (void *) glXGetProcAddress((const GLubyte *) name);
+#endif
+}
+
+//-------------------------------------
+static bool
+has_GL_version(int major, int minor) {
+    const char  *version = (const char *) glGetString(GL_VERSION);
+    int         current_major = 0, current_minor = 0;
+
+    if (version == 0x0) {
+        return false;
+    }
+    // "3.3.0 <vendor>" on GL, "OpenGL ES 3.0 <vendor>" on GLES
+    while (*version != 0 && (*version < '0' || *version > '9')) {
+        ++version;
+    }
+    if (sscanf(version, "%d.%d", &current_major, &current_minor) != 2) {
+        return false;
+    }
+
+    return current_major > major || (current_major == major && current_minor >= minor);
+}
+
+//-------------------------------------
+static GLuint
+compile_shader(GLenum type, const char *header, const char *source) {
+    const char  *sources[] = { header, source };
+    GLint       status     = 0;
+    char        log[512];
+
+    GLuint shader = CreateShader(type);
+    ShaderSource(shader, 2, sources, 0x0);
+    CompileShader(shader);
+    GetShaderiv(shader, COMPILE_STATUS, &status);
+    if (status == 0) {
+        GetShaderInfoLog(shader, sizeof(log), 0x0, log);
+        fprintf(stderr, "Cannot compile the %s shader: %s\n", type == VERTEX_SHADER ? "vertex" : "fragment", log);
+        DeleteShader(shader);
+        return 0;
+    }
+
+    return shader;
+}
+
+// The context must be current. Returns false (and leaves nothing behind) if the fixed function path has to be used
+//-------------------------------------
+static bool
+create_pipeline(uint32_t *program, uint32_t *vao, uint32_t *vbo, int32_t *u_rect, int32_t *u_window_size, int32_t *u_scale_filter, int32_t *u_tone) {
+    static const float  quad[] = { 0, 0,  1, 0,  0, 1,  1, 1 };
+    GLint               status = 0;
+    const char          *header          = kShaderHeader;
+    const char          *vertex_source   = s_vertex_shader;
+    const char          *fragment_source = s_fragment_shader;
+    bool                use_vao          = true;
+
+#if defined(USE_WAYLAND_API)
+    if (has_GL_version(3, 0) == false) {
+        header          = kShaderHeaderES2;
+        vertex_source   = s_vertex_shader_es2;
+        fragment_source = s_fragment_shader_es2;
+        use_vao         = false;
+    }
+#else
+    if (has_GL_version(3, 3) == false) {
+        return false;
+    }
+#endif
+
+    if ((true kShaderFunctions(kLoadProc)) == false || (use_vao && (true kVertexArrayFunctions(kLoadProc)) == false)) {
+        return false;
+    }
+
+    GLuint vertex_shader   = compile_shader(VERTEX_SHADER, header, vertex_source);
+    GLuint fragment_shader = compile_shader(FRAGMENT_SHADER, header, fragment_source);
+    if (vertex_shader == 0 || fragment_shader == 0) {
+        if (vertex_shader != 0)
+            DeleteShader(vertex_shader);
+        if (fragment_shader != 0)
+            DeleteShader(fragment_shader);
+        return false;
+    }
+
+    *program = CreateProgram();
+    AttachShader(*program, vertex_shader);
+    AttachShader(*program, fragment_shader);
+    BindAttribLocation(*program, 0, "position");
+    LinkProgram(*program);
+    DeleteShader(vertex_shader);
+    DeleteShader(fragment_shader);
+    GetProgramiv(*program, LINK_STATUS, &status);
+    if (status == 0) {
+        fprintf(stderr, "Cannot link the shader program.\n");
+        DeleteProgram(*program);
+        *program = 0;
+        return false;
+    }
+
+    UseProgram(*program);
+    Uniform1i(GetUniformLocation(*program, "frame"), 0);
+    *u_rect        = GetUniformLocation(*program, "rect");
+    *u_window_size = GetUniformLocation(*program, "window_size");
+    *u_scale_filter = GetUniformLocation(*program, "scale_filter");    // -1 on GLES 2: the uniform is ignored
+    *u_tone         = GetUniformLocation(*program, "tone");            // -1 on GLES 2: the frames are converted on the CPU
+
+    // Never changes: the viewport rect is a uniform. Without vertex arrays the bindings stay in the context
+    if (use_vao) {
+        GenVertexArrays(1, vao);
+        BindVertexArray(*vao);
+    }
+    GenBuffers(1, vbo);
+    BindBuffer(ARRAY_BUFFER, *vbo);
+    BufferData(ARRAY_BUFFER, sizeof(quad), quad, STATIC_DRAW);
+    VertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), 0x0);
+    EnableVertexAttribArray(0);
+
+    return true;
+}
+
 //-------------------------------------
 #if defined(RGB)
     #undef RGB
@@ -227,6 +683,16 @@ destroy_GL_context(SWindowData *window_data) {
 #define RGBA        0x1908  // [ Core in gl 1.0, gles1 1.0, gles2 2.0, glsc2 2.0 ]
 #define BGR         0x80E0  // [ Core in gl 1.2 ]
 #define BGRA        0x80E1  // [ Core in gl 1.2, Provided by GL_ARB_vertex_array_bgra (gl|glcore) ]
+#define CLAMP_TO_EDGE 0x812F // [ Core in gl 1.2, gles1 1.0, gles2 2.0, glsc2 2.0 ]
+#define RGBA32F     0x8814  // [ Core in gl 3.0, gles2 3.0 ]
+#define RGBA16F     0x881A  // [ Core in gl 3.0, gles2 3.0 ]
+
+// GLES 3 only filters 32-bit float textures with OES_texture_float_linear
+#if defined(USE_WAYLAND_API)
+    #define kFloatTextureFormat     RGBA16F
+#else
+    #define kFloatTextureFormat     RGBA32F
+#endif
 
 //-------------------------------------
 void
@@ -235,6 +701,10 @@ init_GL(SWindowData *window_data) {
 
     SWindowData_Win *window_data_ex = (SWindowData_Win *) window_data->specific;
 
+#elif defined(USE_WAYLAND_API)
+
+    SWindowData_Way *window_data_ex = (SWindowData_Way *) window_data->specific;
+
 #elif defined(linux)
 
     SWindowData_X11 *window_data_ex = (SWindowData_X11 *) window_data->specific;
@@ -244,25 +714,40 @@ init_GL(SWindowData *window_data) {
 
     glViewport(0, 0, window_data->window_width, window_data->window_height);
 
-    glMatrixMode(GL_PROJECTION);
-    glLoadIdentity();
-    glOrtho(0, window_data->window_width, window_data->window_height, 0, 2048, -2048);
-
-    glMatrixMode(GL_MODELVIEW);
-    glLoadIdentity();
-
     glDisable(GL_DEPTH_TEST);
     glDisable(GL_STENCIL_TEST);
 
-    glEnable(GL_TEXTURE_2D);
-
     glGenTextures(1, &window_data_ex->text_id);
     //glActiveTexture(TEXTURE0);
     glBindTexture(GL_TEXTURE_2D, window_data_ex->text_id);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    // Bilinear taps do not wrap to the other side. GLES 2 needs it for textures that are not power of two
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, CLAMP_TO_EDGE);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    window_data_ex->text_width  = 0;
+    window_data_ex->text_height = 0;
+    window_data_ex->text_filter = FILTER_NEAREST;
+    window_data_ex->text_float  = false;
+    window_data->gpu_tone_mapping = false;
+
+    if (create_pipeline(&window_data_ex->program, &window_data_ex->vao, &window_data_ex->vbo, &window_data_ex->u_rect, &window_data_ex->u_window_size, &window_data_ex->u_scale_filter, &window_data_ex->u_tone)) {
+        window_data->gpu_tone_mapping = (window_data_ex->u_tone >= 0);
+        return;
+    }
+
+#if defined(USE_WAYLAND_API)
+    fprintf(stderr, "Cannot create the shader pipeline.\n");
+#else
+    // Fixed function fallback
+    glMatrixMode(GL_PROJECTION);
+    glLoadIdentity();
+    glOrtho(0, window_data->window_width, window_data->window_height, 0, 2048, -2048);
+
+    glMatrixMode(GL_MODELVIEW);
+    glLoadIdentity();
+
+    glEnable(GL_TEXTURE_2D);
 
     glEnableClientState(GL_VERTEX_ARRAY);
     glEnableClientState(GL_TEXTURE_COORD_ARRAY);
@@ -270,6 +755,7 @@ init_GL(SWindowData *window_data) {
     UseCleanUp(glDisableClientState(GL_TEXTURE_COORD_ARRAY));
     UseCleanUp(glDisableClientState(GL_VERTEX_ARRAY));
     UseCleanUp(glBindTexture(GL_TEXTURE_2D, 0));
+#endif
 }
 
 //-------------------------------------
@@ -281,6 +767,12 @@ resize_GL(SWindowData *window_data) {
         SWindowData_Win *window_data_ex = (SWindowData_Win *) window_data->specific;
         wglMakeCurrent(window_data_ex->hdc, window_data_ex->hGLRC);
 
+    #elif defined(USE_WAYLAND_API)
+
+        SWindowData_Way *window_data_ex = (SWindowData_Way *) window_data->specific;
+        wl_egl_window_resize(window_data_ex->egl_window, window_data->window_width, window_data->window_height, 0, 0);
+        eglMakeCurrent(window_data_ex->egl_display, window_data_ex->egl_surface, window_data_ex->egl_surface, window_data_ex->egl_context);
+
     #elif defined(linux)
 
         SWindowData_X11 *window_data_ex = (SWindowData_X11 *) window_data->specific;
@@ -290,33 +782,23 @@ resize_GL(SWindowData *window_data) {
 
         glViewport(0, 0, window_data->window_width, window_data->window_height);
 
-        glMatrixMode(GL_PROJECTION);
-        glLoadIdentity();
-        glOrtho(0, window_data->window_width, window_data->window_height, 0, 2048, -2048);
+    #if !defined(USE_WAYLAND_API)
+        // The shader pipeline gets the window size with each frame
+        if (window_data_ex->program == 0) {
+            glMatrixMode(GL_PROJECTION);
+            glLoadIdentity();
+            glOrtho(0, window_data->window_width, window_data->window_height, 0, 2048, -2048);
+        }
+    #endif
 
         glClear(GL_COLOR_BUFFER_BIT);
     }
 }
 
 //-------------------------------------
-void
-redraw_GL(SWindowData *window_data, const void *pixels) {
-#if defined(_WIN32) || defined(WIN32)
-
-    SWindowData_Win *window_data_ex = (SWindowData_Win *) window_data->specific;
-    GLenum format = BGRA;
-
-    wglMakeCurrent(window_data_ex->hdc, window_data_ex->hGLRC);
-
-#elif defined(linux)
-
-    SWindowData_X11 *window_data_ex = (SWindowData_X11 *) window_data->specific;
-    GLenum format = BGRA;
-
-    glXMakeCurrent(window_data_ex->display, window_data_ex->window, window_data_ex->context);
-
-#endif
-
+#if !defined(USE_WAYLAND_API)
+static void
+redraw_fixed_function(SWindowData *window_data) {
     float           x, y, w, h;
 
     x = (float) window_data->dst_offset_x;
@@ -338,12 +820,6 @@ redraw_GL(SWindowData *window_data, const void *pixels) {
         1, 1,
     };
 
-    glClear(GL_COLOR_BUFFER_BIT);
-
-    UseCleanUp(glBindTexture(GL_TEXTURE_2D, window_data_ex->text_id));
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, window_data->buffer_width, window_data->buffer_height, 0, format, GL_UNSIGNED_BYTE, pixels);
-    //glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, window_data->buffer_width, window_data->buffer_height, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
-
     UseCleanUp(glEnableClientState(GL_VERTEX_ARRAY));
     UseCleanUp(glEnableClientState(GL_TEXTURE_COORD_ARRAY));
     glVertexPointer(2, GL_FLOAT, 4 * sizeof(float), vertices);
@@ -354,55 +830,116 @@ redraw_GL(SWindowData *window_data, const void *pixels) {
     UseCleanUp(glDisableClientState(GL_TEXTURE_COORD_ARRAY));
     UseCleanUp(glDisableClientState(GL_VERTEX_ARRAY));
     UseCleanUp(glBindTexture(GL_TEXTURE_2D, 0));
-
-#if defined(_WIN32) || defined(WIN32)
-    SwapBuffers(window_data_ex->hdc);
-#elif defined(linux)
-    glXSwapBuffers(window_data_ex->display, window_data_ex->window);
-#endif
 }
+#endif
 
 //-------------------------------------
 void
-set_target_fps_aux() {
-    // Assuming the monitor refresh rate is 60 hz
-    int interval = (int) ((60.0 * g_time_for_frame) + 0.5);
-
+redraw_GL(SWindowData *window_data, const void *pixels) {
 #if defined(_WIN32) || defined(WIN32)
 
-    if (SwapIntervalEXT != 0x0) {
-        bool success = SwapIntervalEXT(interval);
-        if (GetSwapIntervalEXT != 0x0) {
-            int currentInterval = GetSwapIntervalEXT();
-            if (interval != currentInterval) {
-                fprintf(stderr, "Cannot set target swap interval. Current swap interval is %d\n", currentInterval);
-            }
-        }
-        else if (success == false) {
-            fprintf(stderr, "Cannot set target swap interval.\n");
-        }
-        g_use_hardware_sync = true;
-    }
+    SWindowData_Win *window_data_ex = (SWindowData_Win *) window_data->specific;
+    GLint  internal_format = GL_RGB;
+    GLenum format = BGRA;
+
+    wglMakeCurrent(window_data_ex->hdc, window_data_ex->hGLRC);
+
+#elif defined(USE_WAYLAND_API)
+
+    // Both formats must be the same on GLES
+    SWindowData_Way *window_data_ex = (SWindowData_Way *) window_data->specific;
+    GLint  internal_format = RGBA;
+    GLenum format = RGBA;
+
+    eglMakeCurrent(window_data_ex->egl_display, window_data_ex->egl_surface, window_data_ex->egl_surface, window_data_ex->egl_context);
 
 #elif defined(linux)
-    #define kGLX_SWAP_INTERVAL_EXT               0x20F1
-    #define kGLX_MAX_SWAP_INTERVAL_EXT           0x20F2
 
-    if (SwapIntervalEXT != 0x0) {
-        Display         *dpy     = glXGetCurrentDisplay();
-        GLXDrawable     drawable = glXGetCurrentDrawable();
-        unsigned int    currentInterval, maxInterval;
+    SWindowData_X11 *window_data_ex = (SWindowData_X11 *) window_data->specific;
+    GLint  internal_format = GL_RGB;
+    GLenum format = BGRA;
 
-        SwapIntervalEXT(dpy, drawable, interval);
-        glXQueryDrawable(dpy, drawable, kGLX_SWAP_INTERVAL_EXT, &currentInterval);
-        if (interval != (int)currentInterval) {
-            glXQueryDrawable(dpy, drawable, kGLX_MAX_SWAP_INTERVAL_EXT, &maxInterval);
-            fprintf(stderr, "Cannot set target swap interval. Current swap interval is %d (max: %d)\n", currentInterval, maxInterval);
+    glXMakeCurrent(window_data_ex->display, window_data_ex->window, window_data_ex->context);
+
+#endif
+
+    // The target fps of this window (or the global one) changed since the last frame
+    if (window_data->applied_time_for_frame != get_time_for_frame(window_data)) {
+        set_swap_interval(window_data);
+    }
+
+    // Float frames keep their range up to the shader, that tone maps them
+    bool    is_float = (window_data->input_format == FORMAT_RGBA32F && window_data->gpu_tone_mapping);
+    GLenum  type     = GL_UNSIGNED_BYTE;
+    if (is_float) {
+        internal_format = kFloatTextureFormat;
+        format          = RGBA;
+        type            = GL_FLOAT;
+    }
+
+    glClear(GL_COLOR_BUFFER_BIT);
+
+    UseCleanUp(glBindTexture(GL_TEXTURE_2D, window_data_ex->text_id));
+    // The shaders do the sharp and area filters with bilinear taps; the fixed function pipeline has no better
+    if (window_data_ex->text_filter != window_data->scale_filter) {
+        GLint filter = window_data->scale_filter == FILTER_NEAREST ? GL_NEAREST : GL_LINEAR;
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, filter);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, filter);
+        window_data_ex->text_filter = window_data->scale_filter;
+    }
+    // The storage is only allocated again when the size or the format changes
+    if (window_data_ex->text_width != window_data->buffer_width || window_data_ex->text_height != window_data->buffer_height || window_data_ex->text_float != is_float) {
+        glTexImage2D(GL_TEXTURE_2D, 0, internal_format, window_data->buffer_width, window_data->buffer_height, 0, format, type, pixels);
+        window_data_ex->text_width  = window_data->buffer_width;
+        window_data_ex->text_height = window_data->buffer_height;
+        window_data_ex->text_float  = is_float;
+    }
+    else {
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, window_data->buffer_width, window_data->buffer_height, format, type, pixels);
+    }
+
+    if (window_data_ex->program != 0) {
+        Uniform4f(window_data_ex->u_rect, (float) window_data->dst_offset_x, (float) window_data->dst_offset_y, (float) window_data->dst_width, (float) window_data->dst_height);
+        Uniform2f(window_data_ex->u_window_size, (float) window_data->window_width, (float) window_data->window_height);
+        Uniform1i(window_data_ex->u_scale_filter, window_data->scale_filter);
+        if (window_data_ex->u_tone >= 0) {
+            float scale, inv_gamma;
+            get_tone_mapping(window_data, &scale, &inv_gamma);
+            Uniform3f(window_data_ex->u_tone, is_float ? (window_data->tone_mapping == TONE_MAP_REINHARD ? 2.0f : 1.0f) : 0.0f, scale, inv_gamma);
         }
-        g_use_hardware_sync = true;
+        glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+    }
+#if !defined(USE_WAYLAND_API)
+    else {
+        redraw_fixed_function(window_data);
     }
+#endif
 
+#if defined(_WIN32) || defined(WIN32)
+    SwapBuffers(window_data_ex->hdc);
+#elif defined(USE_WAYLAND_API)
+    eglSwapBuffers(window_data_ex->egl_display, window_data_ex->egl_surface);
+#elif defined(linux)
+    glXSwapBuffers(window_data_ex->display, window_data_ex->window);
 #endif
 }
 
+//-------------------------------------
+// Blocks until the GPU has executed the frames swapped so far (swaps are asynchronous)
+void
+finish_GL(SWindowData *window_data) {
+#if defined(_WIN32) || defined(WIN32)
+    SWindowData_Win *window_data_ex = (SWindowData_Win *) window_data->specific;
+    wglMakeCurrent(window_data_ex->hdc, window_data_ex->hGLRC);
+#elif defined(USE_WAYLAND_API)
+    SWindowData_Way *window_data_ex = (SWindowData_Way *) window_data->specific;
+    eglMakeCurrent(window_data_ex->egl_display, window_data_ex->egl_surface, window_data_ex->egl_surface, window_data_ex->egl_context);
+#elif defined(linux)
+    SWindowData_X11 *window_data_ex = (SWindowData_X11 *) window_data->specific;
+    glXMakeCurrent(window_data_ex->display, window_data_ex->window, window_data_ex->context);
+#endif
+
+    glFinish();
+}
+
 #endif
@@ -6,8 +6,10 @@
 
     bool create_GL_context(SWindowData *window_data);
     void destroy_GL_context(SWindowData *window_data);
+    void release_GL_context(SWindowData *window_data);
     void init_GL(SWindowData *window_data);
     void redraw_GL(SWindowData *window_data, const void *pixels);
     void resize_GL(SWindowData *window_data);
+    void finish_GL(SWindowData *window_data);
     
 #endif
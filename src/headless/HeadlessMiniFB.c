@@ -0,0 +1,258 @@
+// Only built in the Linux run time selection (USE_RUNTIME_BACKEND)
+#if defined(USE_RUNTIME_BACKEND)
+
+#define kBackendPrefix  headless_
+#include "linux/LinuxBackend.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <MiniFB.h>
+#include <MiniFB_internal.h>
+#include "WindowData.h"
+
+// Windows with nothing on screen: the frames are kept in memory (CI, servers, tests).
+// They never get input events and never close by themselves
+
+//-------------------------------------
+typedef struct SWindowData_Headless {
+    struct mfb_timer    *timer;
+    struct SWindowData  *next;
+} SWindowData_Headless;
+
+static SWindowData  *s_windows = 0x0;
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void
+destroy_window_data(SWindowData *window_data) {
+    if (window_data == 0x0) {
+        return;
+    }
+
+    SWindowData_Headless *window_data_headless = (SWindowData_Headless *) window_data->specific;
+    if (window_data_headless != 0x0) {
+        stop_input_thread(window_data);
+        stop_async_present(window_data);
+
+        for (SWindowData **link = &s_windows; *link != 0x0; link = &((SWindowData_Headless *) (*link)->specific)->next) {
+            if (*link == window_data) {
+                *link = window_data_headless->next;
+                break;
+            }
+        }
+
+        mfb_timer_destroy(window_data_headless->timer);
+        free(window_data_headless);
+    }
+    destroy_window_data_common(window_data);
+    memset(window_data, 0, sizeof(SWindowData));
+    free(window_data);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Called from mfb_update_ex or from the async presenter thread
+static mfb_update_state
+present_buffer(SWindowData *window_data, void *buffer, uint32_t width, uint32_t height) {
+    buffer = convert_input_buffer(window_data, buffer, width, height);
+    if (buffer == 0x0) {
+        return STATE_INTERNAL_ERROR;
+    }
+
+    window_data->draw_buffer   = buffer;
+    window_data->buffer_width  = width;
+    window_data->buffer_height = height;
+    window_data->buffer_stride = width * 4;
+
+    record_present(window_data);
+
+    return STATE_OK;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+struct mfb_window *
+mfb_open_ex(const char *title, unsigned width, unsigned height, unsigned flags) {
+    kUnused(title);
+    kUnused(flags);
+
+    SWindowData *window_data = (SWindowData *) malloc(sizeof(SWindowData));
+    if (window_data == 0x0) {
+        return 0x0;
+    }
+    memset(window_data, 0, sizeof(SWindowData));
+
+    SWindowData_Headless *window_data_headless = (SWindowData_Headless *) malloc(sizeof(SWindowData_Headless));
+    if (window_data_headless == 0x0) {
+        free(window_data);
+        return 0x0;
+    }
+    memset(window_data_headless, 0, sizeof(SWindowData_Headless));
+    window_data->specific = window_data_headless;
+
+    window_data->window_width  = width;
+    window_data->window_height = height;
+    window_data->buffer_width  = width;
+    window_data->buffer_height = height;
+    window_data->buffer_stride = width * 4;
+    calc_dst_factor(window_data, width, height);
+
+    window_data_headless->timer = mfb_timer_create();
+
+    mfb_set_keyboard_callback((struct mfb_window *) window_data, keyboard_default);
+
+    window_data->present_frame = present_buffer;
+
+    window_data_headless->next = s_windows;
+    s_windows = window_data;
+
+    window_data->is_active      = true;
+    window_data->is_initialized = true;
+    return (struct mfb_window *) window_data;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+mfb_update_state
+mfb_update_ex(struct mfb_window *window, void *buffer, unsigned width, unsigned height) {
+    if (window == 0x0) {
+        return STATE_INVALID_WINDOW;
+    }
+
+    SWindowData *window_data = (SWindowData *) window;
+    if (window_data->close) {
+        destroy_window_data(window_data);
+        return STATE_EXIT;
+    }
+
+    if (buffer == 0x0) {
+        return STATE_INVALID_BUFFER;
+    }
+
+    if (is_same_frame(window_data, buffer, width, height)) {
+        return STATE_OK;
+    }
+
+    return present_buffer(window_data, buffer, width, height);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+mfb_update_state
+mfb_update_events(struct mfb_window *window) {
+    if (window == 0x0) {
+        return STATE_INVALID_WINDOW;
+    }
+
+    SWindowData *window_data = (SWindowData *) window;
+    if (window_data->close) {
+        destroy_window_data(window_data);
+        return STATE_EXIT;
+    }
+
+    return STATE_OK;
+}
+
+//-------------------------------------
+mfb_update_state
+mfb_update_events_all(void) {
+    if (s_windows == 0x0) {
+        return STATE_INVALID_WINDOW;
+    }
+
+    // Closed windows are destroyed by their own update
+    for (SWindowData *window_data = s_windows; window_data != 0x0; window_data = ((SWindowData_Headless *) window_data->specific)->next) {
+        if (window_data->close == false) {
+            return STATE_OK;
+        }
+    }
+
+    return STATE_EXIT;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool
+mfb_wait_sync(struct mfb_window *window) {
+    if (window == 0x0) {
+        return false;
+    }
+
+    SWindowData *window_data = (SWindowData *) window;
+    if (window_data->close) {
+        destroy_window_data(window_data);
+        return false;
+    }
+
+    SWindowData_Headless *window_data_headless = (SWindowData_Headless *) window_data->specific;
+    double      time_for_frame = get_time_for_frame(window_data);
+    double      current;
+    uint32_t    millis = 1;
+    while (1) {
+        current = mfb_timer_now(window_data_headless->timer);
+        if (current >= time_for_frame * 0.96) {
+            mfb_timer_reset(window_data_headless->timer);
+            return true;
+        }
+        else if (current >= time_for_frame * 0.8) {
+            millis = 0;
+        }
+
+        usleep(millis * 1000);
+    }
+
+    return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool
+mfb_set_viewport(struct mfb_window *window, unsigned offset_x, unsigned offset_y, unsigned width, unsigned height) {
+    if (window == 0x0) {
+        return false;
+    }
+
+    SWindowData *window_data = (SWindowData *) window;
+    if (offset_x + width > window_data->window_width) {
+        return false;
+    }
+    if (offset_y + height > window_data->window_height) {
+        return false;
+    }
+
+    lock_present(window_data);
+    window_data->dst_offset_x = offset_x;
+    window_data->dst_offset_y = offset_y;
+    window_data->dst_width    = width;
+    window_data->dst_height   = height;
+    calc_dst_factor(window_data, window_data->window_width, window_data->window_height);
+    unlock_present(window_data);
+
+    return true;
+}
+
+//-------------------------------------
+void
+mfb_get_monitor_scale(struct mfb_window *window, float *scale_x, float *scale_y) {
+    kUnused(window);
+
+    if (scale_x) {
+        *scale_x = 1.0f;
+    }
+    if (scale_y) {
+        *scale_y = 1.0f;
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Frames are done when mfb_update_ex returns
+static void
+finish_frames(struct mfb_window *window) {
+    kUnused(window);
+}
+
+kBackendExport("headless")
+
+#endif
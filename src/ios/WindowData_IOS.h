@@ -13,4 +13,5 @@ typedef struct Vertex {
 typedef struct {
     iOSViewDelegate     *view_delegate;
     Vertex              vertices[4];
+    struct SWindowData  *next;              // Next open window, for mfb_update_events_all
 } SWindowData_IOS;
@@ -9,6 +9,9 @@
 #include <MiniFB_internal.h>
 #include <WindowData.h>
 
+// Open windows, until their update after the close destroys them
+static SWindowData  *s_windows = 0x0;
+
 //-------------------------------------
 SWindowData *
 create_window_data(unsigned width, unsigned height) {
@@ -95,6 +98,9 @@ mfb_open_ex(const char *title, unsigned width, unsigned height, unsigned flags)
         }
         [window makeKeyAndVisible];
 
+        ((SWindowData_IOS *) window_data->specific)->next = s_windows;
+        s_windows = window_data;
+
         window_data->is_initialized = true;
         return (struct mfb_window *) window_data;
     }
@@ -109,9 +115,16 @@ destroy_window_data(SWindowData *window_data) {
     @autoreleasepool {
         SWindowData_IOS   *window_data_ios = (SWindowData_IOS *) window_data->specific;
         if(window_data_ios != 0x0) {
+            for (SWindowData **link = &s_windows; *link != 0x0; link = &((SWindowData_IOS *) (*link)->specific)->next) {
+                if (*link == window_data) {
+                    *link = window_data_ios->next;
+                    break;
+                }
+            }
             memset((void *) window_data_ios, 0, sizeof(SWindowData_IOS));
             free(window_data_ios);
         }
+        destroy_window_data_common(window_data);
         memset(window_data, 0, sizeof(SWindowData));
         free(window_data);
     }
@@ -134,6 +147,16 @@ mfb_update_ex(struct mfb_window *window, void *buffer, unsigned width, unsigned
         return STATE_INVALID_BUFFER;
     }
 
+    // The view keeps drawing its own copy
+    if(is_same_frame(window_data, buffer, width, height)) {
+        return STATE_OK;
+    }
+
+    buffer = convert_input_buffer(window_data, buffer, width, height);
+    if(buffer == 0x0) {
+        return STATE_INTERNAL_ERROR;
+    }
+
     SWindowData_IOS *window_data_ios = (SWindowData_IOS *) window_data->specific;
 
     if(window_data->buffer_width != width || window_data->buffer_height != height) {
@@ -161,8 +184,23 @@ mfb_update_events(struct mfb_window *window) {
 }
 
 //-------------------------------------
-extern double   g_time_for_frame;
+mfb_update_state
+mfb_update_events_all() {
+    if (s_windows == 0x0) {
+        return STATE_INVALID_WINDOW;
+    }
+
+    // Closed windows are destroyed by their own update
+    for (SWindowData *window_data = s_windows; window_data != 0x0; window_data = ((SWindowData_IOS *) window_data->specific)->next) {
+        if (window_data->close == false) {
+            return STATE_OK;
+        }
+    }
+
+    return STATE_EXIT;
+}
 
+//-------------------------------------
 bool
 mfb_wait_sync(struct mfb_window *window) {
     if(window == 0x0) {
@@ -0,0 +1,50 @@
+#pragma once
+
+// With USE_RUNTIME_BACKEND one library carries several Linux backends and LinuxMiniFB.c picks one
+// when the first window is opened. Each backend defines kBackendPrefix and includes this header
+// before MiniFB.h: its entry points get the prefix and kBackendExport publishes them.
+// finish_frames is not part of the API: each backend defines it static, for the probe only.
+
+#include <MiniFB_enums.h>
+
+//-------------------------------------
+typedef struct {
+    const char          *name;
+    struct mfb_window * (*open_ex)(const char *title, unsigned width, unsigned height, unsigned flags);
+    mfb_update_state    (*update_ex)(struct mfb_window *window, void *buffer, unsigned width, unsigned height);
+    mfb_update_state    (*update_events)(struct mfb_window *window);
+    mfb_update_state    (*update_events_all)(void);
+    bool                (*wait_sync)(struct mfb_window *window);
+    bool                (*set_viewport)(struct mfb_window *window, unsigned offset_x, unsigned offset_y, unsigned width, unsigned height);
+    void                (*get_monitor_scale)(struct mfb_window *window, float *scale_x, float *scale_y);
+    void                (*finish_frames)(struct mfb_window *window);
+} SBackendLinux;
+
+// LinuxProbe.c: the fastest of the backends for this display (measured or cached), 0x0 if none can open a window
+const SBackendLinux *probe_backends(const SBackendLinux **backends, uint32_t count, unsigned width, unsigned height, mfb_backend_info *info);
+
+#if defined(USE_RUNTIME_BACKEND) && defined(kBackendPrefix)
+
+    #define kBackendConcat_(a, b)       a##b
+    #define kBackendConcat(a, b)        kBackendConcat_(a, b)
+    #define kBackendFunc(name)          kBackendConcat(kBackendPrefix, name)
+
+    #define mfb_open_ex                 kBackendFunc(open_ex)
+    #define mfb_update_ex               kBackendFunc(update_ex)
+    #define mfb_update_events           kBackendFunc(update_events)
+    #define mfb_update_events_all       kBackendFunc(update_events_all)
+    #define mfb_wait_sync               kBackendFunc(wait_sync)
+    #define mfb_set_viewport            kBackendFunc(set_viewport)
+    #define mfb_get_monitor_scale       kBackendFunc(get_monitor_scale)
+
+    #define kBackendExport(backend_name)                                                            \
+        const SBackendLinux kBackendFunc(backend) = {                                               \
+            backend_name, mfb_open_ex, mfb_update_ex, mfb_update_events, mfb_update_events_all,    \
+            mfb_wait_sync, mfb_set_viewport, mfb_get_monitor_scale, finish_frames                   \
+        };
+
+#else
+
+    #define kBackendExport(backend_name)
+
+#endif
@@ -0,0 +1,160 @@
+#if defined(USE_RUNTIME_BACKEND)
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <MiniFB.h>
+#include "LinuxBackend.h"
+
+extern const SBackendLinux wayland_backend;
+extern const SBackendLinux x11_gl_backend;
+extern const SBackendLinux x11_backend;
+extern const SBackendLinux headless_backend;
+
+// Tried in this order when MINIFB_BACKEND is not set. Headless only when asked for
+static const SBackendLinux *s_backends[] = { &wayland_backend, &x11_gl_backend, &x11_backend, &headless_backend };
+
+// Chosen by the first window opened, the other windows use the same one
+static const SBackendLinux *s_backend = 0x0;
+static mfb_backend_info     s_info    = { 0 };
+static bool                 s_probe   = false;
+
+//-------------------------------------
+static struct mfb_window *
+try_backend(const SBackendLinux *backend, const char *title, unsigned width, unsigned height, unsigned flags) {
+    struct mfb_window *window = backend->open_ex(title, width, height, flags);
+    if (window != 0x0) {
+        s_backend      = backend;
+        s_info.backend = backend->name;
+    }
+    return window;
+}
+
+//-------------------------------------
+void
+mfb_set_backend_probe(bool enable) {
+    s_probe = enable;
+}
+
+//-------------------------------------
+bool
+mfb_get_backend_info(mfb_backend_info *info) {
+    if (info == 0x0) {
+        return false;
+    }
+
+    *info = s_info;
+    return true;
+}
+
+//-------------------------------------
+struct mfb_window *
+mfb_open_ex(const char *title, unsigned width, unsigned height, unsigned flags) {
+    if (s_backend != 0x0) {
+        return s_backend->open_ex(title, width, height, flags);
+    }
+
+    const char *name = getenv("MINIFB_BACKEND");
+    if (name != 0x0 && name[0] != 0) {
+        for (size_t i = 0; i < sizeof(s_backends) / sizeof(s_backends[0]); ++i) {
+            if (strcmp(name, s_backends[i]->name) == 0) {
+                return try_backend(s_backends[i], title, width, height, flags);
+            }
+        }
+        fprintf(stderr, "Unknown MINIFB_BACKEND '%s' (wayland, x11-gl, x11 or headless).\n", name);
+        return 0x0;
+    }
+
+    // XWayland would work too, but the native one is better when there is a compositor
+    const char *wayland_display = getenv("WAYLAND_DISPLAY");
+    if (wayland_display != 0x0 && wayland_display[0] != 0) {
+        struct mfb_window *window = try_backend(&wayland_backend, title, width, height, flags);
+        if (window != 0x0) {
+            return window;
+        }
+    }
+
+    if (getenv("DISPLAY") != 0x0) {
+        // llvmpipe or a remote display can make OpenGL the slow one
+        if (s_probe) {
+            const SBackendLinux *x11_backends[] = { &x11_gl_backend, &x11_backend };
+            const SBackendLinux *fastest        = probe_backends(x11_backends, 2, width, height, &s_info);
+            if (fastest != 0x0) {
+                struct mfb_window *window = try_backend(fastest, title, width, height, flags);
+                if (window != 0x0) {
+                    return window;
+                }
+            }
+        }
+
+        struct mfb_window *window = try_backend(&x11_gl_backend, title, width, height, flags);
+        if (window == 0x0) {
+            window = try_backend(&x11_backend, title, width, height, flags);
+        }
+        return window;
+    }
+
+    return 0x0;
+}
+
+//-------------------------------------
+mfb_update_state
+mfb_update_ex(struct mfb_window *window, void *buffer, unsigned width, unsigned height) {
+    if (s_backend == 0x0) {
+        return STATE_INVALID_WINDOW;
+    }
+    return s_backend->update_ex(window, buffer, width, height);
+}
+
+//-------------------------------------
+mfb_update_state
+mfb_update_events(struct mfb_window *window) {
+    if (s_backend == 0x0) {
+        return STATE_INVALID_WINDOW;
+    }
+    return s_backend->update_events(window);
+}
+
+//-------------------------------------
+mfb_update_state
+mfb_update_events_all(void) {
+    if (s_backend == 0x0) {
+        return STATE_INVALID_WINDOW;
+    }
+    return s_backend->update_events_all();
+}
+
+//-------------------------------------
+bool
+mfb_wait_sync(struct mfb_window *window) {
+    if (s_backend == 0x0) {
+        return false;
+    }
+    return s_backend->wait_sync(window);
+}
+
+//-------------------------------------
+bool
+mfb_set_viewport(struct mfb_window *window, unsigned offset_x, unsigned offset_y, unsigned width, unsigned height) {
+    if (s_backend == 0x0) {
+        return false;
+    }
+    return s_backend->set_viewport(window, offset_x, offset_y, width, height);
+}
+
+//-------------------------------------
+void
+mfb_get_monitor_scale(struct mfb_window *window, float *scale_x, float *scale_y) {
+    if (s_backend == 0x0) {
+        if (scale_x) {
+            *scale_x = 1.0f;
+        }
+        if (scale_y) {
+            *scale_y = 1.0f;
+        }
+        return;
+    }
+    s_backend->get_monitor_scale(window, scale_x, scale_y);
+}
+
+#endif
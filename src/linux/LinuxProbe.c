@@ -0,0 +1,245 @@
+#if defined(USE_RUNTIME_BACKEND)
+
+#include <errno.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <MiniFB.h>
+#include "LinuxBackend.h"
+
+// Presents timed on each backend (after the warm up ones: first texture upload, window mapping, ...)
+#define kProbeWarmUp        2
+#define kProbeFrames        10
+#define kMaxCacheLine       512
+
+// The cache has one line per display: "<display> <backend> <name>=<ms> <name>=<ms> ...".
+// Delete $XDG_CACHE_HOME/minifb/backends (~/.cache by default) to probe again
+
+//-------------------------------------
+static bool
+get_cache_dir(char *path, size_t size) {
+    const char *dir = getenv("XDG_CACHE_HOME");
+    if (dir != 0x0 && dir[0] == '/') {
+        return snprintf(path, size, "%s/minifb", dir) < (int) size;
+    }
+
+    dir = getenv("HOME");
+    if (dir != 0x0 && dir[0] == '/') {
+        return snprintf(path, size, "%s/.cache/minifb", dir) < (int) size;
+    }
+
+    return false;
+}
+
+//-------------------------------------
+static bool
+make_dirs(char *path) {
+    for (char *slash = strchr(path + 1, '/'); ; slash = strchr(slash + 1, '/')) {
+        if (slash != 0x0) {
+            *slash = 0;
+        }
+        bool ok = mkdir(path, 0755) == 0 || errno == EEXIST;
+        if (slash == 0x0 || ok == false) {
+            return ok;
+        }
+        *slash = '/';
+    }
+}
+
+//-------------------------------------
+static bool
+is_display_line(const char *line, const char *display) {
+    size_t length = strlen(display);
+    return strncmp(line, display, length) == 0 && line[length] == ' ';
+}
+
+//-------------------------------------
+static const SBackendLinux *
+find_backend(const SBackendLinux **backends, uint32_t count, const char *name) {
+    for (uint32_t i = 0; i < count; ++i) {
+        if (strcmp(backends[i]->name, name) == 0) {
+            return backends[i];
+        }
+    }
+    return 0x0;
+}
+
+//-------------------------------------
+static const SBackendLinux *
+read_cache(const char *file, const char *display, const SBackendLinux **backends, uint32_t count, mfb_backend_info *info) {
+    const SBackendLinux *chosen = 0x0;
+    char                line[kMaxCacheLine];
+    char                *next;
+
+    FILE *in = fopen(file, "r");
+    if (in == 0x0) {
+        return 0x0;
+    }
+
+    while (chosen == 0x0 && fgets(line, sizeof(line), in) != 0x0) {
+        if (is_display_line(line, display) == false) {
+            continue;
+        }
+
+        strtok_r(line, " \n", &next);
+        const char *name = strtok_r(0x0, " \n", &next);
+        if (name == 0x0 || (chosen = find_backend(backends, count, name)) == 0x0) {
+            continue;
+        }
+
+        info->num_timings = 0;
+        for (char *timing = strtok_r(0x0, " \n", &next); timing != 0x0 && info->num_timings < MFB_MAX_BACKEND_TIMINGS; timing = strtok_r(0x0, " \n", &next)) {
+            char *equal = strchr(timing, '=');
+            if (equal == 0x0) {
+                continue;
+            }
+            *equal = 0;
+            const SBackendLinux *backend = find_backend(backends, count, timing);
+            if (backend != 0x0) {
+                info->timings[info->num_timings].name       = backend->name;
+                info->timings[info->num_timings].present_ms = strtod(equal + 1, 0x0);
+                ++info->num_timings;
+            }
+        }
+    }
+    fclose(in);
+
+    return chosen;
+}
+
+//-------------------------------------
+static void
+write_cache(char *dir, const char *file, const char *display, const SBackendLinux *chosen, const mfb_backend_info *info) {
+    char    temp[PATH_MAX];
+    char    line[kMaxCacheLine];
+
+    if (make_dirs(dir) == false || snprintf(temp, sizeof(temp), "%s.%d", file, (int) getpid()) >= (int) sizeof(temp)) {
+        return;
+    }
+
+    FILE *out = fopen(temp, "w");
+    if (out == 0x0) {
+        return;
+    }
+
+    // Keeps the other displays
+    FILE *in = fopen(file, "r");
+    if (in != 0x0) {
+        while (fgets(line, sizeof(line), in) != 0x0) {
+            if (is_display_line(line, display) == false) {
+                fputs(line, out);
+            }
+        }
+        fclose(in);
+    }
+
+    fprintf(out, "%s %s", display, chosen->name);
+    for (uint32_t i = 0; i < info->num_timings; ++i) {
+        fprintf(out, " %s=%.3f", info->timings[i].name, info->timings[i].present_ms);
+    }
+    fprintf(out, "\n");
+
+    // Other processes see the old file or the new one, never half of it
+    if (fclose(out) != 0 || rename(temp, file) != 0) {
+        unlink(temp);
+    }
+}
+
+//-------------------------------------
+static double
+time_backend(const SBackendLinux *backend, uint32_t *buffer, unsigned width, unsigned height) {
+    struct mfb_window *window = backend->open_ex("MiniFB probe", width, height, WF_BORDERLESS);
+    if (window == 0x0) {
+        return -1;
+    }
+
+    // Without the swap interval the GL path would be timed at the monitor refresh rate
+    mfb_set_window_target_fps(window, 0);
+
+    struct mfb_timer    *timer = mfb_timer_create();
+    double              time   = 0;
+    for (int i = 0; i < kProbeWarmUp + kProbeFrames; ++i) {
+        if (i == kProbeWarmUp) {
+            mfb_timer_reset(timer);
+        }
+        buffer[i] = ~buffer[i];
+        if (backend->update_ex(window, buffer, width, height) != STATE_OK) {
+            time = -1;
+            break;
+        }
+    }
+    // update_ex only submits: GL swaps (without swap interval) and X requests run later, so wait for them
+    if (time == 0) {
+        backend->finish_frames(window);
+        time = mfb_timer_now(timer) * 1000.0 / kProbeFrames;
+    }
+    mfb_timer_destroy(timer);
+
+    mfb_close(window);
+    backend->update_events(window);
+
+    return time;
+}
+
+//-------------------------------------
+const SBackendLinux *
+probe_backends(const SBackendLinux **backends, uint32_t count, unsigned width, unsigned height, mfb_backend_info *info) {
+    const SBackendLinux *chosen = 0x0;
+    char                dir[PATH_MAX];
+    char                file[PATH_MAX];
+    bool                has_cache;
+
+    const char *display = getenv("DISPLAY");
+    if (display == 0x0 || display[0] == 0) {
+        display = "none";
+    }
+
+    has_cache = get_cache_dir(dir, sizeof(dir)) && snprintf(file, sizeof(file), "%s/backends", dir) < (int) sizeof(file);
+    if (has_cache) {
+        chosen = read_cache(file, display, backends, count, info);
+        if (chosen != 0x0) {
+            info->probed     = true;
+            info->from_cache = true;
+            return chosen;
+        }
+    }
+
+    // A frame of the size of the window, not all black
+    uint32_t *buffer = (uint32_t *) malloc((size_t) width * height * sizeof(uint32_t));
+    if (buffer == 0x0 || width * height < kProbeWarmUp + kProbeFrames) {
+        free(buffer);
+        return 0x0;
+    }
+    for (size_t i = 0; i < (size_t) width * height; ++i) {
+        buffer[i] = (uint32_t) (i * 0x9E3779B1u);
+    }
+
+    double best = 0;
+    info->num_timings = 0;
+    for (uint32_t i = 0; i < count && i < MFB_MAX_BACKEND_TIMINGS; ++i) {
+        double time = time_backend(backends[i], buffer, width, height);
+        info->timings[info->num_timings].name       = backends[i]->name;
+        info->timings[info->num_timings].present_ms = time;
+        ++info->num_timings;
+        if (time >= 0 && (chosen == 0x0 || time < best)) {
+            chosen = backends[i];
+            best   = time;
+        }
+    }
+    free(buffer);
+
+    if (chosen != 0x0) {
+        info->probed     = true;
+        info->from_cache = false;
+        if (has_cache) {
+            write_cache(dir, file, display, chosen, info);
+        }
+    }
+
+    return chosen;
+}
+
+#endif
@@ -18,6 +18,9 @@
 //-------------------------------------
 void init_keycodes();
 
+// Open windows, until their update after the close destroys them
+static SWindowData  *s_windows = 0x0;
+
 //-------------------------------------
 SWindowData *
 create_window_data(unsigned width, unsigned height) {
@@ -151,6 +154,9 @@ mfb_open_ex(const char *title, unsigned width, unsigned height, unsigned flags)
 
         mfb_set_keyboard_callback((struct mfb_window *) window_data, keyboard_default);
 
+        window_data_osx->next = s_windows;
+        s_windows = window_data;
+
 #if defined(_DEBUG) || defined(DEBUG)
     #if defined(USE_METAL_API)
         NSLog(@"Window created using Metal API");
@@ -173,6 +179,13 @@ destroy_window_data(SWindowData *window_data) {
     @autoreleasepool {
         SWindowData_OSX   *window_data_osx = (SWindowData_OSX *) window_data->specific;
         if(window_data_osx != 0x0) {
+            for (SWindowData **link = &s_windows; *link != 0x0; link = &((SWindowData_OSX *) (*link)->specific)->next) {
+                if (*link == window_data) {
+                    *link = window_data_osx->next;
+                    break;
+                }
+            }
+
             OSXWindow   *window = window_data_osx->window;
             [window performClose:nil];
 
@@ -199,6 +212,7 @@ destroy_window_data(SWindowData *window_data) {
         }
 #endif
 
+        destroy_window_data_common(window_data);
         memset(window_data, 0, sizeof(SWindowData));
         free(window_data);
     }
@@ -236,6 +250,26 @@ mfb_update_ex(struct mfb_window *window, void *buffer, unsigned width, unsigned
         return STATE_INVALID_BUFFER;
     }
 
+    if(is_same_frame(window_data, buffer, width, height)) {
+#if !defined(USE_METAL_API)
+        // drawRect draws from it, it must not point to a buffer the user may have released
+        if(window_data->input_format != FORMAT_RGBA32F) {
+            window_data->draw_buffer = buffer;
+        }
+#endif
+        update_events(window_data);
+        if(window_data->close) {
+            destroy_window_data(window_data);
+            return STATE_EXIT;
+        }
+        return STATE_OK;
+    }
+
+    buffer = convert_input_buffer(window_data, buffer, width, height);
+    if(buffer == 0x0) {
+        return STATE_INTERNAL_ERROR;
+    }
+
     SWindowData_OSX *window_data_osx = (SWindowData_OSX *) window_data->specific;
 
 #if defined(USE_METAL_API)
@@ -296,9 +330,35 @@ mfb_update_events(struct mfb_window *window) {
 }
 
 //-------------------------------------
-extern double   g_time_for_frame;
-extern bool     g_use_hardware_sync;
+mfb_update_state
+mfb_update_events_all() {
+    NSEvent* event;
+
+    if (s_windows == 0x0) {
+        return STATE_INVALID_WINDOW;
+    }
+
+    // The application queue holds the events of every window
+    @autoreleasepool {
+        do {
+            event = [NSApp nextEventMatchingMask:NSEventMaskAny untilDate:[NSDate distantPast] inMode:NSDefaultRunLoopMode dequeue:YES];
+            if (event) {
+                [NSApp sendEvent:event];
+            }
+        } while (event);
+    }
+
+    // Closed windows are destroyed by their own update
+    for (SWindowData *window_data = s_windows; window_data != 0x0; window_data = ((SWindowData_OSX *) window_data->specific)->next) {
+        if (window_data->close == false) {
+            return STATE_OK;
+        }
+    }
+
+    return STATE_EXIT;
+}
 
+//-------------------------------------
 bool
 mfb_wait_sync(struct mfb_window *window) {
     NSEvent* event;
@@ -313,7 +373,7 @@ mfb_wait_sync(struct mfb_window *window) {
         return false;
     }
 
-    if(g_use_hardware_sync) {
+    if(window_data->use_hardware_sync) {
         return true;
     }
 
@@ -323,15 +383,16 @@ mfb_wait_sync(struct mfb_window *window) {
             return false;
         }
 
+        double      time_for_frame = get_time_for_frame(window_data);
         double      current;
         uint32_t    millis = 1;
         while(1) {
             current = mfb_timer_now(window_data_osx->timer);
-            if (current >= g_time_for_frame * 0.96) {
+            if (current >= time_for_frame * 0.96) {
                 mfb_timer_reset(window_data_osx->timer);
                 return true;
             }
-            else if(current >= g_time_for_frame * 0.8) {
+            else if(current >= time_for_frame * 0.8) {
                 millis = 0;
             }
 
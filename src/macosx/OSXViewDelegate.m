@@ -1,20 +1,10 @@
 #include "OSXViewDelegate.h"
+#include <MiniFB_internal.h>
 
 #if defined(USE_METAL_API)
 
 #import <MetalKit/MetalKit.h>
 
-extern double   g_time_for_frame;
-extern bool     g_use_hardware_sync;
-//--
-bool    g_target_fps_changed = true;
-
-//-------------------------------------
-void
-set_target_fps_aux() {
-    g_target_fps_changed = true;
-}
-
 //-------------------------------------
 #define kShader(inc, src)    @inc#src
 
@@ -68,6 +58,8 @@ NSString *g_shader_src = kShader(
     if (self) {
         window_data     = windowData;
         window_data_osx = (SWindowData_OSX *) windowData->specific;
+        // Not set up yet: the first frame applies the target fps
+        window_data->applied_time_for_frame = -1;
 
         metal_device = MTLCreateSystemDefaultDevice();
         if (!metal_device) {
@@ -85,7 +77,7 @@ NSString *g_shader_src = kShader(
         // MacOS Big Sur is ignoring commandBuffer:presentDrawable:afterMinimumDuration:
         //id<MTLCommandBuffer> commandBuffer = [command_queue commandBuffer];
         //if ([commandBuffer respondsToSelector:@selector(presentDrawable:afterMinimumDuration:)]) {
-        //    g_use_hardware_sync  = true;
+        //    window_data->use_hardware_sync = true;
         //}
 
         [self _createShaders];
@@ -175,17 +167,18 @@ NSString *g_shader_src = kShader(
 
 //-------------------------------------
 - (void) drawInMTKView:(nonnull MTKView *) view {
-    if (g_target_fps_changed) {
+    double time_for_frame = get_time_for_frame(window_data);
+    if (window_data->applied_time_for_frame != time_for_frame) {
         // MacOS is ignoring this :(
-        if (g_time_for_frame == 0) {
+        if (time_for_frame == 0) {
             // Contrary to what is stated in the documentation,
             // 0 means that it does not update. Like pause.
             view.preferredFramesPerSecond = 9999;
         }
         else {
-            view.preferredFramesPerSecond = (int) (1.0 / g_time_for_frame);
+            view.preferredFramesPerSecond = (int) (1.0 / time_for_frame);
         }
-        g_target_fps_changed = false;
+        window_data->applied_time_for_frame = time_for_frame;
     }
 
     // Wait to ensure only MaxBuffersInFlight number of frames are getting proccessed
@@ -238,7 +231,7 @@ NSString *g_shader_src = kShader(
         // Schedule a present once the framebuffer is complete using the current drawable
         //if ([commandBuffer respondsToSelector:@selector(presentDrawable:afterMinimumDuration:)]) {
         //    // MacOS Big Sur is ignoring this
-        //    [commandBuffer presentDrawable:view.currentDrawable afterMinimumDuration:g_time_for_frame];
+        //    [commandBuffer presentDrawable:view.currentDrawable afterMinimumDuration:time_for_frame];
         //}
         //else {
             [commandBuffer presentDrawable:view.currentDrawable];
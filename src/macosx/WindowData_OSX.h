@@ -18,6 +18,7 @@ typedef struct {
     OSXWindow           *window;
     OSXViewDelegate     *viewController;
     struct mfb_timer    *timer;
+    struct SWindowData  *next;              // Next open window, for mfb_update_events_all
 
 #if defined(USE_METAL_API)
     struct {
@@ -0,0 +1,812 @@
+#if defined(USE_VULKAN_API)
+
+#include "MiniFB_VK.h"
+#include "MiniFB_internal.h"
+#if defined(USE_WAYLAND_API)
+    #define VK_USE_PLATFORM_WAYLAND_KHR
+    #include <wayland/WindowData_Way.h>
+    #define kSurfaceExtension   VK_KHR_WAYLAND_SURFACE_EXTENSION_NAME
+#else
+    #define VK_USE_PLATFORM_XLIB_KHR
+    #include <x11/WindowData_X11.h>
+    #define kSurfaceExtension   VK_KHR_XLIB_SURFACE_EXTENSION_NAME
+#endif
+#include <vulkan/vulkan.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// The frames are written by the CPU in a ring of kFramesInFlight slots of a persistently mapped staging buffer
+// and copied by the GPU to the swapchain image (blitted when the viewport is not the size of the frame).
+// A timeline semaphore counts the finished frames: a slot is written again only when its last frame is done.
+#define kFramesInFlight         2
+#define kMaxSwapchainImages     8
+#define kMaxDevices             16
+#define kMaxQueueFamilies       16
+#define kMaxSurfaceFormats      64
+#define kMaxPresentModes        8
+// A frame that cannot get a swapchain image in this time (nanoseconds) is dropped
+#define kAcquireTimeout         100000000ull
+
+//-------------------------------------
+typedef struct SVulkanContext {
+    VkInstance          instance;
+    VkSurfaceKHR        surface;
+    VkPhysicalDevice    physical_device;
+    VkDevice            device;
+    VkQueue             queue;
+    uint32_t            queue_family;
+    VkFormat            format;
+    VkColorSpaceKHR     color_space;
+
+    VkSwapchainKHR      swapchain;
+    VkExtent2D          extent;
+    VkPresentModeKHR    present_mode;
+    uint32_t            num_images;
+    VkImage             images[kMaxSwapchainImages];
+    VkSemaphore         present_ready[kMaxSwapchainImages];    // One per image: a present may still wait on the one of the last frame
+    bool                swapchain_dirty;                        // Resized, out of date or another present mode
+
+    VkBuffer            staging;
+    VkDeviceMemory      staging_memory;
+    uint8_t             *staging_ptr;
+    VkDeviceSize        slot_size;
+    uint32_t            frame_width;
+    uint32_t            frame_height;
+    VkImage             frame_image;                            // Only for scaled frames: blitted from here
+    VkDeviceMemory      frame_memory;
+
+    VkCommandPool       command_pool;
+    VkCommandBuffer     commands[kFramesInFlight];
+    VkSemaphore         image_acquired[kFramesInFlight];
+    VkSemaphore         timeline;
+    uint64_t            frame_count;                            // Submitted frames; the timeline reaches it when all are done
+} SVulkanContext;
+
+//-------------------------------------
+static inline uint32_t
+min_u32(uint32_t a, uint32_t b) {
+    return a < b ? a : b;
+}
+
+//-------------------------------------
+static inline uint32_t
+max_u32(uint32_t a, uint32_t b) {
+    return a > b ? a : b;
+}
+
+//-------------------------------------
+static SVulkanContext **
+get_context(SWindowData *window_data) {
+#if defined(USE_WAYLAND_API)
+    return &((SWindowData_Way *) window_data->specific)->vulkan;
+#else
+    return &((SWindowData_X11 *) window_data->specific)->vulkan;
+#endif
+}
+
+//-------------------------------------
+static bool
+create_instance(SVulkanContext *vk) {
+    const char              *extensions[] = { VK_KHR_SURFACE_EXTENSION_NAME, kSurfaceExtension };
+    VkApplicationInfo       application   = { .sType = VK_STRUCTURE_TYPE_APPLICATION_INFO };
+    VkInstanceCreateInfo    info          = { .sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO };
+
+    application.pEngineName      = "MiniFB";
+    application.apiVersion       = VK_API_VERSION_1_2;
+    info.pApplicationInfo        = &application;
+    info.enabledExtensionCount   = 2;
+    info.ppEnabledExtensionNames = extensions;
+
+    return vkCreateInstance(&info, 0x0, &vk->instance) == VK_SUCCESS;
+}
+
+//-------------------------------------
+static bool
+create_surface(SVulkanContext *vk, SWindowData *window_data) {
+#if defined(USE_WAYLAND_API)
+    SWindowData_Way                 *window_data_way = (SWindowData_Way *) window_data->specific;
+    VkWaylandSurfaceCreateInfoKHR   info = { .sType = VK_STRUCTURE_TYPE_WAYLAND_SURFACE_CREATE_INFO_KHR };
+
+    info.display = window_data_way->display;
+    info.surface = window_data_way->surface;
+    return vkCreateWaylandSurfaceKHR(vk->instance, &info, 0x0, &vk->surface) == VK_SUCCESS;
+#else
+    SWindowData_X11                 *window_data_x11 = (SWindowData_X11 *) window_data->specific;
+    VkXlibSurfaceCreateInfoKHR      info = { .sType = VK_STRUCTURE_TYPE_XLIB_SURFACE_CREATE_INFO_KHR };
+
+    info.dpy    = window_data_x11->display;
+    info.window = window_data_x11->window;
+    return vkCreateXlibSurfaceKHR(vk->instance, &info, 0x0, &vk->surface) == VK_SUCCESS;
+#endif
+}
+
+//-------------------------------------
+static bool
+has_device_extension(VkPhysicalDevice device, const char *name) {
+    VkExtensionProperties   *extensions;
+    uint32_t                count = 0;
+    bool                    found = false;
+
+    if (vkEnumerateDeviceExtensionProperties(device, 0x0, &count, 0x0) != VK_SUCCESS || count == 0) {
+        return false;
+    }
+    extensions = (VkExtensionProperties *) malloc(count * sizeof(VkExtensionProperties));
+    if (extensions == 0x0) {
+        return false;
+    }
+    if (vkEnumerateDeviceExtensionProperties(device, 0x0, &count, extensions) >= VK_SUCCESS) {
+        for (uint32_t i = 0; i < count && found == false; ++i) {
+            found = strcmp(extensions[i].extensionName, name) == 0;
+        }
+    }
+    free(extensions);
+
+    return found;
+}
+
+// A queue family that can blit and present to the surface
+//-------------------------------------
+static bool
+find_queue_family(SVulkanContext *vk, VkPhysicalDevice device, uint32_t *queue_family) {
+    VkQueueFamilyProperties families[kMaxQueueFamilies];
+    uint32_t                count = kMaxQueueFamilies;
+    VkBool32                supported;
+
+    vkGetPhysicalDeviceQueueFamilyProperties(device, &count, families);
+    for (uint32_t i = 0; i < count; ++i) {
+        if ((families[i].queueFlags & VK_QUEUE_GRAPHICS_BIT) == 0)
+            continue;
+        if (vkGetPhysicalDeviceSurfaceSupportKHR(device, i, vk->surface, &supported) != VK_SUCCESS || supported == VK_FALSE)
+            continue;
+        *queue_family = i;
+        return true;
+    }
+
+    return false;
+}
+
+// The GPUs first, the CPU ones (lavapipe, SwiftShader) only when there is nothing else
+//-------------------------------------
+static bool
+pick_physical_device(SVulkanContext *vk) {
+    VkPhysicalDevice    devices[kMaxDevices];
+    uint32_t            count = kMaxDevices;
+
+    if (vkEnumeratePhysicalDevices(vk->instance, &count, devices) < VK_SUCCESS) {
+        return false;
+    }
+
+    for (int pass = 0; pass < 2; ++pass) {
+        for (uint32_t i = 0; i < count; ++i) {
+            VkPhysicalDeviceProperties                  properties;
+            VkPhysicalDeviceTimelineSemaphoreFeatures   timeline = { .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES };
+            VkPhysicalDeviceFeatures2                   features = { .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2, .pNext = &timeline };
+
+            vkGetPhysicalDeviceProperties(devices[i], &properties);
+            if ((properties.deviceType == VK_PHYSICAL_DEVICE_TYPE_CPU) != (pass == 1))
+                continue;
+            if (properties.apiVersion < VK_API_VERSION_1_2)
+                continue;
+            vkGetPhysicalDeviceFeatures2(devices[i], &features);
+            if (timeline.timelineSemaphore == VK_FALSE)
+                continue;
+            if (has_device_extension(devices[i], VK_KHR_SWAPCHAIN_EXTENSION_NAME) == false)
+                continue;
+            if (find_queue_family(vk, devices[i], &vk->queue_family) == false)
+                continue;
+
+            vk->physical_device = devices[i];
+            return true;
+        }
+    }
+
+    return false;
+}
+
+//-------------------------------------
+static bool
+create_device(SVulkanContext *vk) {
+    const char                                  *extensions[] = { VK_KHR_SWAPCHAIN_EXTENSION_NAME };
+    float                                       priority      = 1.0f;
+    VkPhysicalDeviceTimelineSemaphoreFeatures   timeline      = { .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES };
+    VkDeviceQueueCreateInfo                     queue_info    = { .sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO };
+    VkDeviceCreateInfo                          info          = { .sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO, .pNext = &timeline };
+
+    timeline.timelineSemaphore      = VK_TRUE;
+    queue_info.queueFamilyIndex     = vk->queue_family;
+    queue_info.queueCount           = 1;
+    queue_info.pQueuePriorities     = &priority;
+    info.queueCreateInfoCount       = 1;
+    info.pQueueCreateInfos          = &queue_info;
+    info.enabledExtensionCount      = 1;
+    info.ppEnabledExtensionNames    = extensions;
+
+    if (vkCreateDevice(vk->physical_device, &info, 0x0, &vk->device) != VK_SUCCESS) {
+        return false;
+    }
+    vkGetDeviceQueue(vk->device, vk->queue_family, 0, &vk->queue);
+
+    return true;
+}
+
+// BGRA is the layout of the frames: they are copied as they are. The other formats get them through a blit, that converts
+//-------------------------------------
+static bool
+choose_format(SVulkanContext *vk) {
+    VkSurfaceFormatKHR  formats[kMaxSurfaceFormats];
+    VkFormatProperties  properties;
+    uint32_t            count = kMaxSurfaceFormats;
+
+    if (vkGetPhysicalDeviceSurfaceFormatsKHR(vk->physical_device, vk->surface, &count, formats) < VK_SUCCESS || count == 0) {
+        return false;
+    }
+
+    vk->format      = formats[0].format;
+    vk->color_space = formats[0].colorSpace;
+    for (uint32_t i = 0; i < count; ++i) {
+        if (formats[i].format == VK_FORMAT_B8G8R8A8_UNORM || formats[i].format == VK_FORMAT_UNDEFINED) {
+            vk->format      = VK_FORMAT_B8G8R8A8_UNORM;
+            vk->color_space = formats[i].colorSpace;
+            break;
+        }
+    }
+
+    // Scaled frames are always blitted
+    vkGetPhysicalDeviceFormatProperties(vk->physical_device, vk->format, &properties);
+    return (properties.optimalTilingFeatures & VK_FORMAT_FEATURE_BLIT_DST_BIT) != 0;
+}
+
+// Like the GL swap interval: FIFO for the monitor rate, MAILBOX (or IMMEDIATE) otherwise and the timer of mfb_wait_sync paces the frames
+//-------------------------------------
+static VkPresentModeKHR
+choose_present_mode(SVulkanContext *vk, SWindowData *window_data) {
+    static const VkPresentModeKHR   unsynced[] = { VK_PRESENT_MODE_MAILBOX_KHR, VK_PRESENT_MODE_IMMEDIATE_KHR };
+    VkPresentModeKHR                modes[kMaxPresentModes];
+    uint32_t                        count = kMaxPresentModes;
+    double                          time_for_frame = get_time_for_frame(window_data);
+    // Assuming the monitor refresh rate is 60 hz
+    int                             interval = (int) ((60.0 * time_for_frame) + 0.5);
+
+    window_data->applied_time_for_frame = time_for_frame;
+
+#if defined(USE_WAYLAND_API)
+    // The backend waits for the frame callbacks itself, with a timeout: FIFO would block for as long as the window is hidden
+    interval = 0;
+#else
+    window_data->use_hardware_sync = interval <= 1;
+#endif
+
+    if (interval == 1 || vkGetPhysicalDeviceSurfacePresentModesKHR(vk->physical_device, vk->surface, &count, modes) < VK_SUCCESS) {
+        return VK_PRESENT_MODE_FIFO_KHR;
+    }
+    for (uint32_t i = 0; i < sizeof(unsynced) / sizeof(unsynced[0]); ++i) {
+        for (uint32_t j = 0; j < count; ++j) {
+            if (modes[j] == unsynced[i]) {
+                return unsynced[i];
+            }
+        }
+    }
+
+    // Always supported
+    return VK_PRESENT_MODE_FIFO_KHR;
+}
+
+//-------------------------------------
+static bool
+create_swapchain(SVulkanContext *vk, SWindowData *window_data) {
+    VkSurfaceCapabilitiesKHR    caps;
+    VkSwapchainCreateInfoKHR    info = { .sType = VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR };
+    VkSwapchainKHR              old_swapchain = vk->swapchain;
+    VkResult                    result;
+
+    // The images of the old one may still be in use
+    vkDeviceWaitIdle(vk->device);
+    vk->swapchain_dirty = true;
+
+    if (vkGetPhysicalDeviceSurfaceCapabilitiesKHR(vk->physical_device, vk->surface, &caps) != VK_SUCCESS) {
+        return false;
+    }
+    if ((caps.supportedUsageFlags & VK_IMAGE_USAGE_TRANSFER_DST_BIT) == 0) {
+        fprintf(stderr, "Cannot copy to the Vulkan swapchain images.\n");
+        return false;
+    }
+
+    // Wayland: the swapchain gives the size to the surface
+    vk->extent = caps.currentExtent;
+    if (vk->extent.width == 0xFFFFFFFF) {
+        vk->extent.width  = min_u32(max_u32(window_data->window_width,  caps.minImageExtent.width),  caps.maxImageExtent.width);
+        vk->extent.height = min_u32(max_u32(window_data->window_height, caps.minImageExtent.height), caps.maxImageExtent.height);
+    }
+    // Minimized: it stays dirty until there is something to draw on
+    if (vk->extent.width == 0 || vk->extent.height == 0) {
+        return true;
+    }
+
+    vk->present_mode = choose_present_mode(vk, window_data);
+
+    info.surface            = vk->surface;
+    info.minImageCount      = caps.minImageCount + 1;
+    if (caps.maxImageCount != 0 && info.minImageCount > caps.maxImageCount)
+        info.minImageCount  = caps.maxImageCount;
+    if (info.minImageCount > kMaxSwapchainImages)
+        info.minImageCount  = kMaxSwapchainImages;
+    info.imageFormat        = vk->format;
+    info.imageColorSpace    = vk->color_space;
+    info.imageExtent        = vk->extent;
+    info.imageArrayLayers   = 1;
+    info.imageUsage         = VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+    info.imageSharingMode   = VK_SHARING_MODE_EXCLUSIVE;
+    info.preTransform       = caps.currentTransform;
+    // Opaque if it can, otherwise the first one it has
+    if (caps.supportedCompositeAlpha & VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR)
+        info.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
+    else
+        info.compositeAlpha = (VkCompositeAlphaFlagBitsKHR) (caps.supportedCompositeAlpha & (~caps.supportedCompositeAlpha + 1));
+    info.presentMode        = vk->present_mode;
+    info.clipped            = VK_TRUE;
+    info.oldSwapchain       = old_swapchain;
+
+    result = vkCreateSwapchainKHR(vk->device, &info, 0x0, &vk->swapchain);
+    if (old_swapchain != VK_NULL_HANDLE) {
+        vkDestroySwapchainKHR(vk->device, old_swapchain, 0x0);
+    }
+    if (result != VK_SUCCESS) {
+        vk->swapchain = VK_NULL_HANDLE;
+        fprintf(stderr, "Cannot create the Vulkan swapchain (%d).\n", (int) result);
+        return false;
+    }
+
+    if (vkGetSwapchainImagesKHR(vk->device, vk->swapchain, &vk->num_images, 0x0) != VK_SUCCESS || vk->num_images > kMaxSwapchainImages) {
+        fprintf(stderr, "Cannot use the Vulkan swapchain images.\n");
+        return false;
+    }
+    vkGetSwapchainImagesKHR(vk->device, vk->swapchain, &vk->num_images, vk->images);
+
+    for (uint32_t i = 0; i < vk->num_images; ++i) {
+        VkSemaphoreCreateInfo semaphore_info = { .sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO };
+        if (vk->present_ready[i] == VK_NULL_HANDLE && vkCreateSemaphore(vk->device, &semaphore_info, 0x0, &vk->present_ready[i]) != VK_SUCCESS) {
+            return false;
+        }
+    }
+
+    vk->swapchain_dirty = false;
+    return true;
+}
+
+//-------------------------------------
+static bool
+allocate_memory(SVulkanContext *vk, VkMemoryRequirements *requirements, VkMemoryPropertyFlags flags, VkDeviceMemory *memory) {
+    VkPhysicalDeviceMemoryProperties    properties;
+    VkMemoryAllocateInfo                info = { .sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO };
+
+    vkGetPhysicalDeviceMemoryProperties(vk->physical_device, &properties);
+    for (uint32_t i = 0; i < properties.memoryTypeCount; ++i) {
+        if ((requirements->memoryTypeBits & (1u << i)) && (properties.memoryTypes[i].propertyFlags & flags) == flags) {
+            info.allocationSize  = requirements->size;
+            info.memoryTypeIndex = i;
+            return vkAllocateMemory(vk->device, &info, 0x0, memory) == VK_SUCCESS;
+        }
+    }
+
+    return false;
+}
+
+//-------------------------------------
+static void
+destroy_frame_resources(SVulkanContext *vk) {
+    if (vk->frame_image != VK_NULL_HANDLE)
+        vkDestroyImage(vk->device, vk->frame_image, 0x0);
+    if (vk->frame_memory != VK_NULL_HANDLE)
+        vkFreeMemory(vk->device, vk->frame_memory, 0x0);
+    if (vk->staging != VK_NULL_HANDLE)
+        vkDestroyBuffer(vk->device, vk->staging, 0x0);
+    if (vk->staging_memory != VK_NULL_HANDLE)
+        vkFreeMemory(vk->device, vk->staging_memory, 0x0);     // Unmapped too
+
+    vk->frame_image    = VK_NULL_HANDLE;
+    vk->frame_memory   = VK_NULL_HANDLE;
+    vk->staging        = VK_NULL_HANDLE;
+    vk->staging_memory = VK_NULL_HANDLE;
+    vk->staging_ptr    = 0x0;
+    vk->frame_width    = 0;
+    vk->frame_height   = 0;
+}
+
+// The staging ring, for frames of this size
+//-------------------------------------
+static bool
+create_staging(SVulkanContext *vk, uint32_t width, uint32_t height) {
+    VkBufferCreateInfo      info = { .sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO };
+    VkMemoryRequirements    requirements;
+    void                    *ptr;
+
+    // The frames in flight read the old one
+    vkDeviceWaitIdle(vk->device);
+    destroy_frame_resources(vk);
+
+    vk->slot_size    = (VkDeviceSize) width * height * 4;
+    info.size        = vk->slot_size * kFramesInFlight;
+    info.usage       = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+    info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    if (vkCreateBuffer(vk->device, &info, 0x0, &vk->staging) != VK_SUCCESS) {
+        return false;
+    }
+
+    // Coherent: no flushes, and the submit makes the writes visible to the GPU
+    vkGetBufferMemoryRequirements(vk->device, vk->staging, &requirements);
+    if (allocate_memory(vk, &requirements, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, &vk->staging_memory) == false) {
+        return false;
+    }
+    if (vkBindBufferMemory(vk->device, vk->staging, vk->staging_memory, 0) != VK_SUCCESS) {
+        return false;
+    }
+    if (vkMapMemory(vk->device, vk->staging_memory, 0, VK_WHOLE_SIZE, 0, &ptr) != VK_SUCCESS) {
+        return false;
+    }
+
+    vk->staging_ptr  = (uint8_t *) ptr;
+    vk->frame_width  = width;
+    vk->frame_height = height;
+
+    return true;
+}
+
+// Created the first time a frame has to be scaled
+//-------------------------------------
+static bool
+create_frame_image(SVulkanContext *vk) {
+    VkImageCreateInfo       info = { .sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO };
+    VkMemoryRequirements    requirements;
+
+    info.imageType      = VK_IMAGE_TYPE_2D;
+    info.format         = VK_FORMAT_B8G8R8A8_UNORM;
+    info.extent.width   = vk->frame_width;
+    info.extent.height  = vk->frame_height;
+    info.extent.depth   = 1;
+    info.mipLevels      = 1;
+    info.arrayLayers    = 1;
+    info.samples        = VK_SAMPLE_COUNT_1_BIT;
+    info.tiling         = VK_IMAGE_TILING_OPTIMAL;
+    info.usage          = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+    info.sharingMode    = VK_SHARING_MODE_EXCLUSIVE;
+    info.initialLayout  = VK_IMAGE_LAYOUT_UNDEFINED;
+    if (vkCreateImage(vk->device, &info, 0x0, &vk->frame_image) != VK_SUCCESS) {
+        return false;
+    }
+
+    vkGetImageMemoryRequirements(vk->device, vk->frame_image, &requirements);
+    if (allocate_memory(vk, &requirements, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &vk->frame_memory) == false &&
+        allocate_memory(vk, &requirements, 0, &vk->frame_memory) == false) {
+        return false;
+    }
+
+    return vkBindImageMemory(vk->device, vk->frame_image, vk->frame_memory, 0) == VK_SUCCESS;
+}
+
+// All the barriers are after transfers (or after the acquire, waited at the transfer stage)
+//-------------------------------------
+static void
+image_barrier(VkCommandBuffer commands, VkImage image, VkImageLayout old_layout, VkImageLayout new_layout, VkAccessFlags src_access, VkAccessFlags dst_access, VkPipelineStageFlags dst_stage) {
+    VkImageMemoryBarrier barrier = { .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER };
+
+    barrier.srcAccessMask               = src_access;
+    barrier.dstAccessMask               = dst_access;
+    barrier.oldLayout                   = old_layout;
+    barrier.newLayout                   = new_layout;
+    barrier.srcQueueFamilyIndex         = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex         = VK_QUEUE_FAMILY_IGNORED;
+    barrier.image                       = image;
+    barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    barrier.subresourceRange.levelCount = 1;
+    barrier.subresourceRange.layerCount = 1;
+
+    vkCmdPipelineBarrier(commands, VK_PIPELINE_STAGE_TRANSFER_BIT, dst_stage, 0, 0, 0x0, 0, 0x0, 1, &barrier);
+}
+
+//-------------------------------------
+static bool
+record_frame(SVulkanContext *vk, SWindowData *window_data, VkCommandBuffer commands, VkDeviceSize offset, VkImage target) {
+    static const VkClearColorValue  black = { { 0.0f, 0.0f, 0.0f, 1.0f } };
+    VkImageSubresourceRange         range = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+    VkImageSubresourceLayers        layer = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
+    VkCommandBufferBeginInfo        begin = { .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO };
+    VkBufferImageCopy               copy;
+    uint32_t                        x, y, width, height;
+
+    // The viewport, inside the image (the window can be smaller for a moment after a resize)
+    x      = min_u32(window_data->dst_offset_x, vk->extent.width);
+    y      = min_u32(window_data->dst_offset_y, vk->extent.height);
+    width  = min_u32(window_data->dst_width,  vk->extent.width  - x);
+    height = min_u32(window_data->dst_height, vk->extent.height - y);
+
+    begin.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    if (vkBeginCommandBuffer(commands, &begin) != VK_SUCCESS) {
+        return false;
+    }
+
+    // The old content is never kept: the viewport is drawn on black
+    image_barrier(commands, target, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 0, VK_ACCESS_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
+    if (x != 0 || y != 0 || width != vk->extent.width || height != vk->extent.height) {
+        vkCmdClearColorImage(commands, target, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, &black, 1, &range);
+        image_barrier(commands, target, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
+    }
+
+    memset(&copy, 0, sizeof(copy));
+    copy.bufferOffset       = offset;
+    copy.imageSubresource   = layer;
+    copy.imageExtent.width  = vk->frame_width;
+    copy.imageExtent.height = vk->frame_height;
+    copy.imageExtent.depth  = 1;
+
+    if (width == 0 || height == 0) {
+        // Nothing of the frame can be seen
+    }
+    else if (width == vk->frame_width && height == vk->frame_height && vk->format == VK_FORMAT_B8G8R8A8_UNORM) {
+        // Same size and layout: straight from the staging buffer
+        copy.imageOffset.x = (int32_t) x;
+        copy.imageOffset.y = (int32_t) y;
+        vkCmdCopyBufferToImage(commands, vk->staging, target, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &copy);
+    }
+    else {
+        VkImageBlit blit;
+
+        if (vk->frame_image == VK_NULL_HANDLE && create_frame_image(vk) == false) {
+            fprintf(stderr, "Cannot create the Vulkan frame image.\n");
+            vkEndCommandBuffer(commands);
+            return false;
+        }
+
+        // The blit of the previous frame may still read it: the barrier waits for the transfers submitted before
+        image_barrier(commands, vk->frame_image, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 0, VK_ACCESS_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
+        vkCmdCopyBufferToImage(commands, vk->staging, vk->frame_image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &copy);
+        image_barrier(commands, vk->frame_image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_TRANSFER_READ_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
+
+        memset(&blit, 0, sizeof(blit));
+        blit.srcSubresource  = layer;
+        blit.srcOffsets[1].x = (int32_t) vk->frame_width;
+        blit.srcOffsets[1].y = (int32_t) vk->frame_height;
+        blit.srcOffsets[1].z = 1;
+        blit.dstSubresource  = layer;
+        blit.dstOffsets[0].x = (int32_t) x;
+        blit.dstOffsets[0].y = (int32_t) y;
+        blit.dstOffsets[1].x = (int32_t) (x + width);
+        blit.dstOffsets[1].y = (int32_t) (y + height);
+        blit.dstOffsets[1].z = 1;
+        // A blit has no better than bilinear for the sharp and area filters
+        vkCmdBlitImage(commands, vk->frame_image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, target, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &blit,
+                       window_data->scale_filter == FILTER_NEAREST ? VK_FILTER_NEAREST : VK_FILTER_LINEAR);
+    }
+
+    image_barrier(commands, target, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR, VK_ACCESS_TRANSFER_WRITE_BIT, 0, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT);
+
+    return vkEndCommandBuffer(commands) == VK_SUCCESS;
+}
+
+//-------------------------------------
+bool
+create_VK_context(SWindowData *window_data) {
+    VkCommandPoolCreateInfo     pool_info      = { .sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO };
+    VkCommandBufferAllocateInfo commands_info  = { .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO };
+    VkSemaphoreTypeCreateInfo   timeline_info  = { .sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO };
+    VkSemaphoreCreateInfo       semaphore_info = { .sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO };
+
+    SVulkanContext *vk = (SVulkanContext *) malloc(sizeof(SVulkanContext));
+    if (vk == 0x0) {
+        return false;
+    }
+    memset(vk, 0, sizeof(SVulkanContext));
+    *get_context(window_data) = vk;
+
+    if (create_instance(vk) == false) {
+        fprintf(stderr, "Cannot create the Vulkan instance (Vulkan 1.2 is needed).\n");
+        goto error;
+    }
+    if (create_surface(vk, window_data) == false) {
+        fprintf(stderr, "Cannot create the Vulkan surface.\n");
+        goto error;
+    }
+    if (pick_physical_device(vk) == false) {
+        fprintf(stderr, "Cannot find a Vulkan 1.2 device with timeline semaphores that can present to the window.\n");
+        goto error;
+    }
+    if (create_device(vk) == false || choose_format(vk) == false) {
+        fprintf(stderr, "Cannot create the Vulkan device.\n");
+        goto error;
+    }
+
+    pool_info.flags                 = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+    pool_info.queueFamilyIndex      = vk->queue_family;
+    if (vkCreateCommandPool(vk->device, &pool_info, 0x0, &vk->command_pool) != VK_SUCCESS) {
+        goto error;
+    }
+    commands_info.commandPool        = vk->command_pool;
+    commands_info.level              = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    commands_info.commandBufferCount = kFramesInFlight;
+    if (vkAllocateCommandBuffers(vk->device, &commands_info, vk->commands) != VK_SUCCESS) {
+        goto error;
+    }
+    for (uint32_t i = 0; i < kFramesInFlight; ++i) {
+        if (vkCreateSemaphore(vk->device, &semaphore_info, 0x0, &vk->image_acquired[i]) != VK_SUCCESS) {
+            goto error;
+        }
+    }
+    timeline_info.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+    semaphore_info.pNext        = &timeline_info;
+    if (vkCreateSemaphore(vk->device, &semaphore_info, 0x0, &vk->timeline) != VK_SUCCESS) {
+        goto error;
+    }
+
+    if (create_swapchain(vk, window_data) == false) {
+        goto error;
+    }
+
+    return true;
+
+error:
+    destroy_VK_context(window_data);
+    return false;
+}
+
+//-------------------------------------
+void
+destroy_VK_context(SWindowData *window_data) {
+    SVulkanContext *vk = *get_context(window_data);
+    if (vk == 0x0) {
+        return;
+    }
+
+    if (vk->device != VK_NULL_HANDLE) {
+        vkDeviceWaitIdle(vk->device);
+
+        destroy_frame_resources(vk);
+        for (uint32_t i = 0; i < kMaxSwapchainImages; ++i) {
+            if (vk->present_ready[i] != VK_NULL_HANDLE)
+                vkDestroySemaphore(vk->device, vk->present_ready[i], 0x0);
+        }
+        for (uint32_t i = 0; i < kFramesInFlight; ++i) {
+            if (vk->image_acquired[i] != VK_NULL_HANDLE)
+                vkDestroySemaphore(vk->device, vk->image_acquired[i], 0x0);
+        }
+        if (vk->timeline != VK_NULL_HANDLE)
+            vkDestroySemaphore(vk->device, vk->timeline, 0x0);
+        if (vk->command_pool != VK_NULL_HANDLE)
+            vkDestroyCommandPool(vk->device, vk->command_pool, 0x0);
+        if (vk->swapchain != VK_NULL_HANDLE)
+            vkDestroySwapchainKHR(vk->device, vk->swapchain, 0x0);
+        vkDestroyDevice(vk->device, 0x0);
+    }
+    if (vk->surface != VK_NULL_HANDLE)
+        vkDestroySurfaceKHR(vk->instance, vk->surface, 0x0);
+    if (vk->instance != VK_NULL_HANDLE)
+        vkDestroyInstance(vk->instance, 0x0);
+
+    memset(vk, 0, sizeof(SVulkanContext));
+    free(vk);
+    *get_context(window_data) = 0x0;
+
+    // The software path paces the frames with the timer
+    window_data->use_hardware_sync = false;
+}
+
+// The swapchain is created again by the next frame (safe from any thread while the presenter is locked)
+//-------------------------------------
+void
+resize_VK(SWindowData *window_data) {
+    SVulkanContext *vk = *get_context(window_data);
+    if (vk != 0x0) {
+        vk->swapchain_dirty = true;
+    }
+}
+
+// False only when the device is lost or out of memory. Frames without an image to draw on are dropped
+//-------------------------------------
+bool
+redraw_VK(SWindowData *window_data, const void *pixels) {
+    SVulkanContext                  *vk           = *get_context(window_data);
+    VkTimelineSemaphoreSubmitInfo   timeline_info = { .sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO };
+    VkSubmitInfo                    submit        = { .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO };
+    VkPresentInfoKHR                present       = { .sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR };
+    VkPipelineStageFlags            wait_stage    = VK_PIPELINE_STAGE_TRANSFER_BIT;
+    VkSemaphore                     signal[2];
+    uint64_t                        signal_values[2];
+    uint64_t                        wait_value;
+    uint32_t                        slot, image_index;
+    VkResult                        result;
+
+    // The target fps of this window (or the global one) changed since the last frame
+    if (window_data->applied_time_for_frame != get_time_for_frame(window_data) && choose_present_mode(vk, window_data) != vk->present_mode) {
+        vk->swapchain_dirty = true;
+    }
+    if (vk->swapchain_dirty) {
+        if (create_swapchain(vk, window_data) == false) {
+            return false;
+        }
+        if (vk->swapchain_dirty) {
+            return true;
+        }
+    }
+
+    if (vk->frame_width != window_data->buffer_width || vk->frame_height != window_data->buffer_height) {
+        if (create_staging(vk, window_data->buffer_width, window_data->buffer_height) == false) {
+            fprintf(stderr, "Cannot create the Vulkan staging buffer.\n");
+            return false;
+        }
+    }
+
+    // The next frame is number frame_count + 1. Its slot was used last by frame number frame_count + 1 - kFramesInFlight
+    slot = (uint32_t) (vk->frame_count % kFramesInFlight);
+    if (vk->frame_count >= kFramesInFlight) {
+        VkSemaphoreWaitInfo wait = { .sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO };
+
+        wait_value          = vk->frame_count + 1 - kFramesInFlight;
+        wait.semaphoreCount = 1;
+        wait.pSemaphores    = &vk->timeline;
+        wait.pValues        = &wait_value;
+        if (vkWaitSemaphores(vk->device, &wait, UINT64_MAX) != VK_SUCCESS) {
+            return false;
+        }
+    }
+
+    memcpy(vk->staging_ptr + slot * vk->slot_size, pixels, (size_t) vk->slot_size);
+
+    result = vkAcquireNextImageKHR(vk->device, vk->swapchain, kAcquireTimeout, vk->image_acquired[slot], VK_NULL_HANDLE, &image_index);
+    if (result == VK_ERROR_OUT_OF_DATE_KHR) {
+        vk->swapchain_dirty = true;
+        return true;
+    }
+    if (result == VK_TIMEOUT || result == VK_NOT_READY) {
+        return true;
+    }
+    if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR) {
+        fprintf(stderr, "Cannot acquire a Vulkan swapchain image (%d).\n", (int) result);
+        return false;
+    }
+    if (result == VK_SUBOPTIMAL_KHR) {
+        vk->swapchain_dirty = true;
+    }
+
+    if (record_frame(vk, window_data, vk->commands[slot], slot * vk->slot_size, vk->images[image_index]) == false) {
+        return false;
+    }
+
+    // The present waits on a binary semaphore, the next uses of the slot on the timeline
+    ++vk->frame_count;
+    signal[0]                               = vk->present_ready[image_index];
+    signal[1]                               = vk->timeline;
+    signal_values[0]                        = 0;
+    signal_values[1]                        = vk->frame_count;
+    timeline_info.signalSemaphoreValueCount = 2;
+    timeline_info.pSignalSemaphoreValues    = signal_values;
+
+    submit.pNext                = &timeline_info;
+    submit.waitSemaphoreCount   = 1;
+    submit.pWaitSemaphores      = &vk->image_acquired[slot];
+    submit.pWaitDstStageMask    = &wait_stage;
+    submit.commandBufferCount   = 1;
+    submit.pCommandBuffers      = &vk->commands[slot];
+    submit.signalSemaphoreCount = 2;
+    submit.pSignalSemaphores    = signal;
+    if (vkQueueSubmit(vk->queue, 1, &submit, VK_NULL_HANDLE) != VK_SUCCESS) {
+        fprintf(stderr, "Cannot submit the Vulkan frame.\n");
+        return false;
+    }
+
+    present.waitSemaphoreCount = 1;
+    present.pWaitSemaphores    = &vk->present_ready[image_index];
+    present.swapchainCount     = 1;
+    present.pSwapchains        = &vk->swapchain;
+    present.pImageIndices      = &image_index;
+    result = vkQueuePresentKHR(vk->queue, &present);
+    if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR) {
+        vk->swapchain_dirty = true;
+    }
+    else if (result != VK_SUCCESS) {
+        fprintf(stderr, "Cannot present the Vulkan frame (%d).\n", (int) result);
+        return false;
+    }
+
+    return true;
+}
+
+#endif
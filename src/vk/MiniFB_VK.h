@@ -0,0 +1,13 @@
+#pragma once
+
+#if defined(USE_VULKAN_API)
+
+    #include <WindowData.h>
+
+    // False when there is no usable Vulkan device: the backend keeps its software path
+    bool create_VK_context(SWindowData *window_data);
+    void destroy_VK_context(SWindowData *window_data);
+    bool redraw_VK(SWindowData *window_data, const void *pixels);
+    void resize_VK(SWindowData *window_data);
+
+#endif
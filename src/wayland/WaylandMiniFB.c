@@ -1,11 +1,25 @@
+#if defined(USE_RUNTIME_BACKEND)
+    #define kBackendPrefix  wayland_
+    #include "linux/LinuxBackend.h"
+#endif
+
 #include <MiniFB.h>
 #include "MiniFB_internal.h"
 #include "MiniFB_enums.h"
 #include "WindowData.h"
 #include "WindowData_Way.h"
+#include "relative-pointer-unstable-v1-client-protocol.h"
+#if defined(USE_OPENGL_API)
+    #include <gl/MiniFB_GL.h>
+#elif defined(USE_VULKAN_API)
+    #include <vk/MiniFB_VK.h>
+#endif
 
 #include <wayland-client.h>
 #include <wayland-cursor.h>
+#if defined(USE_OPENGL_API)
+    #include <EGL/egl.h>
+#endif
 
 #include <inttypes.h>
 #include <limits.h>
@@ -13,6 +27,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
+#include <poll.h>
 
 #include <linux/limits.h>
 #include <linux/input.h>
@@ -20,7 +35,123 @@
 
 #include <sys/mman.h>
 
-void init_keycodes();
+// A surface that can't be seen gets no frame callbacks: after this long (seconds) the window is reported as hidden
+#define kFrameTimeout   0.25
+
+static void init_keycodes(void);
+
+extern double   g_timer_resolution;
+extern uint64_t mfb_timer_tick(void);
+
+// All the windows of the process share one connection and its globals.
+// The seat is bound once: its devices route the events to the window of the focused surface
+typedef struct
+{
+    struct wl_display       *display;
+    struct wl_registry      *registry;
+    struct wl_compositor    *compositor;
+    struct wl_shell         *shell;
+    struct wl_shm           *shm;
+    struct wl_cursor_theme  *cursor_theme;
+    struct wl_cursor        *default_cursor;
+    struct zwp_relative_pointer_manager_v1 *relative_pointer_manager;
+    struct wl_seat          *seat;
+    uint32_t                seat_caps;
+    SInputDevicesWay        devices;            // Read on the main thread, for the windows without an input thread
+    uint32_t                shm_format;
+    uint32_t                ref_count;
+    SWindowData             *windows;
+} SConnectionWay;
+
+static SConnectionWay s_connection;
+
+static const struct wl_registry_listener registry_listener;
+
+static void update_devices(SInputDevicesWay *devices, unsigned mask, bool raw_motion);
+static void update_shared_devices(void);
+
+static bool
+acquire_connection(void)
+{
+    if (s_connection.ref_count == 0)
+    {
+        s_connection.shm_format = -1u;
+        s_connection.display = wl_display_connect(0x0);
+        if (!s_connection.display)
+            return false;
+
+        s_connection.registry = wl_display_get_registry(s_connection.display);
+        wl_registry_add_listener(s_connection.registry, &registry_listener, 0x0);
+
+        init_keycodes();
+
+        if (wl_display_dispatch(s_connection.display) == -1 ||
+            wl_display_roundtrip(s_connection.display) == -1) {
+            wl_registry_destroy(s_connection.registry);
+            wl_display_disconnect(s_connection.display);
+            memset(&s_connection, 0, sizeof(s_connection));
+            return false;
+        }
+    }
+
+    ++s_connection.ref_count;
+    return true;
+}
+
+static void
+release_connection(void)
+{
+    if (s_connection.ref_count == 0 || --s_connection.ref_count > 0)
+        return;
+
+#define KILL(NAME)                                      \
+    do                                                  \
+    {                                                   \
+        if (s_connection.NAME)                          \
+            wl_##NAME##_destroy(s_connection.NAME);     \
+    } while (0);                                        \
+    s_connection.NAME = 0x0;
+
+    update_devices(&s_connection.devices, 0, false);
+    if (s_connection.relative_pointer_manager)
+        zwp_relative_pointer_manager_v1_destroy(s_connection.relative_pointer_manager);
+    if (s_connection.cursor_theme)
+        wl_cursor_theme_destroy(s_connection.cursor_theme);
+    KILL(seat);
+    KILL(shell);
+    KILL(shm);
+    KILL(compositor);
+    KILL(registry);
+#undef KILL
+#if defined(USE_OPENGL_API)
+    // The windows share the EGL display of the connection
+    eglTerminate(eglGetDisplay((EGLNativeDisplayType) s_connection.display));
+#endif
+    wl_display_disconnect(s_connection.display);
+    memset(&s_connection, 0, sizeof(s_connection));
+}
+
+static void
+register_window(SWindowData *window_data)
+{
+    SWindowData_Way *window_data_way = (SWindowData_Way *) window_data->specific;
+
+    window_data_way->next = s_connection.windows;
+    s_connection.windows  = window_data;
+}
+
+static void
+unregister_window(SWindowData *window_data)
+{
+    for (SWindowData **link = &s_connection.windows; *link != 0x0; link = &((SWindowData_Way *) (*link)->specific)->next)
+    {
+        if (*link == window_data)
+        {
+            *link = ((SWindowData_Way *) window_data->specific)->next;
+            break;
+        }
+    }
+}
 
 static void
 destroy_window_data(SWindowData *window_data)
@@ -34,6 +165,7 @@ destroy_window_data(SWindowData *window_data)
         memset(window_data_way, 0, sizeof(SWindowData_Way));
         free(window_data_way);
     }
+    destroy_window_data_common(window_data);
     memset(window_data, 0, sizeof(SWindowData));
     free(window_data);
 }
@@ -50,6 +182,14 @@ destroy(SWindowData *window_data)
         return;
     }
 
+    stop_input_thread(window_data);
+    unregister_window(window_data);
+    if (s_connection.devices.keyboard_focus == window_data)
+        s_connection.devices.keyboard_focus = 0x0;
+    if (s_connection.devices.pointer_focus == window_data)
+        s_connection.devices.pointer_focus = 0x0;
+    update_shared_devices();
+
 #define KILL(NAME)                                      \
     do                                                  \
     {                                                   \
@@ -58,25 +198,61 @@ destroy(SWindowData *window_data)
     } while (0);                                        \
     window_data_way->NAME = 0x0;
 
+    if (window_data_way->frame_callback) {
+        wl_callback_destroy(window_data_way->frame_callback);
+        window_data_way->frame_callback = 0x0;
+    }
+#if defined(USE_OPENGL_API)
+    destroy_GL_context(window_data);
+#elif defined(USE_VULKAN_API)
+    destroy_VK_context(window_data);
+#endif
     KILL(shell_surface);
-    KILL(shell);
     KILL(surface);
     //KILL(buffer);
     if(window_data->draw_buffer) {
         wl_buffer_destroy(window_data->draw_buffer);
         window_data->draw_buffer = 0x0;
     }
+    if(window_data_way->cursor_surface) {
+        wl_surface_destroy(window_data_way->cursor_surface);
+        window_data_way->cursor_surface = 0x0;
+    }
     KILL(shm_pool);
-    KILL(shm);
-    KILL(compositor);
-    KILL(keyboard);
-    KILL(seat);
-    KILL(registry);
 #undef KILL
-    wl_display_disconnect(window_data_way->display);
+    release_connection();
 
+    if (window_data_way->fd >= 0)
+        close(window_data_way->fd);
     destroy_window_data(window_data);
-    close(window_data_way->fd);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// The window of a surface the devices entered. The devices of a window only know its surface
+static SWindowData *
+find_window(SInputDevicesWay *devices, struct wl_surface *surface)
+{
+    if (devices->owner != 0x0)
+        return ((SWindowData_Way *) devices->owner->specific)->surface == surface ? devices->owner : 0x0;
+
+    for (SWindowData *window_data = s_connection.windows; window_data != 0x0; window_data = ((SWindowData_Way *) window_data->specific)->next)
+    {
+        if (((SWindowData_Way *) window_data->specific)->surface == surface)
+            return window_data;
+    }
+    return 0x0;
+}
+
+// The shared devices keep following the focus of a window with an input thread, but its own devices report for it
+static SWindowData *
+target_window(SInputDevicesWay *devices, SWindowData *focus)
+{
+    if (focus == 0x0)
+        return 0x0;
+    if (devices->owner == 0x0 && ((SWindowData_Way *) focus->specific)->devices.queue != 0x0)
+        return 0x0;
+    return focus;
 }
 
 // This event provides a file descriptor to the client which can be memory-mapped
@@ -90,8 +266,9 @@ keyboard_keymap(void *data, struct wl_keyboard *keyboard, uint32_t format, int f
     kUnused(data);
     kUnused(keyboard);
     kUnused(format);
-    kUnused(fd);
     kUnused(size);
+    // The keys go through g_keycodes, the keymap is not read
+    close(fd);
 }
 
 // Notification that this seat's keyboard focus is on a certain surface.
@@ -103,12 +280,19 @@ keyboard_enter(void *data, struct wl_keyboard *keyboard, uint32_t serial, struct
 {
     kUnused(keyboard);
     kUnused(serial);
-    kUnused(surface);
     kUnused(keys);
 
-    SWindowData *window_data = (SWindowData *) data;
+    SInputDevicesWay *devices = (SInputDevicesWay *) data;
+    devices->keyboard_focus = find_window(devices, surface);
+
+    SWindowData *window_data = target_window(devices, devices->keyboard_focus);
+    if (window_data == 0x0)
+        return;
     window_data->is_active = true;
-    kCall(active_func, true);
+    if (window_data->disabled_events & EVENT_MASK_FOCUS)
+        return;
+    record_event_time(window_data, 0);
+    kEvent(active, true);
 }
 
 // The leave notification is sent before the enter notification for the new focus.
@@ -121,9 +305,16 @@ keyboard_leave(void *data, struct wl_keyboard *keyboard, uint32_t serial, struct
     kUnused(serial);
     kUnused(surface);
 
-    SWindowData *window_data = (SWindowData *) data;
+    SInputDevicesWay *devices = (SInputDevicesWay *) data;
+    SWindowData      *window_data = target_window(devices, devices->keyboard_focus);
+    devices->keyboard_focus = 0x0;
+    if (window_data == 0x0)
+        return;
     window_data->is_active = false;
-    kCall(active_func, false);
+    if (window_data->disabled_events & EVENT_MASK_FOCUS)
+        return;
+    record_event_time(window_data, 0);
+    kEvent(active, false);
 }
 
 // A key was pressed or released. The time argument is a timestamp with
@@ -137,9 +328,14 @@ keyboard_key(void *data, struct wl_keyboard *keyboard, uint32_t serial, uint32_t
 {
     kUnused(keyboard);
     kUnused(serial);
-    kUnused(time);
 
-    SWindowData *window_data = (SWindowData *) data;
+    SInputDevicesWay *devices = (SInputDevicesWay *) data;
+    SWindowData      *window_data = target_window(devices, devices->keyboard_focus);
+    if (window_data == 0x0)
+        return;
+    if (window_data->disabled_events & EVENT_MASK_KEYBOARD)
+        return;
+    record_event_time(window_data, time);
     if(key < 512) {
         mfb_key key_code = (mfb_key) g_keycodes[key];
         bool   is_pressed = (bool) (state == WL_KEYBOARD_KEY_STATE_PRESSED);
@@ -179,7 +375,7 @@ keyboard_key(void *data, struct wl_keyboard *keyboard, uint32_t serial, uint32_t
         }
 
         window_data->key_status[key_code] = is_pressed;
-        kCall(keyboard_func, key_code, (mfb_key_mod) window_data->mod_keys, is_pressed);
+        kEvent(keyboard, key_code, (mfb_key_mod) window_data->mod_keys, is_pressed);
     }
 }
 
@@ -242,16 +438,30 @@ pointer_enter(void *data, struct wl_pointer *pointer, uint32_t serial, struct wl
 {
     //kUnused(pointer);
     //kUnused(serial);
-    kUnused(surface);
     kUnused(sx);
     kUnused(sy);
     struct wl_buffer *buffer;
     struct wl_cursor_image *image;
 
-    SWindowData *window_data = (SWindowData *) data;
+    SInputDevicesWay *devices = (SInputDevicesWay *) data;
+    devices->pointer_focus = find_window(devices, surface);
+
+    SWindowData *window_data = target_window(devices, devices->pointer_focus);
+    if (window_data == 0x0)
+        return;
     SWindowData_Way *window_data_way = (SWindowData_Way *) window_data->specific;
 
-    image  = window_data_way->default_cursor->images[0];
+    // Loading the theme reads its files: done the first time the pointer is over a window, not when it opens
+    if (s_connection.cursor_theme == 0x0)
+    {
+        s_connection.cursor_theme = wl_cursor_theme_load(0x0, 32, s_connection.shm);
+        if (s_connection.cursor_theme != 0x0)
+            s_connection.default_cursor = wl_cursor_theme_get_cursor(s_connection.cursor_theme, "left_ptr");
+    }
+    if (s_connection.default_cursor == 0x0)
+        return;
+
+    image  = s_connection.default_cursor->images[0];
     buffer = wl_cursor_image_get_buffer(image);
 
     wl_pointer_set_cursor(pointer, serial, window_data_way->cursor_surface, image->hotspot_x, image->hotspot_y);
@@ -270,11 +480,12 @@ pointer_enter(void *data, struct wl_pointer *pointer, uint32_t serial, struct wl
 static void
 pointer_leave(void *data, struct wl_pointer *pointer, uint32_t serial, struct wl_surface *surface)
 {
-    kUnused(data);
     kUnused(pointer);
     kUnused(serial);
     kUnused(surface);
 
+    SInputDevicesWay *devices = (SInputDevicesWay *) data;
+    devices->pointer_focus = 0x0;
     //fprintf(stderr, "Pointer left surface %p\n", surface);
 }
 
@@ -289,13 +500,18 @@ static void
 pointer_motion(void *data, struct wl_pointer *pointer, uint32_t time, wl_fixed_t sx, wl_fixed_t sy)
 {
     kUnused(pointer);
-    kUnused(time);
 
     //printf("Pointer moved at %f %f\n", sx / 256.0f, sy / 256.0f);
-    SWindowData *window_data = (SWindowData *) data;
+    SInputDevicesWay *devices = (SInputDevicesWay *) data;
+    SWindowData      *window_data = target_window(devices, devices->pointer_focus);
+    if (window_data == 0x0)
+        return;
+    if (window_data->disabled_events & EVENT_MASK_MOUSE_MOVE)
+        return;
+    record_event_time(window_data, time);
     window_data->mouse_pos_x = sx >> 24;
     window_data->mouse_pos_y = sy >> 24;
-    kCall(mouse_move_func, window_data->mouse_pos_x, window_data->mouse_pos_y);
+    kEvent(mouse_move, window_data->mouse_pos_x, window_data->mouse_pos_y);
 }
 
 // Mouse button click and release notifications.
@@ -321,12 +537,17 @@ pointer_button(void *data, struct wl_pointer *pointer, uint32_t serial, uint32_t
 {
     kUnused(pointer);
     kUnused(serial);
-    kUnused(time);
 
     //printf("Pointer button '%d'(%d)\n", button, state);
-    SWindowData *window_data = (SWindowData *) data;
+    SInputDevicesWay *devices = (SInputDevicesWay *) data;
+    SWindowData      *window_data = target_window(devices, devices->pointer_focus);
+    if (window_data == 0x0)
+        return;
+    if (window_data->disabled_events & EVENT_MASK_MOUSE_BUTTON)
+        return;
+    record_event_time(window_data, time);
     window_data->mouse_button_status[(button - BTN_MOUSE + 1) & 0x07] = (state == 1);
-    kCall(mouse_btn_func, (mfb_mouse_button) (button - BTN_MOUSE + 1), (mfb_key_mod) window_data->mod_keys, state == 1);
+    kEvent(mouse_btn, (mfb_mouse_button) (button - BTN_MOUSE + 1), (mfb_key_mod) window_data->mod_keys, state == 1);
 }
 
 //  Scroll and other axis notifications.
@@ -353,18 +574,23 @@ static void
 pointer_axis(void *data, struct wl_pointer *pointer, uint32_t time, uint32_t axis, wl_fixed_t value)
 {
     kUnused(pointer);
-    kUnused(time);
     kUnused(axis);
 
     //printf("Pointer handle axis: axis: %d (0x%x)\n", axis, value);
-    SWindowData *window_data = (SWindowData *) data;
+    SInputDevicesWay *devices = (SInputDevicesWay *) data;
+    SWindowData      *window_data = target_window(devices, devices->pointer_focus);
+    if (window_data == 0x0)
+        return;
+    if (window_data->disabled_events & EVENT_MASK_MOUSE_BUTTON)
+        return;
+    record_event_time(window_data, time);
     if(axis == 0) {
         window_data->mouse_wheel_y = -(value / 256.0f);
-        kCall(mouse_wheel_func, (mfb_key_mod) window_data->mod_keys, 0.0f, window_data->mouse_wheel_y);
+        kEvent(mouse_wheel, (mfb_key_mod) window_data->mod_keys, 0.0f, window_data->mouse_wheel_y);
     }
     else if(axis == 1) {
         window_data->mouse_wheel_x = -(value / 256.0f);
-        kCall(mouse_wheel_func, (mfb_key_mod) window_data->mod_keys, window_data->mouse_wheel_x, 0.0f);
+        kEvent(mouse_wheel, (mfb_key_mod) window_data->mod_keys, window_data->mouse_wheel_x, 0.0f);
     }
 }
 
@@ -410,36 +636,127 @@ wl_pointer_listener pointer_listener = {
     .axis_discrete = 0x0,
 };
 
-///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Relative motion, only while the pointer is over the surface.
+static void
+relative_pointer_motion(void *data, struct zwp_relative_pointer_v1 *relative_pointer, uint32_t utime_hi, uint32_t utime_lo, wl_fixed_t dx, wl_fixed_t dy, wl_fixed_t dx_unaccel, wl_fixed_t dy_unaccel)
+{
+    kUnused(relative_pointer);
+    kUnused(dx);
+    kUnused(dy);
+
+    SInputDevicesWay *devices = (SInputDevicesWay *) data;
+    SWindowData      *window_data = target_window(devices, devices->pointer_focus);
+    if (window_data == 0x0)
+        return;
+    queue_raw_motion(window_data, ((uint64_t) utime_hi << 32) | utime_lo, (float) wl_fixed_to_double(dx_unaccel), (float) wl_fixed_to_double(dy_unaccel));
+}
+
+static const struct
+zwp_relative_pointer_v1_listener relative_pointer_listener = {
+    .relative_motion = relative_pointer_motion,
+};
 
+// Only the devices whose events the windows subscribed to are requested
 static void
-seat_capabilities(void *data, struct wl_seat *seat, enum wl_seat_capability caps)
+update_devices(SInputDevicesWay *devices, unsigned mask, bool raw_motion)
 {
-    kUnused(data);
+    bool use_keyboard = (s_connection.seat_caps & WL_SEAT_CAPABILITY_KEYBOARD) && (mask & (EVENT_MASK_KEYBOARD | EVENT_MASK_FOCUS));
+    bool use_pointer  = (s_connection.seat_caps & WL_SEAT_CAPABILITY_POINTER) && (mask & (EVENT_MASK_MOUSE_BUTTON | EVENT_MASK_MOUSE_MOVE));
+    bool use_relative = raw_motion && use_pointer && s_connection.relative_pointer_manager;
 
-    SWindowData         *window_data = (SWindowData *) data;
-    SWindowData_Way   *window_data_way = (SWindowData_Way *) window_data->specific;
-    if ((caps & WL_SEAT_CAPABILITY_KEYBOARD) && !window_data_way->keyboard)
+    if (use_keyboard && !devices->keyboard)
+    {
+        devices->keyboard = wl_seat_get_keyboard(s_connection.seat);
+        wl_keyboard_add_listener(devices->keyboard, &keyboard_listener, devices);
+        if (devices->queue)
+            wl_proxy_set_queue((struct wl_proxy *) devices->keyboard, devices->queue);
+    }
+    else if (!use_keyboard && devices->keyboard)
     {
-        window_data_way->keyboard = wl_seat_get_keyboard(seat);
-        wl_keyboard_add_listener(window_data_way->keyboard, &keyboard_listener, window_data);
+        wl_keyboard_destroy(devices->keyboard);
+        devices->keyboard       = 0x0;
+        devices->keyboard_focus = 0x0;
     }
-    else if (!(caps & WL_SEAT_CAPABILITY_KEYBOARD) && window_data_way->keyboard)
+
+    // The relative pointer follows the pointer. It must go before the pointer does
+    if (!use_relative && devices->relative_pointer)
+    {
+        zwp_relative_pointer_v1_destroy(devices->relative_pointer);
+        devices->relative_pointer = 0x0;
+    }
+
+    if (use_pointer && !devices->pointer)
+    {
+        devices->pointer = wl_seat_get_pointer(s_connection.seat);
+        wl_pointer_add_listener(devices->pointer, &pointer_listener, devices);
+        if (devices->queue)
+            wl_proxy_set_queue((struct wl_proxy *) devices->pointer, devices->queue);
+    }
+    else if (!use_pointer && devices->pointer)
     {
-        wl_keyboard_destroy(window_data_way->keyboard);
-        window_data_way->keyboard = 0x0;
+        wl_pointer_destroy(devices->pointer);
+        devices->pointer       = 0x0;
+        devices->pointer_focus = 0x0;
     }
 
-    if ((caps & WL_SEAT_CAPABILITY_POINTER) && !window_data_way->pointer)
+    if (use_relative && !devices->relative_pointer)
     {
-        window_data_way->pointer = wl_seat_get_pointer(seat);
-        wl_pointer_add_listener(window_data_way->pointer, &pointer_listener, window_data);
+        devices->relative_pointer = zwp_relative_pointer_manager_v1_get_relative_pointer(s_connection.relative_pointer_manager, devices->pointer);
+        zwp_relative_pointer_v1_add_listener(devices->relative_pointer, &relative_pointer_listener, devices);
+        if (devices->queue)
+            wl_proxy_set_queue((struct wl_proxy *) devices->relative_pointer, devices->queue);
     }
-    else if (!(caps & WL_SEAT_CAPABILITY_POINTER) && window_data_way->pointer)
+}
+
+// The shared devices serve the events of all the windows read on the main thread
+static void
+update_shared_devices(void)
+{
+    unsigned mask       = 0;
+    bool     raw_motion = false;
+
+    for (SWindowData *window_data = s_connection.windows; window_data != 0x0; window_data = ((SWindowData_Way *) window_data->specific)->next)
     {
-        wl_pointer_destroy(window_data_way->pointer);
-        window_data_way->pointer = 0x0;
+        SWindowData_Way *window_data_way = (SWindowData_Way *) window_data->specific;
+        if (window_data_way->devices.queue != 0x0)
+            continue;
+        mask       |= mfb_get_event_mask((struct mfb_window *) window_data);
+        raw_motion |= window_data_way->raw_motion;
     }
+
+    update_devices(&s_connection.devices, mask, raw_motion);
+}
+
+static void
+apply_event_mask(SWindowData *window_data)
+{
+    kUnused(window_data);
+    update_shared_devices();
+}
+
+static bool
+setup_raw_motion(SWindowData *window_data, bool enable)
+{
+    SWindowData_Way *window_data_way = (SWindowData_Way *) window_data->specific;
+
+    if (s_connection.relative_pointer_manager == 0x0)
+        return enable == false;
+
+    window_data_way->raw_motion = enable;
+    update_shared_devices();
+
+    return true;
+}
+
+// A window with an input thread picks the new capabilities up the next time its thread starts
+static void
+seat_capabilities(void *data, struct wl_seat *seat, enum wl_seat_capability caps)
+{
+    kUnused(data);
+    kUnused(seat);
+
+    s_connection.seat_caps = caps;
+    update_shared_devices();
 }
 
 static void
@@ -466,18 +783,17 @@ wl_seat_listener seat_listener = {
 static void
 shm_format(void *data, struct wl_shm *shm, uint32_t format)
 {
+    kUnused(data);
     kUnused(shm);
 
-    SWindowData         *window_data     = (SWindowData *) data;
-    SWindowData_Way   *window_data_way = (SWindowData_Way *) window_data->specific;
-    if (window_data_way->shm_format == -1u)
+    if (s_connection.shm_format == -1u)
     {
         switch (format)
         {
             // We could do RGBA, but that would not be what is expected from minifb...
             // case WL_SHM_FORMAT_ARGB8888:
             case WL_SHM_FORMAT_XRGB8888:
-                window_data_way->shm_format = format;
+                s_connection.shm_format = format;
             break;
 
             default:
@@ -493,38 +809,42 @@ wl_shm_listener shm_listener = {
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
+// The globals are bound once for all the windows
 static void
 registry_global(void *data, struct wl_registry *registry, uint32_t id, char const *iface, uint32_t version)
 {
+    kUnused(data);
     kUnused(version);
 
-    SWindowData         *window_data     = (SWindowData *) data;
-    SWindowData_Way   *window_data_way = (SWindowData_Way *) window_data->specific;
     if (strcmp(iface, "wl_compositor") == 0)
     {
-        window_data_way->compositor = (struct wl_compositor *) wl_registry_bind(registry, id, &wl_compositor_interface, 1);
+        s_connection.compositor = (struct wl_compositor *) wl_registry_bind(registry, id, &wl_compositor_interface, 1);
     }
     else if (strcmp(iface, "wl_shm") == 0)
     {
-        window_data_way->shm = (struct wl_shm *) wl_registry_bind(registry, id, &wl_shm_interface, 1);
-        if (window_data_way->shm) {
-            wl_shm_add_listener(window_data_way->shm, &shm_listener, window_data);
-            window_data_way->cursor_theme = wl_cursor_theme_load(0x0, 32, window_data_way->shm);
-            window_data_way->default_cursor = wl_cursor_theme_get_cursor(window_data_way->cursor_theme, "left_ptr");
+        s_connection.shm = (struct wl_shm *) wl_registry_bind(registry, id, &wl_shm_interface, 1);
+        if (s_connection.shm) {
+            wl_shm_add_listener(s_connection.shm, &shm_listener, 0x0);
         }
     }
     else if (strcmp(iface, "wl_shell") == 0)
     {
-        window_data_way->shell = (struct wl_shell *) wl_registry_bind(registry, id, &wl_shell_interface, 1);
+        s_connection.shell = (struct wl_shell *) wl_registry_bind(registry, id, &wl_shell_interface, 1);
     }
     else if (strcmp(iface, "wl_seat") == 0)
     {
-        window_data_way->seat = (struct wl_seat *) wl_registry_bind(registry, id, &wl_seat_interface, 1);
-        if (window_data_way->seat)
+        // The first seat serves all the windows
+        if (s_connection.seat == 0x0)
         {
-            wl_seat_add_listener(window_data_way->seat, &seat_listener, window_data);
+            s_connection.seat = (struct wl_seat *) wl_registry_bind(registry, id, &wl_seat_interface, 1);
+            if (s_connection.seat)
+                wl_seat_add_listener(s_connection.seat, &seat_listener, 0x0);
         }
     }
+    else if (strcmp(iface, "zwp_relative_pointer_manager_v1") == 0)
+    {
+        s_connection.relative_pointer_manager = (struct zwp_relative_pointer_manager_v1 *) wl_registry_bind(registry, id, &zwp_relative_pointer_manager_v1_interface, 1);
+    }
 }
 
 static const struct
@@ -565,6 +885,58 @@ static const struct wl_shell_surface_listener shell_surface_listener = {
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
+// The shared devices are dispatched by the main thread: the window gets its own keyboard and pointer
+// from the seat, on an event queue only its input thread dispatches
+static bool
+setup_input_thread(SWindowData *window_data, bool enable)
+{
+    SWindowData_Way *window_data_way = (SWindowData_Way *) window_data->specific;
+
+    if (enable) {
+        window_data_way->devices.queue = wl_display_create_queue(window_data_way->display);
+        if (window_data_way->devices.queue == 0x0)
+            return false;
+        update_devices(&window_data_way->devices, mfb_get_event_mask((struct mfb_window *) window_data), window_data_way->raw_motion);
+        update_shared_devices();
+        return true;
+    }
+    if (window_data_way->devices.queue == 0x0)
+        return true;
+
+    // Whatever the thread did not read goes to the callbacks
+    wl_display_dispatch_queue_pending(window_data_way->display, window_data_way->devices.queue);
+    update_devices(&window_data_way->devices, 0, false);
+    wl_event_queue_destroy(window_data_way->devices.queue);
+    window_data_way->devices.queue = 0x0;
+    update_shared_devices();
+
+    return true;
+}
+
+// Runs on the input thread
+static void
+pump_input(SWindowData *window_data, int timeout_ms)
+{
+    SWindowData_Way *window_data_way = (SWindowData_Way *) window_data->specific;
+    struct pollfd   fd = { wl_display_get_fd(window_data_way->display), POLLIN, 0 };
+
+    while (wl_display_prepare_read_queue(window_data_way->display, window_data_way->devices.queue) != 0) {
+        wl_display_dispatch_queue_pending(window_data_way->display, window_data_way->devices.queue);
+    }
+    wl_display_flush(window_data_way->display);
+
+    if (poll(&fd, 1, timeout_ms) > 0) {
+        wl_display_read_events(window_data_way->display);
+    }
+    else {
+        wl_display_cancel_read(window_data_way->display);
+    }
+
+    wl_display_dispatch_queue_pending(window_data_way->display, window_data_way->devices.queue);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
 struct mfb_window *
 mfb_open_ex(const char *title, unsigned width, unsigned height, unsigned flags)
 {
@@ -582,30 +954,26 @@ mfb_open_ex(const char *title, unsigned width, unsigned height, unsigned flags)
     memset(window_data_way, 0, sizeof(SWindowData_Way));
     window_data->specific = window_data_way;
 
-    window_data_way->shm_format = -1u;
+    window_data_way->fd = -1;
 
-    window_data_way->display = wl_display_connect(0x0);
-    if (!window_data_way->display) {
+    if (acquire_connection() == false) {
         free(window_data);
         free(window_data_way);
         return 0x0;
     }
-    window_data_way->registry = wl_display_get_registry(window_data_way->display);
-    wl_registry_add_listener(window_data_way->registry, &registry_listener, window_data);
-
-    init_keycodes();
-
-    if (wl_display_dispatch(window_data_way->display) == -1 ||
-        wl_display_roundtrip(window_data_way->display) == -1) {
-        return 0x0;
-    }
+    window_data_way->display = s_connection.display;
 
+#if !defined(USE_OPENGL_API)
     // did not get a format we want... meh
-    if (window_data_way->shm_format == -1u)
+    if (s_connection.shm_format == -1u)
         goto out;
-    if (!window_data_way->compositor)
+#endif
+    if (!s_connection.compositor)
         goto out;
 
+    window_data_way->devices.owner = window_data;
+
+#if !defined(USE_OPENGL_API)
     char const *xdg_rt_dir = getenv("XDG_RUNTIME_DIR");
     char shmfile[PATH_MAX];
     uint32_t ret = snprintf(shmfile, sizeof(shmfile), "%s/WaylandMiniFB-SHM-XXXXXX", xdg_rt_dir);
@@ -625,6 +993,7 @@ mfb_open_ex(const char *title, unsigned width, unsigned height, unsigned flags)
     window_data_way->shm_ptr = (uint32_t *) mmap(0x0, length, PROT_WRITE, MAP_SHARED, window_data_way->fd, 0);
     if (window_data_way->shm_ptr == MAP_FAILED)
         goto out;
+#endif
 
     window_data->window_width  = width;
     window_data->window_height = height;
@@ -633,21 +1002,26 @@ mfb_open_ex(const char *title, unsigned width, unsigned height, unsigned flags)
     window_data->buffer_stride = width * sizeof(uint32_t);
     calc_dst_factor(window_data, width, height);
 
-    window_data_way->shm_pool  = wl_shm_create_pool(window_data_way->shm, window_data_way->fd, length);
+#if !defined(USE_OPENGL_API)
+    window_data_way->shm_pool  = wl_shm_create_pool(s_connection.shm, window_data_way->fd, length);
     window_data->draw_buffer   = wl_shm_pool_create_buffer(window_data_way->shm_pool, 0,
                                     window_data->buffer_width, window_data->buffer_height,
-                                    window_data->buffer_stride, window_data_way->shm_format);
+                                    window_data->buffer_stride, s_connection.shm_format);
+#endif
 
-    window_data_way->surface = wl_compositor_create_surface(window_data_way->compositor);
+    window_data_way->surface = wl_compositor_create_surface(s_connection.compositor);
     if (!window_data_way->surface)
         goto out;
+    // Known to the shared devices before the compositor can give it the focus
+    register_window(window_data);
+    update_shared_devices();
 
-    window_data_way->cursor_surface = wl_compositor_create_surface(window_data_way->compositor);
+    window_data_way->cursor_surface = wl_compositor_create_surface(s_connection.compositor);
 
     // There should always be a shell, right?
-    if (window_data_way->shell)
+    if (s_connection.shell)
     {
-        window_data_way->shell_surface = wl_shell_get_shell_surface(window_data_way->shell, window_data_way->surface);
+        window_data_way->shell_surface = wl_shell_get_shell_surface(s_connection.shell, window_data_way->surface);
         if (!window_data_way->shell_surface)
             goto out;
 
@@ -656,14 +1030,36 @@ mfb_open_ex(const char *title, unsigned width, unsigned height, unsigned flags)
         wl_shell_surface_set_toplevel(window_data_way->shell_surface);
     }
 
-    wl_surface_attach(window_data_way->surface, (struct wl_buffer *) window_data->draw_buffer, window_data->dst_offset_x, window_data->dst_offset_y);
-    wl_surface_damage(window_data_way->surface, window_data->dst_offset_x, window_data->dst_offset_y, window_data->dst_width, window_data->dst_height);
-    wl_surface_commit(window_data_way->surface);
+#if defined(USE_OPENGL_API)
+    // The window is mapped by the first frame
+    if (create_GL_context(window_data) == false)
+        goto out;
+#else
+#if defined(USE_VULKAN_API)
+    // The window is mapped by the first frame. The shm buffer stays for when there is no Vulkan
+    if (create_VK_context(window_data) == false)
+        fprintf(stderr, "Cannot create the Vulkan context, using shm buffers.\n");
+    if (window_data_way->vulkan == 0x0)
+#endif
+    {
+        wl_surface_attach(window_data_way->surface, (struct wl_buffer *) window_data->draw_buffer, window_data->dst_offset_x, window_data->dst_offset_y);
+        wl_surface_damage(window_data_way->surface, window_data->dst_offset_x, window_data->dst_offset_y, window_data->dst_width, window_data->dst_height);
+        wl_surface_commit(window_data_way->surface);
+    }
+#endif
+
+    if (wl_display_roundtrip(window_data_way->display) == -1)
+        goto out;
 
     window_data_way->timer = mfb_timer_create();
 
     mfb_set_keyboard_callback((struct mfb_window *) window_data, keyboard_default);
 
+    window_data->setup_input_thread = setup_input_thread;
+    window_data->pump_input         = pump_input;
+    window_data->apply_event_mask   = apply_event_mask;
+    window_data->setup_raw_motion   = setup_raw_motion;
+
 #if defined(_DEBUG) || defined(DEBUG)
     printf("Window created using Wayland API\n");
 #endif
@@ -672,7 +1068,6 @@ mfb_open_ex(const char *title, unsigned width, unsigned height, unsigned flags)
     return (struct mfb_window *) window_data;
 
 out:
-    close(window_data_way->fd);
     destroy(window_data);
 
     return 0x0;
@@ -686,10 +1081,15 @@ out:
 static void
 frame_done(void *data, struct wl_callback *callback, uint32_t cookie)
 {
+    SWindowData     *window_data     = (SWindowData *) data;
+    SWindowData_Way *window_data_way = (SWindowData_Way *) window_data->specific;
+
     kUnused(cookie);
     wl_callback_destroy(callback);
+    window_data_way->frame_callback = 0x0;
 
-    *(uint32_t *)data = 1;
+    // The compositor draws the surface again
+    set_window_hidden(window_data, false);
 }
 
 static const struct
@@ -697,30 +1097,70 @@ wl_callback_listener frame_listener = {
     .done = frame_done,
 };
 
-///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-
-mfb_update_state
-mfb_update_ex(struct mfb_window *window, void *buffer, unsigned width, unsigned height)
+// Called before the commit. While the window is hidden the callback of an earlier commit is still pending, and tells when it is shown
+static bool
+request_frame(SWindowData *window_data)
 {
-    uint32_t done = 0;
+    SWindowData_Way *window_data_way = (SWindowData_Way *) window_data->specific;
 
-    if(window == 0x0) {
-        return STATE_INVALID_WINDOW;
+    if (window_data_way->frame_callback == 0x0) {
+        window_data_way->frame_callback = wl_surface_frame(window_data_way->surface);
+        if (!window_data_way->frame_callback) {
+            return false;
+        }
+        wl_callback_add_listener(window_data_way->frame_callback, &frame_listener, window_data);
     }
 
-    SWindowData *window_data = (SWindowData *) window;
-    if(window_data->close) {
-        destroy(window_data);
-        return STATE_EXIT;
+    return true;
+}
+
+// Reads what arrives within timeout_ms (0: only what is already there) and dispatches the default queue
+static int
+read_events(struct wl_display *display, int timeout_ms)
+{
+    struct pollfd fd = { wl_display_get_fd(display), POLLIN, 0 };
+
+    while (wl_display_prepare_read(display) != 0) {
+        wl_display_dispatch_pending(display);
+    }
+    wl_display_flush(display);
+    if (poll(&fd, 1, timeout_ms) > 0) {
+        wl_display_read_events(display);
+    }
+    else {
+        wl_display_cancel_read(display);
     }
 
-    if(buffer == 0x0) {
-        return STATE_INVALID_BUFFER;
+    return wl_display_dispatch_pending(display);
+}
+
+// Waits until the compositor shows the last commit, or reports the window as hidden when it doesn't
+static bool
+wait_frame(SWindowData *window_data)
+{
+    SWindowData_Way *window_data_way = (SWindowData_Way *) window_data->specific;
+    uint64_t        start            = mfb_timer_tick();
+    double          waited;
+
+    while (window_data_way->frame_callback != 0x0 && window_data->close == false) {
+        waited = (double) (mfb_timer_tick() - start) * g_timer_resolution;
+        if (waited >= kFrameTimeout) {
+            set_window_hidden(window_data, true);
+            break;
+        }
+        if (read_events(window_data_way->display, (int) ((kFrameTimeout - waited) * 1000.0) + 1) == -1) {
+            return false;
+        }
     }
 
-    SWindowData_Way   *window_data_way = (SWindowData_Way *) window_data->specific;
-    if (!window_data_way->display || wl_display_get_error(window_data_way->display) != 0)
-        return STATE_INTERNAL_ERROR;
+    return true;
+}
+
+// Copies the frame to the shm buffer (made again when the frame has another size) and commits it
+static bool
+present_shm(SWindowData *window_data, void *buffer, unsigned width, unsigned height)
+{
+    SWindowData_Way *window_data_way = (SWindowData_Way *) window_data->specific;
 
     if(window_data->buffer_width != width || window_data->buffer_height != height) {
         uint32_t oldLength = sizeof(uint32_t) * window_data->buffer_width * window_data->buffer_height;
@@ -729,12 +1169,12 @@ mfb_update_ex(struct mfb_window *window, void *buffer, unsigned width, unsigned
         // For some reason it crash when you make it smaller
         if(oldLength < length) {
             if (ftruncate(window_data_way->fd, length) == -1)
-                return STATE_INTERNAL_ERROR;
+                return false;
 
             //munmap(window_data_way->shm_ptr, sizeof(uint32_t) * window_data->buffer_width * window_data->buffer_height);
             window_data_way->shm_ptr = (uint32_t *) mmap(0x0, length, PROT_WRITE, MAP_SHARED, window_data_way->fd, 0);
             if (window_data_way->shm_ptr == MAP_FAILED)
-                return STATE_INTERNAL_ERROR;
+                return false;
 
             wl_shm_pool_resize(window_data_way->shm_pool, length);
         }
@@ -749,7 +1189,7 @@ mfb_update_ex(struct mfb_window *window, void *buffer, unsigned width, unsigned
         wl_buffer_destroy(window_data->draw_buffer);
         window_data->draw_buffer = wl_shm_pool_create_buffer(window_data_way->shm_pool, 0,
                                         window_data->buffer_width, window_data->buffer_height,
-                                        window_data->buffer_stride, window_data_way->shm_format);
+                                        window_data->buffer_stride, s_connection.shm_format);
     }
 
     // update shm buffer
@@ -757,19 +1197,90 @@ mfb_update_ex(struct mfb_window *window, void *buffer, unsigned width, unsigned
 
     wl_surface_attach(window_data_way->surface, (struct wl_buffer *) window_data->draw_buffer, window_data->dst_offset_x, window_data->dst_offset_y);
     wl_surface_damage(window_data_way->surface, window_data->dst_offset_x, window_data->dst_offset_y, window_data->dst_width, window_data->dst_height);
-    struct wl_callback *frame_callback = wl_surface_frame(window_data_way->surface);
-    if (!frame_callback) {
-        return STATE_INTERNAL_ERROR;
+    if (request_frame(window_data) == false) {
+        return false;
     }
-    wl_callback_add_listener(frame_callback, &frame_listener, &done);
     wl_surface_commit(window_data_way->surface);
 
-    while (!done && window_data->close == false) {
-        if (wl_display_dispatch(window_data_way->display) == -1 || wl_display_roundtrip(window_data_way->display) == -1) {
-            wl_callback_destroy(frame_callback);
+    return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+mfb_update_state
+mfb_update_ex(struct mfb_window *window, void *buffer, unsigned width, unsigned height)
+{
+    if(window == 0x0) {
+        return STATE_INVALID_WINDOW;
+    }
+
+    SWindowData *window_data = (SWindowData *) window;
+    if(window_data->close) {
+        destroy(window_data);
+        return STATE_EXIT;
+    }
+
+    if(buffer == 0x0) {
+        return STATE_INVALID_BUFFER;
+    }
+
+    SWindowData_Way   *window_data_way = (SWindowData_Way *) window_data->specific;
+    if (!window_data_way->display || wl_display_get_error(window_data_way->display) != 0)
+        return STATE_INTERNAL_ERROR;
+
+    // Nothing can be seen or nothing changed: keep reading, the pending frame callback tells when it can be seen again
+    if (is_window_idle(window_data) || is_same_frame(window_data, buffer, width, height)) {
+        if (read_events(window_data_way->display, 0) == -1)
+            return STATE_INTERNAL_ERROR;
+        return STATE_OK;
+    }
+
+    buffer = convert_input_buffer(window_data, buffer, width, height);
+    if(buffer == 0x0) {
+        return STATE_INTERNAL_ERROR;
+    }
+
+#if defined(USE_OPENGL_API)
+    // The frame is scaled to the viewport, the window keeps its size
+    window_data->buffer_width  = width;
+    window_data->buffer_height = height;
+    window_data->buffer_stride = width * sizeof(uint32_t);
+
+    // Asked before the swap, that commits the surface
+    if (request_frame(window_data) == false) {
+        return STATE_INTERNAL_ERROR;
+    }
+    redraw_GL(window_data, buffer);
+#else
+#if defined(USE_VULKAN_API)
+    if (window_data_way->vulkan != 0x0) {
+        // The frame is scaled to the viewport, the window keeps its size
+        window_data->buffer_width  = width;
+        window_data->buffer_height = height;
+        window_data->buffer_stride = width * sizeof(uint32_t);
+
+        // Asked before the present, that commits the surface
+        if (request_frame(window_data) == false || redraw_VK(window_data, buffer) == false) {
             return STATE_INTERNAL_ERROR;
         }
     }
+    else
+#endif
+    if (present_shm(window_data, buffer, width, height) == false) {
+        return STATE_INTERNAL_ERROR;
+    }
+#endif
+
+    if (window_data->is_hidden) {
+        if (read_events(window_data_way->display, 0) == -1)
+            return STATE_INTERNAL_ERROR;
+    }
+    else if (wait_frame(window_data) == false) {
+        return STATE_INTERNAL_ERROR;
+    }
+    if (window_data_way->frame_callback == 0x0) {
+        record_present(window_data);
+    }
 
     return STATE_OK;
 }
@@ -800,9 +1311,31 @@ mfb_update_events(struct mfb_window *window)
     return STATE_OK;
 }
 
-///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// The surfaces route the events of the shared devices, so one dispatch serves all the windows
+mfb_update_state
+mfb_update_events_all(void)
+{
+    SWindowData *window_data;
+    bool        any_open = false;
+
+    if (s_connection.windows == 0x0)
+        return STATE_INVALID_WINDOW;
+    if (wl_display_get_error(s_connection.display) != 0)
+        return STATE_INTERNAL_ERROR;
 
-extern double   g_time_for_frame;
+    // Read what already arrived without blocking
+    if (read_events(s_connection.display, 0) == -1)
+        return STATE_INTERNAL_ERROR;
+
+    // Closed windows are destroyed by their own update
+    for (window_data = s_connection.windows; window_data != 0x0; window_data = ((SWindowData_Way *) window_data->specific)->next) {
+        any_open |= (window_data->close == false);
+    }
+
+    return any_open ? STATE_OK : STATE_EXIT;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
 bool
 mfb_wait_sync(struct mfb_window *window) {
@@ -817,15 +1350,16 @@ mfb_wait_sync(struct mfb_window *window) {
     }
 
     SWindowData_Way   *window_data_way = (SWindowData_Way *) window_data->specific;
+    double      time_for_frame = get_time_for_frame(window_data);
     double      current;
     uint32_t    millis = 1;
     while(1) {
         current = mfb_timer_now(window_data_way->timer);
-        if (current >= g_time_for_frame * 0.96) {
+        if (current >= time_for_frame * 0.96) {
             mfb_timer_reset(window_data_way->timer);
             return true;
         }
-        else if(current >= g_time_for_frame * 0.8) {
+        else if(current >= time_for_frame * 0.8) {
             millis = 0;
         }
 
@@ -838,7 +1372,7 @@ mfb_wait_sync(struct mfb_window *window) {
             }
 
             if(window_data->close) {
-                destroy_window_data(window_data);
+                destroy(window_data);
                 return false;
             }
         }
@@ -851,9 +1385,16 @@ mfb_wait_sync(struct mfb_window *window) {
 
 extern short int g_keycodes[512];
 
-void
+static void
 init_keycodes(void)
 {
+    static bool s_initialized = false;
+
+    // The evdev codes don't depend on the compositor: once per process
+    if (s_initialized)
+        return;
+    s_initialized = true;
+
     // Clear keys
     for (size_t i = 0; i < sizeof(g_keycodes) / sizeof(g_keycodes[0]); ++i)
         g_keycodes[i] = 0;
@@ -991,14 +1532,26 @@ mfb_set_viewport(struct mfb_window *window, unsigned offset_x, unsigned offset_y
         return false;
     }
 
-    // TODO: Not yet
+    // The frame is drawn in that rect of the window
     window_data->dst_offset_x = offset_x;
     window_data->dst_offset_y = offset_y;
     window_data->dst_width    = width;
     window_data->dst_height   = height;
-    resize_dst(window_data, width, height);
 
+#if defined(USE_OPENGL_API)
+    calc_dst_factor(window_data, window_data->window_width, window_data->window_height);
+    return true;
+#else
+#if defined(USE_VULKAN_API)
+    if (((SWindowData_Way *) window_data->specific)->vulkan != 0x0) {
+        calc_dst_factor(window_data, window_data->window_width, window_data->window_height);
+        return true;
+    }
+#endif
+    // TODO: Not yet
+    resize_dst(window_data, width, height);
     return false;
+#endif
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -1028,3 +1581,21 @@ mfb_get_monitor_scale(struct mfb_window *window, float *scale_x, float *scale_y)
         }
     }
 }
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#if defined(USE_RUNTIME_BACKEND)
+// The frames sent so far are done: the GPU has executed them and the compositor has received them
+static void
+finish_frames(struct mfb_window *window) {
+    SWindowData     *window_data     = (SWindowData *) window;
+    SWindowData_Way *window_data_way = (SWindowData_Way *) window_data->specific;
+
+#if defined(USE_OPENGL_API)
+    finish_GL(window_data);
+#endif
+    wl_display_roundtrip(window_data_way->display);
+}
+
+kBackendExport("wayland")
+#endif
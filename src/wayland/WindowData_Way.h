@@ -2,6 +2,9 @@
 
 #include <MiniFB_enums.h>
 #include <stdint.h>
+#if defined(USE_OPENGL_API)
+#include <EGL/egl.h>
+#endif
 
 struct wl_display;
 struct wl_registry;
@@ -16,31 +19,63 @@ struct wl_shm_pool;
 struct wl_surface;
 struct wl_shell_surface;
 struct wl_buffer;
+struct wl_event_queue;
+struct zwp_relative_pointer_v1;
+struct wl_egl_window;
+struct SWindowData;
 
+// A keyboard and a pointer of the seat. They report for every surface of the process,
+// the enter events tell which window has the focus
 typedef struct
 {
-    struct wl_display       *display;
-    struct wl_registry      *registry;
-    struct wl_compositor    *compositor;
-    struct wl_shell         *shell;
-    struct wl_seat          *seat;
     struct wl_keyboard      *keyboard;
-    
     struct wl_pointer       *pointer;
-    struct wl_cursor_theme  *cursor_theme;
-    struct wl_cursor        *default_cursor;
+    struct zwp_relative_pointer_v1 *relative_pointer;
+    struct wl_event_queue   *queue;             // 0x0: the default queue
+    struct SWindowData      *owner;             // 0x0 when shared by the windows without an input thread
+    struct SWindowData      *keyboard_focus;
+    struct SWindowData      *pointer_focus;
+} SInputDevicesWay;
+
+typedef struct
+{
+    struct wl_display       *display;           // Shared by all the windows
+    SInputDevicesWay        devices;            // Only while the window has an input thread
+    bool                    raw_motion;
     struct wl_surface       *cursor_surface;
     
-    struct wl_shm           *shm;
     struct wl_shm_pool      *shm_pool;
     struct wl_surface       *surface;
     struct wl_shell_surface *shell_surface;
 
-    uint32_t                seat_version;
-    uint32_t                shm_format;
     uint32_t                *shm_ptr;
 
     int                     fd;
+    struct wl_callback      *frame_callback;    // Pending until the compositor shows the last commit
+
+#if defined(USE_OPENGL_API)
+    struct wl_egl_window    *egl_window;
+    EGLDisplay              egl_display;        // The one of the connection, terminated with it
+    EGLSurface              egl_surface;
+    EGLContext              egl_context;
+    uint32_t                text_id;
+    uint32_t                text_width;         // Size of the texture storage
+    uint32_t                text_height;
+    uint32_t                text_filter;        // mfb_scale_filter the texture parameters are set for
+    bool                    text_float;         // The storage holds a float frame, tone mapped by the shader
+    uint32_t                program;
+    uint32_t                vao;                // 0 on GLES 2
+    uint32_t                vbo;
+    int32_t                 u_rect;
+    int32_t                 u_window_size;
+    int32_t                 u_scale_filter;
+    int32_t                 u_tone;             // -1 when the shaders can't tone map (GLES 2)
+#elif defined(USE_VULKAN_API)
+    struct SVulkanContext   *vulkan;            // 0x0 when the shm buffer presents
+#endif
     
     struct mfb_timer        *timer;
+
+    // Next window sharing the display connection
+    struct SWindowData      *next;
 } SWindowData_Way;
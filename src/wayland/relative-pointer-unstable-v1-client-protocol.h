@@ -0,0 +1,68 @@
+// Client side of the relative-pointer-unstable-v1 protocol (wayland-protocols).
+// Equivalent to: wayland-scanner client-header relative-pointer-unstable-v1.xml
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <wayland-client.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct wl_pointer;
+struct zwp_relative_pointer_manager_v1;
+struct zwp_relative_pointer_v1;
+
+extern const struct wl_interface zwp_relative_pointer_manager_v1_interface;
+extern const struct wl_interface zwp_relative_pointer_v1_interface;
+
+#define ZWP_RELATIVE_POINTER_MANAGER_V1_DESTROY                 0
+#define ZWP_RELATIVE_POINTER_MANAGER_V1_GET_RELATIVE_POINTER    1
+
+#define ZWP_RELATIVE_POINTER_V1_DESTROY                         0
+
+static inline void
+zwp_relative_pointer_manager_v1_destroy(struct zwp_relative_pointer_manager_v1 *manager)
+{
+    wl_proxy_marshal((struct wl_proxy *) manager, ZWP_RELATIVE_POINTER_MANAGER_V1_DESTROY);
+    wl_proxy_destroy((struct wl_proxy *) manager);
+}
+
+static inline struct zwp_relative_pointer_v1 *
+zwp_relative_pointer_manager_v1_get_relative_pointer(struct zwp_relative_pointer_manager_v1 *manager, struct wl_pointer *pointer)
+{
+    struct wl_proxy *id;
+
+    id = wl_proxy_marshal_constructor((struct wl_proxy *) manager, ZWP_RELATIVE_POINTER_MANAGER_V1_GET_RELATIVE_POINTER,
+                                      &zwp_relative_pointer_v1_interface, NULL, pointer);
+
+    return (struct zwp_relative_pointer_v1 *) id;
+}
+
+// utime_hi/utime_lo: timestamp in microseconds. dx/dy: accelerated, dx_unaccel/dy_unaccel: as reported by the device
+struct zwp_relative_pointer_v1_listener {
+    void (*relative_motion)(void *data, struct zwp_relative_pointer_v1 *relative_pointer,
+                            uint32_t utime_hi, uint32_t utime_lo,
+                            wl_fixed_t dx, wl_fixed_t dy,
+                            wl_fixed_t dx_unaccel, wl_fixed_t dy_unaccel);
+};
+
+static inline int
+zwp_relative_pointer_v1_add_listener(struct zwp_relative_pointer_v1 *relative_pointer,
+                                     const struct zwp_relative_pointer_v1_listener *listener, void *data)
+{
+    return wl_proxy_add_listener((struct wl_proxy *) relative_pointer, (void (**)(void)) listener, data);
+}
+
+static inline void
+zwp_relative_pointer_v1_destroy(struct zwp_relative_pointer_v1 *relative_pointer)
+{
+    wl_proxy_marshal((struct wl_proxy *) relative_pointer, ZWP_RELATIVE_POINTER_V1_DESTROY);
+    wl_proxy_destroy((struct wl_proxy *) relative_pointer);
+}
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,45 @@
+// Interfaces of the relative-pointer-unstable-v1 protocol (wayland-protocols).
+// Equivalent to: wayland-scanner private-code relative-pointer-unstable-v1.xml
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <wayland-util.h>
+
+extern const struct wl_interface wl_pointer_interface;
+extern const struct wl_interface zwp_relative_pointer_v1_interface;
+
+static const struct wl_interface *relative_pointer_unstable_v1_types[] = {
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    &zwp_relative_pointer_v1_interface,
+    &wl_pointer_interface,
+};
+
+static const struct wl_message zwp_relative_pointer_manager_v1_requests[] = {
+    { "destroy", "", relative_pointer_unstable_v1_types + 0 },
+    { "get_relative_pointer", "no", relative_pointer_unstable_v1_types + 6 },
+};
+
+const struct wl_interface zwp_relative_pointer_manager_v1_interface = {
+    "zwp_relative_pointer_manager_v1", 1,
+    2, zwp_relative_pointer_manager_v1_requests,
+    0, NULL,
+};
+
+static const struct wl_message zwp_relative_pointer_v1_requests[] = {
+    { "destroy", "", relative_pointer_unstable_v1_types + 0 },
+};
+
+static const struct wl_message zwp_relative_pointer_v1_events[] = {
+    { "relative_motion", "uuffff", relative_pointer_unstable_v1_types + 0 },
+};
+
+const struct wl_interface zwp_relative_pointer_v1_interface = {
+    "zwp_relative_pointer_v1", 1,
+    1, zwp_relative_pointer_v1_requests,
+    1, zwp_relative_pointer_v1_events,
+};
@@ -5,6 +5,7 @@
 #include <malloc.h>
 #include <stdio.h>
 #include <string.h>
+#include "WebSwizzle.h"
 
 #define EM_EXPORT __attribute__((used))
 
@@ -146,18 +147,9 @@ EM_ASYNC_JS(void, setup_web_mfb, (), {
     };
 })
 
-EM_EXPORT void reverse_color_channels(uint8_t *src, uint8_t *dst, int width, int height) {
-    int32_t numPixels = (width * height) << 2;
-    for (int i = 0; i < numPixels; i += 4) {
-        uint8_t b = src[i];
-        uint8_t g = src[i + 1];
-        uint8_t r = src[i + 2];
-        uint8_t a = src[i + 3];
-        dst[i] = r;
-        dst[i + 1] = g;
-        dst[i + 2] = b;
-        dst[i + 3] = a;
-    }
+// ARGB pixels (B, G, R, A bytes) to the R, G, B, A bytes of the canvas. src and dst must not overlap
+EM_EXPORT void reverse_color_channels(const uint8_t *src, uint8_t *dst, int width, int height) {
+    swizzle_pixels(src, dst, width * height);
 }
 
 EM_EXPORT void window_data_set_mouse_pos(SWindowData *windowData, int x, int y) {
@@ -267,6 +259,10 @@ EM_JS(void*, mfb_open_ex_js,(SWindowData *windowData, const char *title, unsigne
         canvas: canvas,
         windowData: windowData,
         activeTouchId: null,
+        context: canvas.getContext("2d"),
+        staging: 0,
+        stagingSize: 0,
+        imageData: null,
         events: [
             { type: "active" }
         ]
@@ -427,6 +423,9 @@ struct mfb_window *mfb_open_ex(const char *title, unsigned width, unsigned heigh
         return 0x0;
     }
     window_data->specific = specific;
+    window_data->buffer_width = width;
+    window_data->buffer_height = height;
+    window_data->buffer_stride = width * 4;
 
     // setup key map if not initialized yet
     if (!g_initialized) {
@@ -484,6 +483,22 @@ mfb_update_state mfb_update_events(struct mfb_window *window) {
     return mfb_update_events_js((SWindowData *)window);
 }
 
+EM_JS(mfb_update_state, mfb_update_events_all_js, (), {
+    const STATE_OK = 0;
+    const STATE_EXIT = -1;
+    const STATE_INVALID_WINDOW = -2;
+    if (!window._minifb) return STATE_INVALID_WINDOW;
+    let state = STATE_EXIT;
+    for (let id in window._minifb.windows) {
+        if (mfb_update_events_js(window._minifb.windows[id].windowData) == STATE_OK) state = STATE_OK;
+    }
+    return state;
+});
+
+mfb_update_state mfb_update_events_all(void) {
+    return mfb_update_events_all_js();
+}
+
 EM_JS(mfb_update_state, mfb_update_js, (struct mfb_window * windowData, void *buffer, int width, int height), {
     // FIXME can we make these global somehow? preamble.js maybe?
     const STATE_OK = 0;
@@ -505,15 +520,31 @@ EM_JS(mfb_update_state, mfb_update_js, (struct mfb_window * windowData, void *bu
         if (canvas.width != width) canvas.width = width;
         if (canvas.height != height) canvas.height = height;
     }
-    Module._reverse_color_channels(buffer, buffer, width, height);
-    let framePixels = new Uint8ClampedArray(HEAPU8.buffer, buffer, width * height * 4);
-    let imageData = new ImageData(framePixels, width, height);
-    canvas.getContext("2d").putImageData(imageData, 0, 0);
-    Module._reverse_color_channels(buffer, buffer, width, height);
+    // The user buffer is never written: the canvas gets its RGBA bytes from a staging buffer kept between frames
+    let size = width * height * 4;
+    if (w.stagingSize != size) {
+        if (w.staging) Module._free(w.staging);
+        w.staging = Module._malloc(size);
+        w.stagingSize = w.staging ? size : 0;
+        w.imageData = null;
+        if (!w.staging) return STATE_INTERNAL_ERROR;
+    }
+    Module._reverse_color_channels(buffer, w.staging, width, height);
+    // Growing the heap replaces HEAPU8.buffer, and the views on the old one stop working
+    if (!w.imageData || w.imageData.width != width || w.imageData.data.buffer !== HEAPU8.buffer) {
+        w.imageData = new ImageData(new Uint8ClampedArray(HEAPU8.buffer, w.staging, size), width, height);
+    }
+    w.context.putImageData(w.imageData, 0, 0);
     return Module._window_data_get_close(windowData);
 });
 
 mfb_update_state mfb_update_ex(struct mfb_window *window, void *buffer, unsigned width, unsigned height) {
+    if (window != 0x0 && buffer != 0x0) {
+        // The canvas keeps the last frame
+        if (is_same_frame((SWindowData *) window, buffer, width, height)) return mfb_update_events_js((SWindowData *) window);
+        buffer = convert_input_buffer((SWindowData *) window, buffer, width, height);
+        if (buffer == 0x0) return STATE_INTERNAL_ERROR;
+    }
     mfb_update_state state = mfb_update_js(window, buffer, width, height);
     if (state != STATE_OK) return state;
     state = mfb_update_events_js((SWindowData *)window);
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <stdint.h>
+#if defined(__wasm_simd128__)
+    #include <wasm_simd128.h>
+    #define kWebSwizzleSIMD
+#endif
+
+// Shared by WebMiniFB.c and tests/web_swizzle.c. The test defines kWebSwizzleSIMD with native
+// stand-ins for the wasm intrinsics, so the SIMD loop runs outside the browser too
+
+// ARGB pixels (B, G, R, A bytes) to R, G, B, A bytes, one pixel at a time
+static inline void swizzle_pixels_scalar(const uint8_t *src, uint8_t *dst, int32_t begin, int32_t end) {
+    for (int32_t i = begin; i < end; i++) {
+        const uint8_t *s = src + i * 4;
+        uint8_t *d = dst + i * 4;
+        d[0] = s[2];
+        d[1] = s[1];
+        d[2] = s[0];
+        d[3] = s[3];
+    }
+}
+
+// Same result, four pixels per shuffle and the scalar loop for the tail. src and dst must not overlap
+static inline void swizzle_pixels(const uint8_t *src, uint8_t *dst, int32_t numPixels) {
+    int32_t i = 0;
+#if defined(kWebSwizzleSIMD)
+    for (; i + 4 <= numPixels; i += 4) {
+        v128_t pixels = wasm_v128_load(src + i * 4);
+        wasm_v128_store(dst + i * 4, wasm_i8x16_shuffle(pixels, pixels, 2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15));
+    }
+#endif
+    swizzle_pixels_scalar(src, dst, i, numPixels);
+}
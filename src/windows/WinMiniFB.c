@@ -167,6 +167,9 @@ mfb_get_monitor_scale(struct mfb_window *window, float *scale_x, float *scale_y)
 
 long    s_window_style = WS_POPUP | WS_SYSMENU | WS_CAPTION;
 
+// Open windows, until their update after the close destroys them
+static SWindowData  *s_windows = 0x0;
+
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
 void init_keycodes();
@@ -600,6 +603,9 @@ mfb_open_ex(const char *title, unsigned width, unsigned height, unsigned flags)
 
     mfb_set_keyboard_callback((struct mfb_window *) window_data, keyboard_default);
 
+    window_data_win->next = s_windows;
+    s_windows = window_data;
+
 #if defined(_DEBUG) || defined(DEBUG)
     #if defined(USE_OPENGL_API)
         printf("Window created using OpenGL API\n");
@@ -632,13 +638,30 @@ mfb_update_ex(struct mfb_window *window, void *buffer, unsigned width, unsigned
         return STATE_INVALID_BUFFER;
     }
 
+    SWindowData_Win *window_data_win = (SWindowData_Win *) window_data->specific;
+
+    if (is_same_frame(window_data, buffer, width, height)) {
+        // WM_PAINT draws from it, it must not point to a buffer the user may have released
+        if (window_data->input_format != FORMAT_RGBA32F) {
+            window_data->draw_buffer = buffer;
+        }
+        while (window_data->close == false && PeekMessage(&msg, window_data_win->window, 0, 0, PM_REMOVE)) {
+            TranslateMessage(&msg);
+            DispatchMessage(&msg);
+        }
+        return STATE_OK;
+    }
+
+    buffer = convert_input_buffer(window_data, buffer, width, height);
+    if (buffer == 0x0) {
+        return STATE_INTERNAL_ERROR;
+    }
+
     window_data->draw_buffer   = buffer;
     window_data->buffer_width  = width;
     window_data->buffer_stride = width * 4;
     window_data->buffer_height = height;
 
-    SWindowData_Win *window_data_win = (SWindowData_Win *) window_data->specific;
-
 #if !defined(USE_OPENGL_API)
 
     window_data_win->bitmapInfo->bmiHeader.biWidth = window_data->buffer_width;
@@ -687,10 +710,32 @@ mfb_update_events(struct mfb_window *window) {
     return STATE_OK;
 }
 
-///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//-------------------------------------
+mfb_update_state
+mfb_update_events_all(void) {
+    MSG msg;
+
+    if (s_windows == 0x0) {
+        return STATE_INVALID_WINDOW;
+    }
 
-extern double   g_time_for_frame;
-extern bool     g_use_hardware_sync;
+    // The messages of every window created by this thread
+    while (PeekMessage(&msg, 0x0, 0, 0, PM_REMOVE)) {
+        TranslateMessage(&msg);
+        DispatchMessage(&msg);
+    }
+
+    // Closed windows are destroyed by their own update
+    for (SWindowData *window_data = s_windows; window_data != 0x0; window_data = ((SWindowData_Win *) window_data->specific)->next) {
+        if (window_data->close == false) {
+            return STATE_OK;
+        }
+    }
+
+    return STATE_EXIT;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
 bool
 mfb_wait_sync(struct mfb_window *window) {
@@ -704,21 +749,22 @@ mfb_wait_sync(struct mfb_window *window) {
         return false;
     }
 
-    if(g_use_hardware_sync) {
+    if(window_data->use_hardware_sync) {
         return true;
     }
 
     MSG             msg;
     SWindowData_Win *window_data_win = (SWindowData_Win *) window_data->specific;
+    double          time_for_frame = get_time_for_frame(window_data);
     double          current;
 
     while (1) {
         current = mfb_timer_now(window_data_win->timer);
-        if (current >= g_time_for_frame) {
+        if (current >= time_for_frame) {
             mfb_timer_reset(window_data_win->timer);
             return true;
         }
-        else if (g_time_for_frame - current > 2.0/1000.0) {
+        else if (time_for_frame - current > 2.0/1000.0) {
             timeBeginPeriod(1);
             Sleep(1);
             timeEndPeriod(1);
@@ -747,6 +793,14 @@ destroy_window_data(SWindowData *window_data) {
 
     SWindowData_Win *window_data_win = (SWindowData_Win *) window_data->specific;
 
+    for (SWindowData **link = &s_windows; *link != 0x0; link = &((SWindowData_Win *) (*link)->specific)->next) {
+        if (*link == window_data) {
+            *link = window_data_win->next;
+            break;
+        }
+    }
+    window_data_win->next = 0x0;
+
 #if !defined(USE_OPENGL_API)
     if (window_data_win->bitmapInfo != 0x0) {
         free(window_data_win->bitmapInfo);
@@ -767,6 +821,8 @@ destroy_window_data(SWindowData *window_data) {
     mfb_timer_destroy(window_data_win->timer);
     window_data_win->timer = 0x0;
 
+    destroy_window_data_common(window_data);
+
     window_data->draw_buffer = 0x0;
     window_data->close       = true;
 }
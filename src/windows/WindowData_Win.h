@@ -11,9 +11,23 @@ typedef struct {
 #if defined(USE_OPENGL_API)
     HGLRC               hGLRC;
     uint32_t            text_id;
+    uint32_t            text_width;         // Size of the texture storage
+    uint32_t            text_height;
+    uint32_t            text_filter;        // mfb_scale_filter the texture parameters are set for
+    bool                text_float;         // The storage holds a float frame, tone mapped by the shader
+    uint32_t            program;            // Shader pipeline, 0 with the fixed function one
+    uint32_t            vao;
+    uint32_t            vbo;
+    int32_t             u_rect;
+    int32_t             u_window_size;
+    int32_t             u_scale_filter;
+    int32_t             u_tone;             // -1 when the shaders can't tone map (GLES 2)
 #else
     BITMAPINFO          *bitmapInfo;
 #endif
     struct mfb_timer    *timer;
     bool                mouse_inside;
+
+    // Next open window, for mfb_update_events_all
+    struct SWindowData  *next;
 } SWindowData_Win;
@@ -3,8 +3,33 @@
 #include <MiniFB_enums.h>
 #include <stdint.h>
 #include <X11/Xlib.h>
+#include "MiniFB_thread.h"
 #if defined(USE_OPENGL_API)
 #include <GL/glx.h>
+#else
+#if defined(USE_XRENDER)
+#include <X11/extensions/Xrender.h>
+#endif
+#if defined(USE_XCB)
+#include <xcb/xcb.h>
+#elif defined(USE_XSHM)
+#include <X11/extensions/XShm.h>
+#endif
+#endif
+
+// Deferred events: first allocation, and the size past which the queue gives up motions to make room
+#define kMinDeferredEvents  64
+#define kMaxDeferredEvents  1024
+
+#if defined(USE_XCB) && defined(USE_XSHM)
+#define kNumShmSegments     2
+
+typedef struct {
+    uint32_t            id;                 // xcb_shm_seg_t, 0 when not attached
+    int                 shmid;
+    uint32_t            *pixels;
+    unsigned int        fence;              // Sequence of a request sent after the last put from it, 0 once it came back
+} SShmSegmentX11;
 #endif
 
 typedef struct {
@@ -16,13 +41,65 @@ typedef struct {
 #if defined(USE_OPENGL_API)
     GLXContext          context;
     uint32_t            text_id;
+    uint32_t            text_width;         // Size of the texture storage
+    uint32_t            text_height;
+    uint32_t            text_filter;        // mfb_scale_filter the texture parameters are set for
+    bool                text_float;         // The storage holds a float frame, tone mapped by the shader
+    uint32_t            program;            // Shader pipeline, 0 with the fixed function one
+    uint32_t            vao;
+    uint32_t            vbo;
+    int32_t             u_rect;
+    int32_t             u_window_size;
+    int32_t             u_scale_filter;
+    int32_t             u_tone;             // -1 when the shaders can't tone map (GLES 2)
+    bool                resize_pending;
 #else
-    XImage              *image;
-    void                *image_buffer;
-    XImage              *image_scaler;
+    void                *image_buffer;      // The frame scaled by stretch_image, without XRender
     uint32_t            image_scaler_width;
     uint32_t            image_scaler_height;
+    Pixmap              back_pixmap;        // The last frame, copied to the window on present and on Expose
+    XImage              *back_image;        // 0x0 with XCB: back_shadow is sent by xcb_put_image
+    uint32_t            *back_shadow;       // What the pixmap has, to send only the changes
+    uint32_t            back_width;
+    uint32_t            back_height;
+    bool                back_valid;
+    uint32_t            drawn_x;            // Viewport the back buffer was drawn in, the rest of the window is cleared
+    uint32_t            drawn_y;
+    uint32_t            drawn_width;
+    uint32_t            drawn_height;
+#if defined(USE_XSHM)
+#if defined(USE_XCB)
+    SShmSegmentX11      segments[kNumShmSegments];
+    int                 segment;            // The one written by the last upload, -1 if none was free
+#else
+    XShmSegmentInfo     shm_info;
+#endif
+    bool                back_shm;           // back_image is in shm_info, or the segments are attached with XCB
+#endif
+#if defined(USE_VULKAN_API)
+    struct SVulkanContext *vulkan;          // 0x0 when the XImage path presents
+#endif
+#if defined(USE_XRENDER)
+    XRenderPictFormat   *render_format;
+    Picture             window_picture;     // None without XRender: the frames are scaled by stretch_image
+    Picture             back_picture;       // The back buffer, scaled to the viewport by the server
+    uint32_t            back_filter;        // mfb_scale_filter the picture is set for
+#endif
 #endif   
     
     struct mfb_timer   *timer;
+    bool                raw_motion;
+    bool                is_minimized;       // _NET_WM_STATE_HIDDEN
+    bool                is_unmapped;
+    bool                is_obscured;        // VisibilityFullyObscured
+    bool                destroy_pending;    // Closed from a callback, destroyed after the batch
+
+    // Next window sharing the display connection
+    struct SWindowData  *next;
+
+    // Events read by another thread, handled by the window thread
+    XEvent              *deferred_events;
+    uint32_t            num_deferred_events;
+    uint32_t            max_deferred_events;
+    mfb_mutex_t         deferred_mutex;
 } SWindowData_X11;
@@ -0,0 +1,130 @@
+#if defined(USE_RUNTIME_BACKEND)
+
+#define kX11DynNoRename
+#include "X11Dyn.h"
+#include <dlfcn.h>
+#include <stdio.h>
+
+#define kDefineDyn(name)        __typeof__(name) *dyn_##name = 0x0;
+#define kLoadDyn(name)          && load_symbol(library, #name, (void **) &dyn_##name)
+
+kX11Functions(kDefineDyn)
+kGLFunctions(kDefineDyn)
+kXIFunctions(kDefineDyn)
+kXRenderFunctions(kDefineDyn)
+kXShmFunctions(kDefineDyn)
+kXRandRFunctions(kDefineDyn)
+
+//-------------------------------------
+static void *
+open_library(const char *name, const char *fallback) {
+    void *library = dlopen(name, RTLD_LAZY | RTLD_LOCAL);
+    if (library == 0x0 && fallback != 0x0) {
+        library = dlopen(fallback, RTLD_LAZY | RTLD_LOCAL);
+    }
+    return library;
+}
+
+//-------------------------------------
+static bool
+load_symbol(void *library, const char *name, void **symbol) {
+    *symbol = dlsym(library, name);
+    if (*symbol == 0x0) {
+        fprintf(stderr, "Cannot find %s in the X11 libraries.\n", name);
+        return false;
+    }
+    return true;
+}
+
+//-------------------------------------
+static bool
+check_library(void **handle, void *library, bool loaded) {
+    if (loaded == false) {
+        if (library != 0x0) {
+            dlclose(library);
+        }
+        return false;
+    }
+    *handle = library;
+    return true;
+}
+
+//-------------------------------------
+bool
+load_x11_library(void) {
+    static void *s_library = 0x0;
+
+    if (s_library != 0x0) {
+        return true;
+    }
+
+    void *library = open_library("libX11.so.6", "libX11.so");
+    return check_library(&s_library, library, library != 0x0 kX11Functions(kLoadDyn));
+}
+
+//-------------------------------------
+bool
+load_gl_library(void) {
+    static void *s_library = 0x0;
+
+    if (s_library != 0x0) {
+        return true;
+    }
+
+    void *library = open_library("libGL.so.1", "libGL.so");
+    return check_library(&s_library, library, library != 0x0 kGLFunctions(kLoadDyn));
+}
+
+//-------------------------------------
+bool
+load_xi_library(void) {
+    static void *s_library = 0x0;
+
+    if (s_library != 0x0) {
+        return true;
+    }
+
+    void *library = open_library("libXi.so.6", "libXi.so");
+    return check_library(&s_library, library, library != 0x0 kXIFunctions(kLoadDyn));
+}
+
+//-------------------------------------
+bool
+load_xrender_library(void) {
+    static void *s_library = 0x0;
+
+    if (s_library != 0x0) {
+        return true;
+    }
+
+    void *library = open_library("libXrender.so.1", "libXrender.so");
+    return check_library(&s_library, library, library != 0x0 kXRenderFunctions(kLoadDyn));
+}
+
+//-------------------------------------
+bool
+load_xext_library(void) {
+    static void *s_library = 0x0;
+
+    if (s_library != 0x0) {
+        return true;
+    }
+
+    void *library = open_library("libXext.so.6", "libXext.so");
+    return check_library(&s_library, library, library != 0x0 kXShmFunctions(kLoadDyn));
+}
+
+//-------------------------------------
+bool
+load_xrandr_library(void) {
+    static void *s_library = 0x0;
+
+    if (s_library != 0x0) {
+        return true;
+    }
+
+    void *library = open_library("libXrandr.so.2", "libXrandr.so");
+    return check_library(&s_library, library, library != 0x0 kXRandRFunctions(kLoadDyn));
+}
+
+#endif
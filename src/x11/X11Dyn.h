@@ -0,0 +1,202 @@
+#pragma once
+
+// X11, XInput2, XRender, MIT-SHM, XRandR and GLX entry points. They are linked as usual, but with USE_RUNTIME_BACKEND
+// they are looked up in the shared libraries only when an X11 window is opened, so that
+// the Wayland and headless backends run on systems without them.
+// Include it after the rest of the X11 / GL headers: it renames the functions.
+
+#include <stdbool.h>
+#include <X11/Xlib.h>
+#include <X11/Xutil.h>
+#include <X11/XKBlib.h>
+#if defined(USE_XINPUT2)
+    #include <X11/extensions/XInput2.h>
+#endif
+#if defined(USE_XRENDER)
+    #include <X11/extensions/Xrender.h>
+#endif
+#if defined(USE_XSHM)
+    #include <X11/extensions/XShm.h>
+#endif
+#if defined(USE_XRANDR)
+    #include <X11/extensions/Xrandr.h>
+#endif
+#if defined(USE_OPENGL_API) || defined(USE_RUNTIME_BACKEND)
+    #include <GL/gl.h>
+    #include <GL/glx.h>
+#endif
+
+#if defined(USE_RUNTIME_BACKEND)
+
+#define kX11Functions(F)                                                                        \
+    F(XChangeProperty) F(XClearArea) F(XClearWindow) F(XCloseDisplay) F(XCopyArea)            \
+    F(XCreateImage) F(XCreatePixmap)                                                            \
+    F(XCreateWindow) F(XDestroyWindow) F(XEventsQueued) F(XFlush) F(XFree) F(XFreeEventData)   \
+    F(XFreePixmap) F(XGetEventData) F(XSetErrorHandler) F(XSync)                                \
+    F(XGetWindowProperty) F(XInitThreads) F(XInternAtoms) F(XListPixmapFormats) F(XLookupString) \
+    F(XMapRaised) F(XNextEvent) F(XOpenDisplay) F(XPeekEvent) F(XPending) F(XPutImage)          \
+    F(XQueryExtension) F(XSelectInput) F(XSetWMNormalHints) F(XSetWMProtocols) F(XStoreName)    \
+    F(XkbKeycodeToKeysym) F(XkbSetDetectableAutoRepeat)
+
+#define kGLFunctions(F)                                                                         \
+    F(glXChooseVisual) F(glXCreateContext) F(glXDestroyContext) F(glXGetCurrentDisplay)         \
+    F(glXGetProcAddress) F(glXMakeCurrent) F(glXQueryDrawable) F(glXQueryExtensionsString)      \
+    F(glXQueryVersion) F(glXSwapBuffers)                                                        \
+    F(glBindTexture) F(glClear) F(glDisable) F(glDisableClientState) F(glDrawArrays) F(glEnable)\
+    F(glEnableClientState) F(glFinish) F(glGenTextures) F(glGetString) F(glLoadIdentity)        \
+    F(glMatrixMode) F(glOrtho) F(glTexCoordPointer) F(glTexImage2D) F(glTexParameteri)          \
+    F(glTexSubImage2D) F(glVertexPointer) F(glViewport)
+
+#if defined(USE_XINPUT2)
+    #define kXIFunctions(F)     F(XIQueryVersion) F(XISelectEvents)
+#else
+    #define kXIFunctions(F)
+#endif
+
+#if defined(USE_XRENDER)
+    #define kXRenderFunctions(F)                                                                \
+        F(XRenderComposite) F(XRenderCreatePicture) F(XRenderFindVisualFormat)                  \
+        F(XRenderFreePicture) F(XRenderQueryExtension) F(XRenderSetPictureFilter)               \
+        F(XRenderSetPictureTransform)
+#else
+    #define kXRenderFunctions(F)
+#endif
+
+#if defined(USE_XSHM)
+    #define kXShmFunctions(F)                                                                   \
+        F(XShmAttach) F(XShmCreateImage) F(XShmDetach) F(XShmPutImage) F(XShmQueryExtension)
+#else
+    #define kXShmFunctions(F)
+#endif
+
+#if defined(USE_XRANDR)
+    #define kXRandRFunctions(F)                                                                 \
+        F(XRRFreeCrtcInfo) F(XRRFreeOutputInfo) F(XRRFreeScreenResources) F(XRRGetCrtcInfo)     \
+        F(XRRGetOutputInfo) F(XRRGetOutputPrimary) F(XRRGetScreenResourcesCurrent)              \
+        F(XRRQueryExtension) F(XRRQueryVersion) F(XRRSetCrtcConfig)
+#else
+    #define kXRandRFunctions(F)
+#endif
+
+#define kDeclareDyn(name)       extern __typeof__(name) *dyn_##name;
+kX11Functions(kDeclareDyn)
+kGLFunctions(kDeclareDyn)
+kXIFunctions(kDeclareDyn)
+kXRenderFunctions(kDeclareDyn)
+kXShmFunctions(kDeclareDyn)
+kXRandRFunctions(kDeclareDyn)
+
+// Each one loads its library once, false if it is missing
+bool load_x11_library(void);
+bool load_gl_library(void);
+bool load_xi_library(void);
+bool load_xrender_library(void);
+bool load_xext_library(void);
+bool load_xrandr_library(void);
+
+#if !defined(kX11DynNoRename)
+    #define XChangeProperty             dyn_XChangeProperty
+    #define XClearArea                  dyn_XClearArea
+    #define XClearWindow                dyn_XClearWindow
+    #define XCloseDisplay               dyn_XCloseDisplay
+    #define XCopyArea                   dyn_XCopyArea
+    #define XCreateImage                dyn_XCreateImage
+    #define XCreatePixmap               dyn_XCreatePixmap
+    #define XCreateWindow               dyn_XCreateWindow
+    #define XDestroyWindow              dyn_XDestroyWindow
+    #define XEventsQueued               dyn_XEventsQueued
+    #define XFlush                      dyn_XFlush
+    #define XFree                       dyn_XFree
+    #define XFreeEventData              dyn_XFreeEventData
+    #define XFreePixmap                 dyn_XFreePixmap
+    #define XGetEventData               dyn_XGetEventData
+    #define XGetWindowProperty          dyn_XGetWindowProperty
+    #define XInitThreads                dyn_XInitThreads
+    #define XInternAtoms                dyn_XInternAtoms
+    #define XListPixmapFormats          dyn_XListPixmapFormats
+    #define XLookupString               dyn_XLookupString
+    #define XMapRaised                  dyn_XMapRaised
+    #define XNextEvent                  dyn_XNextEvent
+    #define XOpenDisplay                dyn_XOpenDisplay
+    #define XPeekEvent                  dyn_XPeekEvent
+    #define XPending                    dyn_XPending
+    #define XPutImage                   dyn_XPutImage
+    #define XQueryExtension             dyn_XQueryExtension
+    #define XSelectInput                dyn_XSelectInput
+    #define XSetErrorHandler            dyn_XSetErrorHandler
+    #define XSetWMNormalHints           dyn_XSetWMNormalHints
+    #define XSetWMProtocols             dyn_XSetWMProtocols
+    #define XStoreName                  dyn_XStoreName
+    #define XSync                       dyn_XSync
+    #define XkbKeycodeToKeysym          dyn_XkbKeycodeToKeysym
+    #define XkbSetDetectableAutoRepeat  dyn_XkbSetDetectableAutoRepeat
+
+    #define XIQueryVersion              dyn_XIQueryVersion
+    #define XISelectEvents              dyn_XISelectEvents
+
+    #define XRenderComposite            dyn_XRenderComposite
+    #define XRenderCreatePicture        dyn_XRenderCreatePicture
+    #define XRenderFindVisualFormat     dyn_XRenderFindVisualFormat
+    #define XRenderFreePicture          dyn_XRenderFreePicture
+    #define XRenderQueryExtension       dyn_XRenderQueryExtension
+    #define XRenderSetPictureFilter     dyn_XRenderSetPictureFilter
+    #define XRenderSetPictureTransform  dyn_XRenderSetPictureTransform
+
+    #define XShmAttach                  dyn_XShmAttach
+    #define XShmCreateImage             dyn_XShmCreateImage
+    #define XShmDetach                  dyn_XShmDetach
+    #define XShmPutImage                dyn_XShmPutImage
+    #define XShmQueryExtension          dyn_XShmQueryExtension
+
+    #define XRRFreeCrtcInfo             dyn_XRRFreeCrtcInfo
+    #define XRRFreeOutputInfo           dyn_XRRFreeOutputInfo
+    #define XRRFreeScreenResources      dyn_XRRFreeScreenResources
+    #define XRRGetCrtcInfo              dyn_XRRGetCrtcInfo
+    #define XRRGetOutputInfo            dyn_XRRGetOutputInfo
+    #define XRRGetOutputPrimary         dyn_XRRGetOutputPrimary
+    #define XRRGetScreenResourcesCurrent dyn_XRRGetScreenResourcesCurrent
+    #define XRRQueryExtension           dyn_XRRQueryExtension
+    #define XRRQueryVersion             dyn_XRRQueryVersion
+    #define XRRSetCrtcConfig            dyn_XRRSetCrtcConfig
+
+    #define glXChooseVisual             dyn_glXChooseVisual
+    #define glXCreateContext            dyn_glXCreateContext
+    #define glXDestroyContext           dyn_glXDestroyContext
+    #define glXGetCurrentDisplay        dyn_glXGetCurrentDisplay
+    #define glXGetProcAddress           dyn_glXGetProcAddress
+    #define glXMakeCurrent              dyn_glXMakeCurrent
+    #define glXQueryDrawable            dyn_glXQueryDrawable
+    #define glXQueryExtensionsString    dyn_glXQueryExtensionsString
+    #define glXQueryVersion             dyn_glXQueryVersion
+    #define glXSwapBuffers              dyn_glXSwapBuffers
+    #define glBindTexture               dyn_glBindTexture
+    #define glClear                     dyn_glClear
+    #define glDisable                   dyn_glDisable
+    #define glDisableClientState        dyn_glDisableClientState
+    #define glDrawArrays                dyn_glDrawArrays
+    #define glEnable                    dyn_glEnable
+    #define glEnableClientState         dyn_glEnableClientState
+    #define glFinish                    dyn_glFinish
+    #define glGenTextures               dyn_glGenTextures
+    #define glGetString                 dyn_glGetString
+    #define glLoadIdentity              dyn_glLoadIdentity
+    #define glMatrixMode                dyn_glMatrixMode
+    #define glOrtho                     dyn_glOrtho
+    #define glTexCoordPointer           dyn_glTexCoordPointer
+    #define glTexImage2D                dyn_glTexImage2D
+    #define glTexParameteri             dyn_glTexParameteri
+    #define glTexSubImage2D             dyn_glTexSubImage2D
+    #define glVertexPointer             dyn_glVertexPointer
+    #define glViewport                  dyn_glViewport
+#endif
+
+#else
+
+    #define load_x11_library()          true
+    #define load_gl_library()           true
+    #define load_xi_library()           true
+    #define load_xrender_library()      true
+    #define load_xext_library()         true
+    #define load_xrandr_library()       true
+
+#endif
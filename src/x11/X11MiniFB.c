@@ -1,3 +1,12 @@
+#if defined(USE_RUNTIME_BACKEND)
+    #if defined(USE_OPENGL_API)
+        #define kBackendPrefix  x11_gl_
+    #else
+        #define kBackendPrefix  x11_
+    #endif
+    #include "linux/LinuxBackend.h"
+#endif
+
 #include <X11/Xlib.h>
 #include <X11/Xutil.h>
 #include <X11/XKBlib.h>
@@ -9,11 +18,34 @@
 //#include <X11/Xresource.h>
 //#include <X11/extensions/Xrandr.h>
 #include <xkbcommon/xkbcommon.h>
+#if defined(USE_XINPUT2)
+    #include <X11/extensions/XInput2.h>
+#endif
+#if defined(USE_XRENDER)
+    #include <X11/extensions/Xrender.h>
+#endif
+#if defined(USE_XRANDR)
+    #include <X11/extensions/Xrandr.h>
+#endif
+#if defined(USE_XCB)
+    #include <X11/Xlib-xcb.h>
+    #include <xcb/xcbext.h>
+    #if defined(USE_XSHM)
+        #include <xcb/shm.h>
+    #endif
+#elif defined(USE_XSHM)
+    #include <X11/extensions/XShm.h>
+#endif
+#if defined(USE_XSHM)
+    #include <sys/ipc.h>
+    #include <sys/shm.h>
+#endif
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
+#include <poll.h>
 #include <MiniFB.h>
 #include <MiniFB_internal.h>
 #include "WindowData.h"
@@ -21,13 +53,929 @@
 
 #if defined(USE_OPENGL_API)
     #include <gl/MiniFB_GL.h>
+#elif defined(USE_VULKAN_API)
+    #include <vk/MiniFB_VK.h>
+#endif
+#include "X11Dyn.h"
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void init_keycodes(SWindowData_X11 *window_data_x11);
+
+// All the windows of the process share one connection; events are routed by X window
+typedef struct {
+    Display         *display;
+    SWindowData     *windows;
+    uint32_t        ref_count;
+    Atom            delete_window_atom;
+    Atom            wm_state_atom;
+    Atom            wm_state_hidden_atom;
+    Atom            wm_state_above_atom;
+    Atom            wm_state_fullscreen_atom;
+    Atom            motif_wm_hints_atom;
+    Atom            bypass_compositor_atom;
+    bool            detectable_autorepeat;
+    int             xi_opcode;          // XInput2 major opcode, 0 until queried
+    bool            shm_checked;
+    bool            has_shm;            // MIT-SHM works: false on a remote display
+    mfb_mutex_t     read_mutex;         // One thread reads and dispatches events at a time (recursive: callbacks run with it)
+    uint32_t        dispatch_depth;     // > 0 while the thread holding read_mutex runs the callbacks of a batch
+#if defined(USE_XCB)
+    xcb_connection_t *xcb;              // The one under display: the frames are sent through it
+#endif
+} SConnectionX11;
+
+static SConnectionX11 s_connection;
+
+// Every atom is interned when the connection is opened
+static void
+intern_atoms(void) {
+    struct {
+        const char  *name;
+        Atom        *atom;
+    } atoms[] = {
+        { "WM_DELETE_WINDOW",           &s_connection.delete_window_atom },
+        { "_NET_WM_STATE",              &s_connection.wm_state_atom },
+        { "_NET_WM_STATE_HIDDEN",       &s_connection.wm_state_hidden_atom },
+        { "_NET_WM_STATE_ABOVE",        &s_connection.wm_state_above_atom },
+        { "_NET_WM_STATE_FULLSCREEN",   &s_connection.wm_state_fullscreen_atom },
+        { "_MOTIF_WM_HINTS",            &s_connection.motif_wm_hints_atom },
+        { "_NET_WM_BYPASS_COMPOSITOR",  &s_connection.bypass_compositor_atom },
+    };
+    const size_t num_atoms = sizeof(atoms) / sizeof(atoms[0]);
+
+#if defined(USE_XCB)
+    // All the requests are sent before waiting for the first reply: one round trip
+    xcb_intern_atom_cookie_t cookies[sizeof(atoms) / sizeof(atoms[0])];
+    for (size_t i = 0; i < num_atoms; ++i) {
+        cookies[i] = xcb_intern_atom(s_connection.xcb, 0, (uint16_t) strlen(atoms[i].name), atoms[i].name);
+    }
+    for (size_t i = 0; i < num_atoms; ++i) {
+        xcb_intern_atom_reply_t *reply = xcb_intern_atom_reply(s_connection.xcb, cookies[i], 0x0);
+        *atoms[i].atom = reply != 0x0 ? reply->atom : None;
+        free(reply);
+    }
+#else
+    // XInternAtoms sends them all before waiting: one round trip
+    char *names[sizeof(atoms) / sizeof(atoms[0])];
+    Atom values[sizeof(atoms) / sizeof(atoms[0])];
+    for (size_t i = 0; i < num_atoms; ++i) {
+        names[i] = (char *) atoms[i].name;
+    }
+    XInternAtoms(s_connection.display, names, (int) num_atoms, False, values);
+    for (size_t i = 0; i < num_atoms; ++i) {
+        *atoms[i].atom = values[i];
+    }
+#endif
+}
+
+static bool
+acquire_connection(SWindowData_X11 *window_data_x11) {
+    if (s_connection.ref_count == 0) {
+        if (load_x11_library() == false) {
+            return false;
+        }
+
+        // The async presenter draws from its own thread while this one pumps events
+        static bool s_threads_initialized = false;
+        if (s_threads_initialized == false) {
+            XInitThreads();
+            s_threads_initialized = true;
+        }
+
+        s_connection.display = XOpenDisplay(0);
+        if (s_connection.display == 0x0) {
+            return false;
+        }
+        mutex_init_recursive(&s_connection.read_mutex);
+
+        window_data_x11->display = s_connection.display;
+        init_keycodes(window_data_x11);
+
+        Bool detectable_autorepeat = False;
+        XkbSetDetectableAutoRepeat(s_connection.display, True, &detectable_autorepeat);
+        s_connection.detectable_autorepeat = detectable_autorepeat;
+#if defined(USE_XCB)
+        s_connection.xcb = XGetXCBConnection(s_connection.display);
+#endif
+        intern_atoms();
+    }
+
+    ++s_connection.ref_count;
+    window_data_x11->display = s_connection.display;
+
+    return true;
+}
+
+static void
+release_connection(void) {
+    if (s_connection.ref_count == 0 || --s_connection.ref_count > 0) {
+        return;
+    }
+
+    XCloseDisplay(s_connection.display);
+    mutex_destroy(&s_connection.read_mutex);
+    memset(&s_connection, 0, sizeof(s_connection));
+}
+
+static void
+register_window(SWindowData *window_data) {
+    SWindowData_X11 *window_data_x11 = (SWindowData_X11 *) window_data->specific;
+
+    mutex_lock(&s_connection.read_mutex);
+    window_data_x11->next = s_connection.windows;
+    s_connection.windows  = window_data;
+    mutex_unlock(&s_connection.read_mutex);
+}
+
+static void
+unregister_window(SWindowData *window_data) {
+    mutex_lock(&s_connection.read_mutex);
+    for (SWindowData **link = &s_connection.windows; *link != 0x0; link = &((SWindowData_X11 *) (*link)->specific)->next) {
+        if (*link == window_data) {
+            *link = ((SWindowData_X11 *) window_data->specific)->next;
+            break;
+        }
+    }
+    mutex_unlock(&s_connection.read_mutex);
+}
+
+static SWindowData *
+find_window(Window window) {
+    for (SWindowData *window_data = s_connection.windows; window_data != 0x0; window_data = ((SWindowData_X11 *) window_data->specific)->next) {
+        if (((SWindowData_X11 *) window_data->specific)->window == window) {
+            return window_data;
+        }
+    }
+
+    return 0x0;
+}
+static mfb_update_state present_buffer(SWindowData *window_data, void *buffer, uint32_t width, uint32_t height);
+static void pump_input(SWindowData *window_data, int timeout_ms);
+static void destroy_window_data(SWindowData *window_data);
+static bool setup_input_thread(SWindowData *window_data, bool enable);
+
+// Only the event classes the window subscribed to are sent by the server
+static void
+select_input(SWindowData *window_data) {
+    SWindowData_X11 *window_data_x11 = (SWindowData_X11 *) window_data->specific;
+    unsigned        mask             = mfb_get_event_mask((struct mfb_window *) window_data);
+    // Visibility and _NET_WM_STATE changes (minimized) are always needed to know when the window can't be seen
+    long            x11_mask         = StructureNotifyMask | ExposureMask | VisibilityChangeMask | PropertyChangeMask;
+
+    if (mask & EVENT_MASK_KEYBOARD)
+        x11_mask |= KeyPressMask | KeyReleaseMask;
+    if (mask & EVENT_MASK_MOUSE_BUTTON)
+        x11_mask |= ButtonPressMask | ButtonReleaseMask;
+    if (mask & EVENT_MASK_MOUSE_MOVE)
+        x11_mask |= PointerMotionMask | EnterWindowMask | LeaveWindowMask;
+    if (mask & EVENT_MASK_FOCUS)
+        x11_mask |= FocusChangeMask;
+
+    XSelectInput(window_data_x11->display, window_data_x11->window, x11_mask);
+}
+
+#if defined(USE_XINPUT2)
+// The selection is per connection: raw motion stays on while any window wants it
+static bool
+setup_raw_motion(SWindowData *window_data, bool enable) {
+    SWindowData_X11 *window_data_x11 = (SWindowData_X11 *) window_data->specific;
+    Display         *display         = window_data_x11->display;
+    unsigned char   bits[XIMaskLen(XI_LASTEVENT)] = { 0 };
+    XIEventMask     mask;
+    int             event, error, major = 2, minor = 0;
+
+    if (s_connection.xi_opcode == 0) {
+        if (load_xi_library() == false ||
+            XQueryExtension(display, "XInputExtension", &s_connection.xi_opcode, &event, &error) == False ||
+            XIQueryVersion(display, &major, &minor) != Success) {
+            s_connection.xi_opcode = 0;
+            return enable == false;
+        }
+    }
+
+    window_data_x11->raw_motion = enable;
+    mutex_lock(&s_connection.read_mutex);
+    for (SWindowData *other = s_connection.windows; other != 0x0; other = ((SWindowData_X11 *) other->specific)->next) {
+        enable |= ((SWindowData_X11 *) other->specific)->raw_motion;
+    }
+    mutex_unlock(&s_connection.read_mutex);
+
+    if (enable) {
+        XISetMask(bits, XI_RawMotion);
+    }
+    mask.deviceid = XIAllMasterDevices;
+    mask.mask_len = sizeof(bits);
+    mask.mask     = bits;
+    // Raw events are only reported to the root window
+    XISelectEvents(display, DefaultRootWindow(display), &mask, 1);
+    XFlush(display);
+
+    return true;
+}
+#endif
+
+#if !defined(USE_OPENGL_API)
+// The back buffer is a pixmap with the last uploaded frame (at its own size, or at the viewport one when the client
+// scales it). Only the rows that changed are sent, and Expose is repainted from it without sending anything
+
+#if defined(USE_XRENDER)
+//-------------------------------------
+static void
+setup_xrender(SWindowData_X11 *window_data_x11, Visual *visual) {
+    Display             *display = window_data_x11->display;
+    XRenderPictFormat   *format;
+    int                 event, error;
+
+    if (load_xrender_library() == false || XRenderQueryExtension(display, &event, &error) == False) {
+        return;
+    }
+    format = XRenderFindVisualFormat(display, visual);
+    if (format == 0x0) {
+        return;
+    }
+
+    window_data_x11->render_format  = format;
+    window_data_x11->window_picture = XRenderCreatePicture(display, window_data_x11->window, format, 0, 0x0);
+}
+#endif
+
+#if defined(USE_XCB) && defined(USE_XSHM)
+// Two segments: the next frame is written to one while the server may still read the other
+
+//-------------------------------------
+static void
+release_shm_segments(SWindowData_X11 *window_data_x11) {
+    for (int i = 0; i < kNumShmSegments; ++i) {
+        SShmSegmentX11 *segment = &window_data_x11->segments[i];
+
+        if (segment->fence != 0) {
+            xcb_discard_reply(s_connection.xcb, segment->fence);
+        }
+        if (segment->id != 0) {
+            xcb_shm_detach(s_connection.xcb, segment->id);
+        }
+        if (segment->pixels != 0x0) {
+            shmdt(segment->pixels);
+        }
+        memset(segment, 0, sizeof(*segment));
+    }
+    window_data_x11->back_shm = false;
+}
+
+// Only waits for the server here, when the back buffer is created
+//-------------------------------------
+static bool
+create_shm_segments(SWindowData_X11 *window_data_x11, uint32_t width, uint32_t height) {
+    xcb_connection_t *xcb = s_connection.xcb;
+
+    if (s_connection.shm_checked == false) {
+        const xcb_query_extension_reply_t *extension = xcb_get_extension_data(xcb, &xcb_shm_id);
+        s_connection.shm_checked = true;
+        s_connection.has_shm     = extension != 0x0 && extension->present;
+    }
+    if (s_connection.has_shm == false) {
+        return false;
+    }
+
+    for (int i = 0; i < kNumShmSegments; ++i) {
+        SShmSegmentX11      *segment = &window_data_x11->segments[i];
+        xcb_generic_error_t *error;
+        void                *pixels;
+
+        segment->shmid = shmget(IPC_PRIVATE, (size_t) width * height * 4, IPC_CREAT | 0600);
+        if (segment->shmid == -1) {
+            release_shm_segments(window_data_x11);
+            return false;
+        }
+        pixels = shmat(segment->shmid, 0x0, 0);
+        // It goes away with the last detach, even if the process dies
+        shmctl(segment->shmid, IPC_RMID, 0x0);
+        if (pixels == (void *) -1) {
+            release_shm_segments(window_data_x11);
+            return false;
+        }
+        segment->pixels = (uint32_t *) pixels;
+
+        // Fails on a remote display
+        segment->id = xcb_generate_id(xcb);
+        error       = xcb_request_check(xcb, xcb_shm_attach_checked(xcb, segment->id, segment->shmid, 1));
+        if (error != 0x0) {
+            free(error);
+            segment->id          = 0;
+            s_connection.has_shm = false;
+            release_shm_segments(window_data_x11);
+            return false;
+        }
+    }
+
+    window_data_x11->back_shm = true;
+    return true;
+}
+
+// A segment the server doesn't read anymore, -1 if both are still in use (the frame goes in the requests then)
+//-------------------------------------
+static int
+acquire_shm_segment(SWindowData_X11 *window_data_x11) {
+    for (int i = 0; i < kNumShmSegments; ++i) {
+        int             index    = (window_data_x11->segment + 1 + i) % kNumShmSegments;
+        SShmSegmentX11  *segment = &window_data_x11->segments[index];
+        void            *reply   = 0x0;
+        xcb_generic_error_t *error = 0x0;
+
+        if (segment->fence != 0) {
+            if (xcb_poll_for_reply(s_connection.xcb, segment->fence, &reply, &error) == 0) {
+                continue;
+            }
+            free(reply);
+            free(error);
+            segment->fence = 0;
+        }
+        return index;
+    }
+    return -1;
+}
+
+#elif defined(USE_XSHM)
+static bool s_shm_error = false;
+
+//-------------------------------------
+static int
+trap_shm_error(Display *display, XErrorEvent *event) {
+    kUnused(display);
+    kUnused(event);
+    s_shm_error = true;
+    return 0;
+}
+
+// The back image in a shared memory segment: XShmPutImage reads it, the frame doesn't go through the socket
+//-------------------------------------
+static bool
+create_shm_image(SWindowData_X11 *window_data_x11, uint32_t width, uint32_t height) {
+    Display         *display  = window_data_x11->display;
+    XShmSegmentInfo *shm_info = &window_data_x11->shm_info;
+    XErrorHandler   previous;
+    XImage          *image;
+
+    if (s_connection.shm_checked == false) {
+        s_connection.shm_checked = true;
+        s_connection.has_shm     = load_xext_library() && XShmQueryExtension(display);
+    }
+    if (s_connection.has_shm == false) {
+        return false;
+    }
+
+    image = XShmCreateImage(display, DefaultVisual(display, window_data_x11->screen), DefaultDepth(display, window_data_x11->screen), ZPixmap, 0x0, shm_info, width, height);
+    if (image == 0x0) {
+        return false;
+    }
+    shm_info->shmid = shmget(IPC_PRIVATE, (size_t) image->bytes_per_line * height, IPC_CREAT | 0600);
+    if (shm_info->shmid == -1) {
+        XDestroyImage(image);
+        return false;
+    }
+    shm_info->shmaddr  = (char *) shmat(shm_info->shmid, 0x0, 0);
+    shm_info->readOnly = False;
+    // It goes away with the last detach, even if the process dies
+    shmctl(shm_info->shmid, IPC_RMID, 0x0);
+    if (shm_info->shmaddr == (char *) -1) {
+        XDestroyImage(image);
+        return false;
+    }
+
+    // On a remote display the attach fails with an error, not a status
+    XSync(display, False);
+    s_shm_error = false;
+    previous    = XSetErrorHandler(trap_shm_error);
+    XShmAttach(display, shm_info);
+    XSync(display, False);
+    XSetErrorHandler(previous);
+    if (s_shm_error) {
+        s_connection.has_shm = false;
+        shmdt(shm_info->shmaddr);
+        XDestroyImage(image);
+        return false;
+    }
+
+    image->data                   = shm_info->shmaddr;
+    window_data_x11->back_image   = image;
+    window_data_x11->back_shadow  = (uint32_t *) shm_info->shmaddr;
+    window_data_x11->back_shm     = true;
+    return true;
+}
+#endif
+
+//-------------------------------------
+static void
+release_back_buffer(SWindowData_X11 *window_data_x11) {
+    Display *display = window_data_x11->display;
+
+#if defined(USE_XRENDER)
+    if (window_data_x11->back_picture != None) {
+        XRenderFreePicture(display, window_data_x11->back_picture);
+        window_data_x11->back_picture = None;
+    }
+#endif
+    if (window_data_x11->back_pixmap != None) {
+        XFreePixmap(display, window_data_x11->back_pixmap);
+        window_data_x11->back_pixmap = None;
+    }
+#if defined(USE_XCB)
+#if defined(USE_XSHM)
+    release_shm_segments(window_data_x11);
+#endif
+    free(window_data_x11->back_shadow);
+#else
+    if (window_data_x11->back_image != 0x0) {
+#if defined(USE_XSHM)
+        if (window_data_x11->back_shm) {
+            XShmDetach(display, &window_data_x11->shm_info);
+            XSync(display, False);
+            shmdt(window_data_x11->shm_info.shmaddr);
+            window_data_x11->back_shm = false;
+        }
+        else
 #endif
+        free(window_data_x11->back_shadow);
+        window_data_x11->back_image->data = 0x0;
+        XDestroyImage(window_data_x11->back_image);
+        window_data_x11->back_image = 0x0;
+    }
+#endif
+    window_data_x11->back_shadow = 0x0;
+    window_data_x11->back_width  = 0;
+    window_data_x11->back_height = 0;
+    window_data_x11->back_valid  = false;
+}
+
+//-------------------------------------
+static bool
+create_back_buffer(SWindowData_X11 *window_data_x11, uint32_t width, uint32_t height) {
+    Display *display = window_data_x11->display;
+    int     depth    = DefaultDepth(display, window_data_x11->screen);
+
+    release_back_buffer(window_data_x11);
+
+#if defined(USE_XCB)
+    // The pixmap contents are kept apart from the segments, that are only written with what changed
+    window_data_x11->back_shadow = (uint32_t *) malloc((size_t) width * height * 4);
+    if (window_data_x11->back_shadow == 0x0) {
+        return false;
+    }
+#if defined(USE_XSHM)
+    create_shm_segments(window_data_x11, width, height);
+#endif
+#else
+#if defined(USE_XSHM)
+    if (create_shm_image(window_data_x11, width, height) == false)
+#endif
+    {
+        window_data_x11->back_shadow = (uint32_t *) malloc((size_t) width * height * 4);
+        if (window_data_x11->back_shadow == 0x0) {
+            return false;
+        }
+        window_data_x11->back_image = XCreateImage(display, CopyFromParent, depth, ZPixmap, 0, (char *) window_data_x11->back_shadow, width, height, 32, width * 4);
+        if (window_data_x11->back_image == 0x0) {
+            free(window_data_x11->back_shadow);
+            window_data_x11->back_shadow = 0x0;
+            return false;
+        }
+    }
+#endif
+
+    window_data_x11->back_pixmap = XCreatePixmap(display, window_data_x11->window, width, height, depth);
+#if defined(USE_XRENDER)
+    if (window_data_x11->window_picture != None) {
+        XRenderPictureAttributes attributes;
+        // The bilinear filter reads past the edges: they are repeated, not blended with black
+        attributes.repeat = RepeatPad;
+        window_data_x11->back_picture = XRenderCreatePicture(display, window_data_x11->back_pixmap, window_data_x11->render_format, CPRepeat, &attributes);
+        window_data_x11->back_filter  = (uint32_t) -1;
+    }
+#endif
+    window_data_x11->back_width  = width;
+    window_data_x11->back_height = height;
+
+    return true;
+}
+
+#if defined(USE_XCB)
+// The requests are queued, nothing waits for the server
+//-------------------------------------
+static void
+put_back_rect(SWindowData_X11 *window_data_x11, uint32_t x, uint32_t y, uint32_t width, uint32_t height) {
+    xcb_connection_t    *xcb    = s_connection.xcb;
+    xcb_gcontext_t      gc      = XGContextFromGC(window_data_x11->gc);
+    uint8_t             depth   = (uint8_t) DefaultDepth(window_data_x11->display, window_data_x11->screen);
+    uint32_t            stride  = window_data_x11->back_width;
+    const uint32_t      *pixels = window_data_x11->back_shadow + (size_t) y * stride + x;
+
+#if defined(USE_XSHM)
+    if (window_data_x11->segment >= 0 && window_data_x11->back_shm) {
+        uint32_t *target = window_data_x11->segments[window_data_x11->segment].pixels + (size_t) y * stride + x;
+        for (uint32_t row = 0; row < height; ++row) {
+            memcpy(target + (size_t) row * stride, pixels + (size_t) row * stride, width * 4);
+        }
+        xcb_shm_put_image(xcb, window_data_x11->back_pixmap, gc, stride, window_data_x11->back_height, x, y, width, height, x, y,
+                          depth, XCB_IMAGE_FORMAT_Z_PIXMAP, 0, window_data_x11->segments[window_data_x11->segment].id, 0);
+        return;
+    }
+#endif
+
+    // The rows of a rect as wide as the frame follow each other in the shadow, the others go one by one
+    if (width == stride) {
+        uint32_t max_rows = (xcb_get_maximum_request_length(xcb) * 4 - 24) / (width * 4);
+        if (max_rows == 0) {
+            max_rows = 1;
+        }
+        for (uint32_t row = 0; row < height; row += max_rows) {
+            uint32_t rows = height - row < max_rows ? height - row : max_rows;
+            xcb_put_image(xcb, XCB_IMAGE_FORMAT_Z_PIXMAP, window_data_x11->back_pixmap, gc, width, rows, x, y + row, 0, depth,
+                          rows * width * 4, (const uint8_t *) (pixels + (size_t) row * stride));
+        }
+    }
+    else {
+        for (uint32_t row = 0; row < height; ++row) {
+            xcb_put_image(xcb, XCB_IMAGE_FORMAT_Z_PIXMAP, window_data_x11->back_pixmap, gc, width, 1, x, y + row, 0, depth,
+                          width * 4, (const uint8_t *) (pixels + (size_t) row * stride));
+        }
+    }
+}
+#else
+//-------------------------------------
+static void
+put_back_rect(SWindowData_X11 *window_data_x11, uint32_t x, uint32_t y, uint32_t width, uint32_t height) {
+#if defined(USE_XSHM)
+    if (window_data_x11->back_shm) {
+        XShmPutImage(window_data_x11->display, window_data_x11->back_pixmap, window_data_x11->gc, window_data_x11->back_image, x, y, x, y, width, height, False);
+        return;
+    }
+#endif
+    XPutImage(window_data_x11->display, window_data_x11->back_pixmap, window_data_x11->gc, window_data_x11->back_image, x, y, x, y, width, height);
+}
+#endif
+
+// False when the row is the same as the one in the back buffer, otherwise the first and last pixels that changed
+//-------------------------------------
+static bool
+find_row_changes(const uint32_t *row, const uint32_t *old_row, uint32_t width, uint32_t *first, uint32_t *last) {
+    uint32_t x0 = 0, x1 = width - 1;
+
+    if (memcmp(row, old_row, width * 4) == 0) {
+        return false;
+    }
+    while (row[x0] == old_row[x0])
+        ++x0;
+    while (row[x1] == old_row[x1])
+        --x1;
+
+    *first = x0;
+    *last  = x1;
+    return true;
+}
+
+// Each band of consecutive rows that changed is sent as the rect that covers the changes
+//-------------------------------------
+static bool
+upload_back_buffer(SWindowData_X11 *window_data_x11, const uint32_t *frame, uint32_t width, uint32_t height) {
+    uint32_t    band_y = 0, band_height = 0, band_x0 = 0, band_x1 = 0;
+    uint32_t    x0 = 0, x1 = width - 1;
+    bool        uploaded = false;
+
+    if (window_data_x11->back_width != width || window_data_x11->back_height != height) {
+        if (create_back_buffer(window_data_x11, width, height) == false) {
+            return false;
+        }
+    }
+#if defined(USE_XCB) && defined(USE_XSHM)
+    if (window_data_x11->back_shm) {
+        window_data_x11->segment = acquire_shm_segment(window_data_x11);
+    }
+#endif
+
+    for (uint32_t y = 0; y <= height; ++y) {
+        const uint32_t  *row    = frame + (size_t) y * width;
+        uint32_t        *shadow = window_data_x11->back_shadow + (size_t) y * width;
+
+        if (y < height && (window_data_x11->back_valid == false || find_row_changes(row, shadow, width, &x0, &x1))) {
+            memcpy(shadow + x0, row + x0, (x1 - x0 + 1) * 4);
+            if (band_height == 0) {
+                band_y  = y;
+                band_x0 = x0;
+                band_x1 = x1;
+            }
+            band_x0 = x0 < band_x0 ? x0 : band_x0;
+            band_x1 = x1 > band_x1 ? x1 : band_x1;
+            ++band_height;
+            continue;
+        }
+
+        if (band_height != 0) {
+            put_back_rect(window_data_x11, band_x0, band_y, band_x1 - band_x0 + 1, band_height);
+            band_height = 0;
+            uploaded    = true;
+        }
+    }
+
+#if defined(USE_XCB) && defined(USE_XSHM)
+    // Any request with a reply sent after the puts: when it comes the server is done with the segment
+    if (uploaded && window_data_x11->back_shm && window_data_x11->segment >= 0) {
+        window_data_x11->segments[window_data_x11->segment].fence = xcb_get_input_focus(s_connection.xcb).sequence;
+    }
+#elif defined(USE_XSHM)
+    // The server reads the segment when it handles the request: it can't be written before
+    if (uploaded && window_data_x11->back_shm) {
+        XSync(window_data_x11->display, False);
+    }
+#else
+    kUnused(uploaded);
+#endif
+    window_data_x11->back_valid = true;
+
+    return true;
+}
+
+// Only what was outside the viewport, the frame is not cleared first
+//-------------------------------------
+static void
+clear_outside_viewport(SWindowData *window_data) {
+    SWindowData_X11 *window_data_x11 = (SWindowData_X11 *) window_data->specific;
+    Display         *display         = window_data_x11->display;
+    Window          window           = window_data_x11->window;
+    uint32_t        right            = window_data->dst_offset_x + window_data->dst_width;
+    uint32_t        bottom           = window_data->dst_offset_y + window_data->dst_height;
+
+    // XClearArea takes a 0 size as up to the edge of the window
+    if (window_data->dst_offset_y > 0)
+        XClearArea(display, window, 0, 0, window_data->window_width, window_data->dst_offset_y, False);
+    if (bottom < window_data->window_height)
+        XClearArea(display, window, 0, bottom, window_data->window_width, window_data->window_height - bottom, False);
+    if (window_data->dst_offset_x > 0 && window_data->dst_height > 0)
+        XClearArea(display, window, 0, window_data->dst_offset_y, window_data->dst_offset_x, window_data->dst_height, False);
+    if (right < window_data->window_width && window_data->dst_height > 0)
+        XClearArea(display, window, right, window_data->dst_offset_y, window_data->window_width - right, window_data->dst_height, False);
+}
+
+// Draws the back buffer in the viewport. False if it can't: there is none, or it has to be scaled and there is no XRender
+//-------------------------------------
+static bool
+present_back_buffer(SWindowData *window_data) {
+    SWindowData_X11 *window_data_x11 = (SWindowData_X11 *) window_data->specific;
+
+    if (window_data_x11->back_valid == false || window_data->dst_width == 0 || window_data->dst_height == 0) {
+        return false;
+    }
+
+    if (window_data_x11->back_width == window_data->dst_width && window_data_x11->back_height == window_data->dst_height) {
+#if defined(USE_XCB)
+        xcb_copy_area(s_connection.xcb, window_data_x11->back_pixmap, window_data_x11->window, XGContextFromGC(window_data_x11->gc), 0, 0,
+                      window_data->dst_offset_x, window_data->dst_offset_y, window_data->dst_width, window_data->dst_height);
+#else
+        XCopyArea(window_data_x11->display, window_data_x11->back_pixmap, window_data_x11->window, window_data_x11->gc, 0, 0,
+                  window_data->dst_width, window_data->dst_height, window_data->dst_offset_x, window_data->dst_offset_y);
+#endif
+    }
+#if defined(USE_XRENDER)
+    else if (window_data_x11->back_picture != None) {
+        XTransform transform;
+
+        if (window_data_x11->back_filter != (uint32_t) window_data->scale_filter) {
+            // Nearest and bilinear only: sharp bilinear and area are bilinear here
+            XRenderSetPictureFilter(window_data_x11->display, window_data_x11->back_picture, window_data->scale_filter == FILTER_NEAREST ? FilterNearest : FilterBilinear, 0x0, 0);
+            window_data_x11->back_filter = (uint32_t) window_data->scale_filter;
+        }
+
+        // Maps the viewport pixels to the frame ones
+        memset(&transform, 0, sizeof(transform));
+        transform.matrix[0][0] = XDoubleToFixed((double) window_data_x11->back_width  / window_data->dst_width);
+        transform.matrix[1][1] = XDoubleToFixed((double) window_data_x11->back_height / window_data->dst_height);
+        transform.matrix[2][2] = XDoubleToFixed(1.0);
+        XRenderSetPictureTransform(window_data_x11->display, window_data_x11->back_picture, &transform);
+
+        XRenderComposite(window_data_x11->display, PictOpSrc, window_data_x11->back_picture, None, window_data_x11->window_picture,
+                         0, 0, 0, 0, window_data->dst_offset_x, window_data->dst_offset_y, window_data->dst_width, window_data->dst_height);
+    }
+#endif
+    else {
+        return false;
+    }
+
+    if (window_data_x11->drawn_x != window_data->dst_offset_x || window_data_x11->drawn_y != window_data->dst_offset_y ||
+        window_data_x11->drawn_width != window_data->dst_width || window_data_x11->drawn_height != window_data->dst_height) {
+        clear_outside_viewport(window_data);
+        window_data_x11->drawn_x      = window_data->dst_offset_x;
+        window_data_x11->drawn_y      = window_data->dst_offset_y;
+        window_data_x11->drawn_width  = window_data->dst_width;
+        window_data_x11->drawn_height = window_data->dst_height;
+    }
+
+    return true;
+}
+#endif
+
+#if defined(USE_XRANDR)
+// Exclusive fullscreen: the CRTC of the primary output is switched to the mode closest to the buffer size, so the
+// frames are presented without scaling. Only one window at a time, the original mode is restored when it is
+// destroyed or when the process exits
+
+#define kMaxModeOutputs     8
+
+typedef struct {
+    SWindowData     *window;            // 0x0 while the mode is the original one
+    RRCrtc          crtc;
+    RRMode          mode;
+    int             x;
+    int             y;
+    Rotation        rotation;
+    RROutput        outputs[kMaxModeOutputs];
+    int             num_outputs;
+    bool            atexit_registered;
+} SVideoModeX11;
+
+static SVideoModeX11 s_video_mode;
+
+//-------------------------------------
+static void
+restore_video_mode(Display *display) {
+    XRRScreenResources *resources;
+
+    if (s_video_mode.window == 0x0) {
+        return;
+    }
+    s_video_mode.window = 0x0;
+
+    resources = XRRGetScreenResourcesCurrent(display, DefaultRootWindow(display));
+    if (resources == 0x0) {
+        fprintf(stderr, "Cannot restore the video mode.\n");
+        return;
+    }
+    if (XRRSetCrtcConfig(display, resources, s_video_mode.crtc, CurrentTime, s_video_mode.x, s_video_mode.y, s_video_mode.mode,
+                         s_video_mode.rotation, s_video_mode.outputs, s_video_mode.num_outputs) != RRSetConfigSuccess) {
+        fprintf(stderr, "Cannot restore the video mode.\n");
+    }
+    XRRFreeScreenResources(resources);
+    XFlush(display);
+}
+
+// exit() or returning from main without closing the window. The shared connection may be gone by now
+//-------------------------------------
+static void
+restore_video_mode_at_exit(void) {
+    Display *display;
+
+    if (s_video_mode.window == 0x0) {
+        return;
+    }
+    display = XOpenDisplay(0);
+    if (display != 0x0) {
+        restore_video_mode(display);
+        XCloseDisplay(display);
+    }
+}
+
+// The primary output, or the first one that is on
+//-------------------------------------
+static XRROutputInfo *
+get_active_output(Display *display, XRRScreenResources *resources, Window root) {
+    RROutput        primary = XRRGetOutputPrimary(display, root);
+    XRROutputInfo   *output;
+
+    if (primary != None) {
+        output = XRRGetOutputInfo(display, resources, primary);
+        if (output != 0x0 && output->connection == RR_Connected && output->crtc != None) {
+            return output;
+        }
+        if (output != 0x0) {
+            XRRFreeOutputInfo(output);
+        }
+    }
+
+    for (int i = 0; i < resources->noutput; ++i) {
+        output = XRRGetOutputInfo(display, resources, resources->outputs[i]);
+        if (output != 0x0 && output->connection == RR_Connected && output->crtc != None) {
+            return output;
+        }
+        if (output != 0x0) {
+            XRRFreeOutputInfo(output);
+        }
+    }
+
+    return 0x0;
+}
+
+// The smallest mode of the output where the buffer fits unscaled (and that fits in the screen), 0x0 if there is none
+//-------------------------------------
+static const XRRModeInfo *
+find_closest_mode(Display *display, int screen, XRRScreenResources *resources, XRROutputInfo *output, XRRCrtcInfo *crtc,
+                  unsigned width, unsigned height) {
+    const XRRModeInfo   *best      = 0x0;
+    bool                rotated    = (crtc->rotation & (RR_Rotate_90 | RR_Rotate_270)) != 0;
+    unsigned            max_width  = (unsigned) (DisplayWidth(display, screen)  - crtc->x);
+    unsigned            max_height = (unsigned) (DisplayHeight(display, screen) - crtc->y);
+
+    for (int i = 0; i < output->nmode; ++i) {
+        for (int j = 0; j < resources->nmode; ++j) {
+            const XRRModeInfo   *mode = &resources->modes[j];
+            unsigned            mode_width, mode_height;
+
+            if (mode->id != output->modes[i]) {
+                continue;
+            }
+            mode_width  = rotated ? mode->height : mode->width;
+            mode_height = rotated ? mode->width  : mode->height;
+            if (mode_width < width || mode_height < height || mode_width > max_width || mode_height > max_height) {
+                continue;
+            }
+            if (best == 0x0 || (uint64_t) mode_width * mode_height < (uint64_t) best->width * best->height) {
+                best = mode;
+            }
+        }
+    }
+
+    return best;
+}
+
+// False if the mode can't be changed: the window is a plain fullscreen one then
+//-------------------------------------
+static bool
+switch_video_mode(SWindowData *window_data, unsigned width, unsigned height, int *x, int *y, int *mode_width, int *mode_height) {
+    SWindowData_X11     *window_data_x11 = (SWindowData_X11 *) window_data->specific;
+    Display             *display         = window_data_x11->display;
+    Window              root             = RootWindow(display, window_data_x11->screen);
+    XRRScreenResources  *resources       = 0x0;
+    XRROutputInfo       *output          = 0x0;
+    XRRCrtcInfo         *crtc            = 0x0;
+    const XRRModeInfo   *mode;
+    int                 event_base, error_base, major = 0, minor = 0;
+    bool                switched = false;
+
+    if (s_video_mode.window != 0x0) {
+        fprintf(stderr, "Cannot change the video mode: another window has changed it.\n");
+        return false;
+    }
+    if (load_xrandr_library() == false || XRRQueryExtension(display, &event_base, &error_base) == False ||
+        XRRQueryVersion(display, &major, &minor) == 0 || major * 100 + minor < 103) {
+        fprintf(stderr, "Cannot change the video mode: XRandR 1.3 is not available.\n");
+        return false;
+    }
+
+    resources = XRRGetScreenResourcesCurrent(display, root);
+    if (resources != 0x0) {
+        output = get_active_output(display, resources, root);
+    }
+    if (output != 0x0) {
+        crtc = XRRGetCrtcInfo(display, resources, output->crtc);
+    }
+    if (crtc == 0x0) {
+        fprintf(stderr, "Cannot change the video mode: there is no active output.\n");
+    }
+    else if ((mode = find_closest_mode(display, window_data_x11->screen, resources, output, crtc, width, height)) == 0x0) {
+        fprintf(stderr, "Cannot change the video mode: no mode is %ux%u or bigger.\n", width, height);
+    }
+    else {
+        s_video_mode.crtc        = output->crtc;
+        s_video_mode.mode        = crtc->mode;
+        s_video_mode.x           = crtc->x;
+        s_video_mode.y           = crtc->y;
+        s_video_mode.rotation    = crtc->rotation;
+        s_video_mode.num_outputs = crtc->noutput < kMaxModeOutputs ? crtc->noutput : kMaxModeOutputs;
+        memcpy(s_video_mode.outputs, crtc->outputs, s_video_mode.num_outputs * sizeof(RROutput));
+
+        if (mode->id == crtc->mode) {
+            switched = true;
+        }
+        else if (XRRSetCrtcConfig(display, resources, output->crtc, CurrentTime, crtc->x, crtc->y, mode->id, crtc->rotation,
+                                  crtc->outputs, crtc->noutput) == RRSetConfigSuccess) {
+            s_video_mode.window = window_data;
+            switched = true;
+            if (s_video_mode.atexit_registered == false) {
+                s_video_mode.atexit_registered = true;
+                atexit(restore_video_mode_at_exit);
+            }
+        }
+        else {
+            fprintf(stderr, "Cannot change the video mode to %ux%u.\n", mode->width, mode->height);
+        }
 
-static Atom s_delete_window_atom;
+        if (switched) {
+            bool rotated = (crtc->rotation & (RR_Rotate_90 | RR_Rotate_270)) != 0;
+            *x           = crtc->x;
+            *y           = crtc->y;
+            *mode_width  = (int) (rotated ? mode->height : mode->width);
+            *mode_height = (int) (rotated ? mode->width  : mode->height);
+        }
+    }
 
-///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    if (crtc != 0x0)
+        XRRFreeCrtcInfo(crtc);
+    if (output != 0x0)
+        XRRFreeOutputInfo(output);
+    if (resources != 0x0)
+        XRRFreeScreenResources(resources);
 
-void init_keycodes(SWindowData_X11 *window_data_x11);
+    return switched;
+}
+#endif
 
 extern void
 stretch_image(uint32_t *srcImage, uint32_t srcX, uint32_t srcY, uint32_t srcWidth, uint32_t srcHeight, uint32_t srcPitch,
@@ -35,6 +983,25 @@ stretch_image(uint32_t *srcImage, uint32_t srcX, uint32_t srcY, uint32_t srcWidt
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
+// Undoes what mfb_open_ex did before it failed, the video mode included
+//-------------------------------------
+static void
+abort_open(SWindowData *window_data) {
+    SWindowData_X11 *window_data_x11 = (SWindowData_X11 *) window_data->specific;
+
+#if defined(USE_XRANDR)
+    if (s_video_mode.window == window_data) {
+        restore_video_mode(window_data_x11->display);
+    }
+#endif
+    if (window_data_x11->window != 0) {
+        XDestroyWindow(window_data_x11->display, window_data_x11->window);
+    }
+    release_connection();
+    free(window_data);
+    free(window_data_x11);
+}
+
 struct mfb_window *
 mfb_open_ex(const char *title, unsigned width, unsigned height, unsigned flags) {
     int depth, i, formatCount, convDepth = -1;
@@ -57,15 +1024,12 @@ mfb_open_ex(const char *title, unsigned width, unsigned height, unsigned flags)
     memset(window_data_x11, 0, sizeof(SWindowData_X11));
     window_data->specific = window_data_x11;
 
-    window_data_x11->display = XOpenDisplay(0);
-    if (!window_data_x11->display) {
+    if (acquire_connection(window_data_x11) == false) {
         free(window_data);
         free(window_data_x11);
         return 0x0;
     }
 
-    init_keycodes(window_data_x11);
-
     window_data_x11->screen = DefaultScreen(window_data_x11->display);
 
     visual   = DefaultVisual(window_data_x11->display, window_data_x11->screen);
@@ -88,7 +1052,7 @@ mfb_open_ex(const char *title, unsigned width, unsigned height, unsigned flags)
     // We only support 32-bit right now
     if (convDepth != 32)
     {
-        XCloseDisplay(window_data_x11->display);
+        abort_open(window_data);
         return 0x0;
     }
 
@@ -115,6 +1079,12 @@ mfb_open_ex(const char *title, unsigned width, unsigned height, unsigned flags)
         windowWidth  = screenWidth;
         windowHeight = screenHeight;
     }
+#if defined(USE_XRANDR)
+    else if ((flags & WF_FULLSCREEN) && (flags & WF_FULLSCREEN_EXCLUSIVE) &&
+             switch_video_mode(window_data, width, height, &posX, &posY, &windowWidth, &windowHeight)) {
+        // Over the CRTC, at the size of its new mode
+    }
+#endif
     else {
         posX         = (screenWidth  - width)  / 2;
         posY         = (screenHeight - height) / 2;
@@ -133,16 +1103,12 @@ mfb_open_ex(const char *title, unsigned width, unsigned height, unsigned flags)
                     visual,
                     CWBackPixel | CWBorderPixel | CWBackingStore,
                     &windowAttributes);
-    if (!window_data_x11->window)
+    if (!window_data_x11->window) {
+        abort_open(window_data);
         return 0x0;
+    }
 
-    XSelectInput(window_data_x11->display, window_data_x11->window,
-        KeyPressMask | KeyReleaseMask
-        | ButtonPressMask | ButtonReleaseMask | PointerMotionMask
-        | StructureNotifyMask | ExposureMask
-        | FocusChangeMask
-        | EnterWindowMask | LeaveWindowMask
-    );
+    select_input(window_data);
 
     XStoreName(window_data_x11->display, window_data_x11->window, title);
 
@@ -160,18 +1126,24 @@ mfb_open_ex(const char *title, unsigned width, unsigned height, unsigned flags)
             .inputMode   = 0,
             .status      = 0,
         };
-        Atom sh_p = XInternAtom(window_data_x11->display, "_MOTIF_WM_HINTS", True);
+        Atom sh_p = s_connection.motif_wm_hints_atom;
         XChangeProperty(window_data_x11->display, window_data_x11->window, sh_p, sh_p, 32, PropModeReplace, (unsigned char*)&sh, 5);
     }
 
     if (flags & WF_ALWAYS_ON_TOP) {
-        Atom sa_p = XInternAtom(window_data_x11->display, "_NET_WM_STATE_ABOVE", False);
-        XChangeProperty(window_data_x11->display, window_data_x11->window, XInternAtom(window_data_x11->display, "_NET_WM_STATE", False), XA_ATOM, 32, PropModeReplace, (unsigned char *)&sa_p, 1);
+        Atom sa_p = s_connection.wm_state_above_atom;
+        XChangeProperty(window_data_x11->display, window_data_x11->window, s_connection.wm_state_atom, XA_ATOM, 32, PropModeReplace, (unsigned char *)&sa_p, 1);
     }
 
     if (flags & WF_FULLSCREEN) {
-        Atom sf_p = XInternAtom(window_data_x11->display, "_NET_WM_STATE_FULLSCREEN", True);
-        XChangeProperty(window_data_x11->display, window_data_x11->window, XInternAtom(window_data_x11->display, "_NET_WM_STATE", True), XA_ATOM, 32, PropModeReplace, (unsigned char*)&sf_p, 1);
+        Atom sf_p = s_connection.wm_state_fullscreen_atom;
+        XChangeProperty(window_data_x11->display, window_data_x11->window, s_connection.wm_state_atom, XA_ATOM, 32, PropModeReplace, (unsigned char*)&sf_p, 1);
+    }
+
+    // The compositor doesn't copy the window: the frames go straight to the screen
+    if ((flags & WF_FULLSCREEN) && (flags & WF_FULLSCREEN_EXCLUSIVE)) {
+        long bypass = 1;
+        XChangeProperty(window_data_x11->display, window_data_x11->window, s_connection.bypass_compositor_atom, XA_CARDINAL, 32, PropModeReplace, (unsigned char *) &bypass, 1);
     }
 
     sizeHints.flags      = PPosition | PMinSize | PMaxSize;
@@ -188,16 +1160,23 @@ mfb_open_ex(const char *title, unsigned width, unsigned height, unsigned flags)
         sizeHints.max_height = height;
     }
 
-    s_delete_window_atom = XInternAtom(window_data_x11->display, "WM_DELETE_WINDOW", False);
-    XSetWMProtocols(window_data_x11->display, window_data_x11->window, &s_delete_window_atom, 1);
+    XSetWMProtocols(window_data_x11->display, window_data_x11->window, &s_connection.delete_window_atom, 1);
 
 #if defined(USE_OPENGL_API)
     if(create_GL_context(window_data) == false) {
+        abort_open(window_data);
         return 0x0;
     }
 
 #else
-    window_data_x11->image = XCreateImage(window_data_x11->display, CopyFromParent, depth, ZPixmap, 0, 0x0, width, height, 32, width * 4);
+#if defined(USE_VULKAN_API)
+    if (create_VK_context(window_data) == false) {
+        fprintf(stderr, "Cannot create the Vulkan context, using XImage.\n");
+    }
+#endif
+#if defined(USE_XRENDER)
+    setup_xrender(window_data_x11, visual);
+#endif
 #endif
 
     XSetWMNormalHints(window_data_x11->display, window_data_x11->window, &sizeHints);
@@ -211,6 +1190,20 @@ mfb_open_ex(const char *title, unsigned width, unsigned height, unsigned flags)
 
     mfb_set_keyboard_callback((struct mfb_window *) window_data, keyboard_default);
 
+    window_data->present_frame      = present_buffer;
+    window_data->setup_input_thread = setup_input_thread;
+    window_data->pump_input         = pump_input;
+    window_data->apply_event_mask   = select_input;
+#if defined(USE_XINPUT2)
+    window_data->setup_raw_motion   = setup_raw_motion;
+#endif
+    mutex_init(&window_data_x11->deferred_mutex);
+#if defined(USE_OPENGL_API)
+    window_data->release_context = release_GL_context;
+#endif
+
+    register_window(window_data);
+
 #if defined(_DEBUG) || defined(DEBUG)
     printf("Window created using X11 API\n");
 #endif
@@ -221,18 +1214,92 @@ mfb_open_ex(const char *title, unsigned width, unsigned height, unsigned flags)
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-int translate_key(int scancode);
-int translate_mod(int state);
-int translate_mod_ex(int key, int state, int is_pressed);
+static int translate_key(int scancode);
+static int translate_mod(int state);
+static int translate_mod_ex(int key, int state, int is_pressed);
+
+#if defined(USE_XINPUT2)
+// Unaccelerated deltas of the first two valuators (x, y), for every window that asked for them
+static void
+processRawEvent(XGenericEventCookie *cookie) {
+    if (cookie->extension != s_connection.xi_opcode || XGetEventData(s_connection.display, cookie) == False) {
+        return;
+    }
+
+    if (cookie->evtype == XI_RawMotion) {
+        XIRawEvent      *raw      = (XIRawEvent *) cookie->data;
+        const double    *value    = raw->raw_values;
+        double          delta[2]  = { 0.0, 0.0 };
+
+        for (int i = 0; i < 2 && i < raw->valuators.mask_len * 8; ++i) {
+            if (XIMaskIsSet(raw->valuators.mask, i)) {
+                delta[i] = *value++;
+            }
+        }
+        for (SWindowData *window_data = s_connection.windows; window_data != 0x0; window_data = ((SWindowData_X11 *) window_data->specific)->next) {
+            if (((SWindowData_X11 *) window_data->specific)->raw_motion) {
+                queue_raw_motion(window_data, (uint64_t) raw->time * 1000, (float) delta[0], (float) delta[1]);
+            }
+        }
+    }
+
+    XFreeEventData(s_connection.display, cookie);
+}
+#endif
+
+// Minimized (_NET_WM_STATE_HIDDEN), unmapped or fully covered
+static void
+updateVisibility(SWindowData *window_data) {
+    SWindowData_X11 *window_data_x11 = (SWindowData_X11 *) window_data->specific;
+
+    set_window_hidden(window_data, window_data_x11->is_minimized || window_data_x11->is_unmapped || window_data_x11->is_obscured);
+}
+
+static bool
+isMinimized(SWindowData_X11 *window_data_x11) {
+    Atom            type, *atoms = 0x0;
+    int             format;
+    unsigned long   count, remaining;
+    bool            hidden = false;
+
+    if (XGetWindowProperty(window_data_x11->display, window_data_x11->window, s_connection.wm_state_atom, 0, 64, False, XA_ATOM,
+                           &type, &format, &count, &remaining, (unsigned char **) &atoms) == Success && atoms != 0x0) {
+        for (unsigned long i = 0; i < count; ++i) {
+            hidden |= (atoms[i] == s_connection.wm_state_hidden_atom);
+        }
+        XFree(atoms);
+    }
+
+    return hidden;
+}
 
 static void
 processEvent(SWindowData *window_data, XEvent *event) {
+    switch (event->type) {
+        case KeyPress:
+        case KeyRelease:
+            record_event_time(window_data, (uint32_t) event->xkey.time);
+            break;
+        case ButtonPress:
+        case ButtonRelease:
+            record_event_time(window_data, (uint32_t) event->xbutton.time);
+            break;
+        case MotionNotify:
+            record_event_time(window_data, (uint32_t) event->xmotion.time);
+            break;
+        case FocusIn:
+        case FocusOut:
+            record_event_time(window_data, 0);
+            break;
+    }
+
     switch (event->type) {
         case KeyPress:
         case KeyRelease:
         {
             SWindowData_X11 *window_data_x11 = (SWindowData_X11 *) window_data->specific;
-            if ((event->type == KeyRelease) &&
+            // Without detectable auto repeat a held key sends release + press pairs
+            if ((event->type == KeyRelease) && (s_connection.detectable_autorepeat == false) &&
                 XEventsQueued(window_data_x11->display, QueuedAfterReading)) {
                 XEvent nev;
                 XPeekEvent(window_data_x11->display, &nev);
@@ -249,7 +1316,7 @@ processEvent(SWindowData *window_data, XEvent *event) {
             window_data->mod_keys = translate_mod_ex(key_code, event->xkey.state, is_pressed);
 
             window_data->key_status[key_code] = is_pressed;
-            kCall(keyboard_func, key_code, (mfb_key_mod) window_data->mod_keys, is_pressed);
+            kEvent(keyboard, key_code, (mfb_key_mod) window_data->mod_keys, is_pressed);
 
             if(event->type == KeyPress) {
                 KeySym keysym;
@@ -257,20 +1324,20 @@ processEvent(SWindowData *window_data, XEvent *event) {
 
                 if ((keysym >= 0x0020 && keysym <= 0x007e) ||
                     (keysym >= 0x00a0 && keysym <= 0x00ff)) {
-                    kCall(char_input_func, keysym);
+                    kEvent(char_input, keysym);
                 }
                 else if ((keysym & 0xff000000) == 0x01000000) {
                     keysym = keysym & 0x00ffffff;
                 }
 
-                kCall(char_input_func, keysym);
+                kEvent(char_input, keysym);
 
                 // TODO: Investigate a bit more the xkbcommon api
 
                 // This does not seem to be working properly
                 //unsigned int codepoint = xkb_state_key_get_utf32(state, keysym);
                 //if (codepoint != 0)
-                //    kCall(char_input_func, codepoint);
+                //    kEvent(char_input, codepoint);
             }
         }
         break;
@@ -298,30 +1365,30 @@ processEvent(SWindowData *window_data, XEvent *event) {
                 case Button2:
                 case Button3:
                     window_data->mouse_button_status[button & 0x07] = is_pressed;
-                    kCall(mouse_btn_func, button, (mfb_key_mod) window_data->mod_keys, is_pressed);
+                    kEvent(mouse_btn, button, (mfb_key_mod) window_data->mod_keys, is_pressed);
                     break;
 
                 case Button4:
                     window_data->mouse_wheel_y = 1.0f;
-                    kCall(mouse_wheel_func, (mfb_key_mod) window_data->mod_keys, 0.0f, window_data->mouse_wheel_y);
+                    kEvent(mouse_wheel, (mfb_key_mod) window_data->mod_keys, 0.0f, window_data->mouse_wheel_y);
                     break;
                 case Button5:
                     window_data->mouse_wheel_y = -1.0f;
-                    kCall(mouse_wheel_func, (mfb_key_mod) window_data->mod_keys, 0.0f, window_data->mouse_wheel_y);
+                    kEvent(mouse_wheel, (mfb_key_mod) window_data->mod_keys, 0.0f, window_data->mouse_wheel_y);
                     break;
 
                 case 6:
                     window_data->mouse_wheel_x = 1.0f;
-                    kCall(mouse_wheel_func, (mfb_key_mod) window_data->mod_keys, window_data->mouse_wheel_x, 0.0f);
+                    kEvent(mouse_wheel, (mfb_key_mod) window_data->mod_keys, window_data->mouse_wheel_x, 0.0f);
                     break;
                 case 7:
                     window_data->mouse_wheel_x = -1.0f;
-                    kCall(mouse_wheel_func, (mfb_key_mod) window_data->mod_keys, window_data->mouse_wheel_x, 0.0f);
+                    kEvent(mouse_wheel, (mfb_key_mod) window_data->mod_keys, window_data->mouse_wheel_x, 0.0f);
                     break;
 
                 default:
                     window_data->mouse_button_status[(button - 4) & 0x07] = is_pressed;
-                    kCall(mouse_btn_func, (mfb_mouse_button) (button - 4), (mfb_key_mod) window_data->mod_keys, is_pressed);
+                    kEvent(mouse_btn, (mfb_mouse_button) (button - 4), (mfb_key_mod) window_data->mod_keys, is_pressed);
                     break;
             }
         }
@@ -330,28 +1397,35 @@ processEvent(SWindowData *window_data, XEvent *event) {
         case MotionNotify:
             window_data->mouse_pos_x = event->xmotion.x;
             window_data->mouse_pos_y = event->xmotion.y;
-            kCall(mouse_move_func, event->xmotion.x, event->xmotion.y);
+            kEvent(mouse_move, event->xmotion.x, event->xmotion.y);
             break;
 
         case ConfigureNotify:
         {
+            lock_present(window_data);
             window_data->window_width  = event->xconfigure.width;
             window_data->window_height = event->xconfigure.height;
             resize_dst(window_data, event->xconfigure.width, event->xconfigure.height);
 
 #if defined(USE_OPENGL_API)
-            resize_GL(window_data);
+            // The context belongs to the presenter thread while async present is on
+            if (window_data->async_present != 0x0) {
+                ((SWindowData_X11 *) window_data->specific)->resize_pending = true;
+            }
+            else {
+                resize_GL(window_data);
+            }
 #else
+#if defined(USE_VULKAN_API)
+            // The swapchain images cover the whole window
             SWindowData_X11 *window_data_x11 = (SWindowData_X11 *) window_data->specific;
-            if(window_data_x11->image_scaler != 0x0) {
-                window_data_x11->image_scaler->data = 0x0;
-                XDestroyImage(window_data_x11->image_scaler);
-                window_data_x11->image_scaler        = 0x0;
-                window_data_x11->image_scaler_width  = 0;
-                window_data_x11->image_scaler_height = 0;
+            if (window_data_x11->vulkan != 0x0) {
+                resize_VK(window_data);
             }
-            XClearWindow(window_data_x11->display, window_data_x11->window);
 #endif
+            // Nothing to clear: with ForgetGravity the server clears the window and sends an Expose
+#endif
+            unlock_present(window_data);
             kCall(resize_func, window_data->window_width, window_data->window_height);
         }
         break;
@@ -360,14 +1434,53 @@ processEvent(SWindowData *window_data, XEvent *event) {
         case LeaveNotify:
         break;
 
+        // The window contents were lost: they are drawn again from the back buffer, or by the next frame
+        case Expose:
+#if !defined(USE_OPENGL_API)
+        {
+            // Never valid when Vulkan presents
+            bool repainted;
+            lock_present(window_data);
+            repainted = present_back_buffer(window_data);
+            if (repainted) {
+                XFlush(((SWindowData_X11 *) window_data->specific)->display);
+            }
+            unlock_present(window_data);
+            if (repainted) {
+                break;
+            }
+        }
+#endif
+            window_data->frame_hash_valid = false;
+            break;
+
+        // Compositing window managers usually report every window as unobscured
+        case VisibilityNotify:
+            ((SWindowData_X11 *) window_data->specific)->is_obscured = (event->xvisibility.state == VisibilityFullyObscured);
+            updateVisibility(window_data);
+            break;
+
+        case MapNotify:
+        case UnmapNotify:
+            ((SWindowData_X11 *) window_data->specific)->is_unmapped = (event->type == UnmapNotify);
+            updateVisibility(window_data);
+            break;
+
+        case PropertyNotify:
+            if (event->xproperty.atom == s_connection.wm_state_atom) {
+                ((SWindowData_X11 *) window_data->specific)->is_minimized = isMinimized((SWindowData_X11 *) window_data->specific);
+                updateVisibility(window_data);
+            }
+            break;
+
         case FocusIn:
             window_data->is_active = true;
-            kCall(active_func, true);
+            kEvent(active, true);
             break;
 
         case FocusOut:
             window_data->is_active = false;
-            kCall(active_func, false);
+            kEvent(active, false);
             break;
 
         case DestroyNotify:
@@ -377,7 +1490,7 @@ processEvent(SWindowData *window_data, XEvent *event) {
 
         case ClientMessage:
         {
-            if ((Atom)event->xclient.data.l[0] == s_delete_window_atom) {
+            if ((Atom)event->xclient.data.l[0] == s_connection.delete_window_atom) {
                 if (window_data) {
                     bool destroy = false;
 
@@ -397,20 +1510,264 @@ processEvent(SWindowData *window_data, XEvent *event) {
     }
 }
 
+// Window events read by the input thread. The queue is taken whole: the input thread starts a new one
+// meanwhile, and a callback updating the window again doesn't see these twice
+static void
+processDeferredEvents(SWindowData *window_data) {
+    XEvent          *events;
+    uint32_t        count, capacity;
+    SWindowData_X11 *window_data_x11 = (SWindowData_X11 *) window_data->specific;
+
+    mutex_lock(&window_data_x11->deferred_mutex);
+    events   = window_data_x11->deferred_events;
+    count    = window_data_x11->num_deferred_events;
+    capacity = window_data_x11->max_deferred_events;
+    if (count == 0) {
+        mutex_unlock(&window_data_x11->deferred_mutex);
+        return;
+    }
+    window_data_x11->deferred_events     = 0x0;
+    window_data_x11->num_deferred_events = 0;
+    window_data_x11->max_deferred_events = 0;
+    mutex_unlock(&window_data_x11->deferred_mutex);
+
+    for (uint32_t i = 0; i < count && window_data->close == false; ++i) {
+        processEvent(window_data, &events[i]);
+    }
+
+    // Kept for the next events, unless they already have a queue of their own
+    mutex_lock(&window_data_x11->deferred_mutex);
+    if (window_data_x11->deferred_events == 0x0) {
+        window_data_x11->deferred_events     = events;
+        window_data_x11->max_deferred_events = capacity;
+        events = 0x0;
+    }
+    mutex_unlock(&window_data_x11->deferred_mutex);
+    free(events);
+}
+
+// With the deferred mutex held. Motion is all that can be given up: a motion replaces the one at the end
+// of the queue, and past kMaxDeferredEvents the oldest motion makes room (the later ones carry the position).
+// Keys, buttons, focus and window events always get a slot
+static void
+deferEvent(SWindowData *window_data, const XEvent *event) {
+    SWindowData_X11 *window_data_x11 = (SWindowData_X11 *) window_data->specific;
+    XEvent          *events          = window_data_x11->deferred_events;
+    uint32_t        count            = window_data_x11->num_deferred_events;
+
+    // Only the last size matters, and the last position of a run of motions
+    if (count > 0 && events[count - 1].type == event->type &&
+        (event->type == ConfigureNotify || (event->type == MotionNotify && (window_data->compress_motion || count >= kMaxDeferredEvents)))) {
+        events[count - 1] = *event;
+        return;
+    }
+
+    if (count >= kMaxDeferredEvents) {
+        for (uint32_t i = 0; i < count; ++i) {
+            if (events[i].type == MotionNotify) {
+                memmove(&events[i], &events[i + 1], (count - i - 1) * sizeof(XEvent));
+                --count;
+                break;
+            }
+        }
+    }
+
+    if (count == window_data_x11->max_deferred_events) {
+        uint32_t capacity = count > 0 ? count * 2 : kMinDeferredEvents;
+        events = (XEvent *) realloc(events, capacity * sizeof(XEvent));
+        if (events == 0x0) {
+            fprintf(stderr, "Cannot grow the deferred events of a window, an event of type %d is lost.\n", event->type);
+            window_data_x11->num_deferred_events = count;
+            return;
+        }
+        window_data_x11->deferred_events     = events;
+        window_data_x11->max_deferred_events = capacity;
+    }
+
+    events[count++] = *event;
+    window_data_x11->num_deferred_events = count;
+}
+
+// Callbacks run on the window thread: a window with an input thread gets its window events there,
+// a window without one gets all its events there when they were read by some input thread
+static void
+dispatchEvent(SWindowData *window_data, XEvent *event, bool from_input_thread) {
+    SWindowData_X11 *window_data_x11 = (SWindowData_X11 *) window_data->specific;
+    bool            defer;
+
+    if (window_data->input_thread != 0x0) {
+        defer = (event->type == ConfigureNotify || event->type == DestroyNotify || event->type == ClientMessage ||
+                 event->type == VisibilityNotify || event->type == MapNotify || event->type == UnmapNotify || event->type == Expose ||
+                 (event->type == PropertyNotify && event->xproperty.atom == s_connection.wm_state_atom));
+    }
+    else {
+        defer = from_input_thread;
+    }
+    if (defer == false) {
+        processEvent(window_data, event);
+        return;
+    }
+    // Other property changes are of no interest, and only the last expose of a series is needed
+    if ((event->type == PropertyNotify && event->xproperty.atom != s_connection.wm_state_atom) ||
+        (event->type == Expose && event->xexpose.count > 0)) {
+        return;
+    }
+
+    mutex_lock(&window_data_x11->deferred_mutex);
+    deferEvent(window_data, event);
+    mutex_unlock(&window_data_x11->deferred_mutex);
+}
+
+// True on the thread running the callbacks of a batch. Other threads wait here until it is done
+static bool
+is_dispatching(void) {
+    bool dispatching;
+
+    mutex_lock(&s_connection.read_mutex);
+    dispatching = s_connection.dispatch_depth > 0;
+    mutex_unlock(&s_connection.read_mutex);
+
+    return dispatching;
+}
+
+// Windows closed and updated from a callback: the batch may still have events for them
+// (not with the lock held: the destroy joins the input thread, that may be waiting for it)
+static void
+destroy_pending_windows(SWindowData *except) {
+    for (;;) {
+        SWindowData *pending = 0x0;
+
+        mutex_lock(&s_connection.read_mutex);
+        for (SWindowData *window_data = s_connection.windows; window_data != 0x0; window_data = ((SWindowData_X11 *) window_data->specific)->next) {
+            SWindowData_X11 *window_data_x11 = (SWindowData_X11 *) window_data->specific;
+            if (window_data != except && window_data_x11->destroy_pending) {
+                window_data_x11->destroy_pending = false;
+                pending = window_data;
+                break;
+            }
+        }
+        mutex_unlock(&s_connection.read_mutex);
+
+        if (pending == 0x0) {
+            return;
+        }
+        destroy_window_data(pending);
+    }
+}
+
+// Reads everything queued with a single check of the connection (mode: QueuedAfterFlush or QueuedAlready)
+// and routes each event to its window. Mouse moves can be coalesced to the last position of the batch.
+// The callbacks run with read_mutex held: it is recursive, so they can open windows, toggle the raw motion or the
+// input thread. Calling an update from a callback doesn't read more events, and a window closed there is destroyed
+// once the batch is done
 static void
+processEventBatch(SWindowData *window_data, int mode, bool from_input_thread) {
+    XEvent          event, motion;
+    SWindowData     *target, *motion_target = 0x0;
+    uint32_t        read = 0, dispatched = 0;
+    int             count;
+
+    mutex_lock(&s_connection.read_mutex);
+    if (s_connection.dispatch_depth > 0) {
+        mutex_unlock(&s_connection.read_mutex);
+        return;
+    }
+    ++s_connection.dispatch_depth;
+    count = XEventsQueued(s_connection.display, mode);
+    while (count > 0 && window_data->close == false) {
+        for (; count > 0 && window_data->close == false; --count) {
+            XNextEvent(s_connection.display, &event);
+            ++read;
+
+#if defined(USE_XINPUT2)
+            if (event.type == GenericEvent) {
+                processRawEvent(&event.xcookie);
+                continue;
+            }
+#endif
+            // Windows already destroyed may still have events in flight
+            target = find_window(event.xany.window);
+            if (target == 0x0) {
+                continue;
+            }
+
+            if (motion_target != 0x0 && (event.type != MotionNotify || motion_target != target)) {
+                dispatchEvent(motion_target, &motion, from_input_thread);
+                motion_target = 0x0;
+                ++dispatched;
+            }
+            if (event.type == MotionNotify && target->compress_motion) {
+                motion        = event;
+                motion_target = target;
+                continue;
+            }
+            dispatchEvent(target, &event, from_input_thread);
+            ++dispatched;
+        }
+        // Whatever Xlib queued meanwhile, without going to the socket again
+        count = XEventsQueued(s_connection.display, QueuedAlready);
+    }
+    if (motion_target != 0x0) {
+        dispatchEvent(motion_target, &motion, from_input_thread);
+        ++dispatched;
+    }
+    --s_connection.dispatch_depth;
+    mutex_unlock(&s_connection.read_mutex);
+
+    destroy_pending_windows(window_data);
+
+    if (read > 0) {
+        window_data->events_read       = read;
+        window_data->events_dispatched = dispatched;
+    }
+}
+
+// False if the window is gone
+static bool
 processEvents(SWindowData *window_data) {
-    XEvent          event;
+    processDeferredEvents(window_data);
+    // The input thread owns the connection while it runs
+    if (window_data->input_thread != 0x0) {
+        return true;
+    }
+
+    processEventBatch(window_data, QueuedAfterFlush, false);
+    // Closed and updated by one of its own callbacks
+    if (((SWindowData_X11 *) window_data->specific)->destroy_pending) {
+        ((SWindowData_X11 *) window_data->specific)->destroy_pending = false;
+        destroy_window_data(window_data);
+        return false;
+    }
+    return true;
+}
+
+// Runs on the input thread
+static void
+pump_input(SWindowData *window_data, int timeout_ms) {
     SWindowData_X11 *window_data_x11 = (SWindowData_X11 *) window_data->specific;
+    struct pollfd   fd = { ConnectionNumber(window_data_x11->display), POLLIN, 0 };
 
-    while ((window_data->close == false) && XPending(window_data_x11->display)) {
-        XNextEvent(window_data_x11->display, &event);
-        processEvent(window_data, &event);
+    if (XPending(window_data_x11->display) == 0) {
+        poll(&fd, 1, timeout_ms);
     }
+
+    processEventBatch(window_data, QueuedAfterReading, true);
 }
 
-///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Other threads may be dispatching to this window's event queue: wait for them before it goes away
+static bool
+setup_input_thread(SWindowData *window_data, bool enable) {
+    kUnused(window_data);
+
+    if (enable == false) {
+        mutex_lock(&s_connection.read_mutex);
+        mutex_unlock(&s_connection.read_mutex);
+    }
+
+    return true;
+}
 
-void destroy_window_data(SWindowData *window_data);
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
 mfb_update_state
 mfb_update_ex(struct mfb_window *window, void *buffer, unsigned width, unsigned height) {
@@ -428,62 +1785,122 @@ mfb_update_ex(struct mfb_window *window, void *buffer, unsigned width, unsigned
         return STATE_INVALID_BUFFER;
     }
 
+    // Nothing can be seen or nothing changed: only keep the events going
+    if (is_window_idle(window_data) || is_same_frame(window_data, buffer, width, height)) {
+        return processEvents(window_data) ? STATE_OK : STATE_EXIT;
+    }
+
+    mfb_update_state state = present_buffer(window_data, buffer, width, height);
+    if (state != STATE_OK) {
+        return state;
+    }
+
+    return processEvents(window_data) ? STATE_OK : STATE_EXIT;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Called from mfb_update_ex or from the async presenter thread
+static mfb_update_state
+present_buffer(SWindowData *window_data, void *buffer, uint32_t width, uint32_t height) {
 #if !defined(USE_OPENGL_API)
     SWindowData_X11 *window_data_x11 = (SWindowData_X11 *) window_data->specific;
-    bool different_size = false;
+    const uint32_t  *frame;
+    uint32_t        frame_width      = width;
+    uint32_t        frame_height     = height;
+
+    // Without XRender the frame is scaled here, and the back buffer has the viewport size
+    bool scale_here = width != 0 && height != 0 && window_data->dst_width != 0 && window_data->dst_height != 0 &&
+                      (width != window_data->dst_width || height != window_data->dst_height);
+#if defined(USE_XRENDER)
+    scale_here = scale_here && window_data_x11->window_picture == None;
+#endif
+#if defined(USE_VULKAN_API)
+    scale_here = scale_here && window_data_x11->vulkan == 0x0;
+#endif
+    // A float frame is then tone mapped by the scaling pass, it is not converted at its own size first
+    if (scale_here == false || window_data->input_format != FORMAT_RGBA32F)
+#endif
+    {
+        buffer = convert_input_buffer(window_data, buffer, width, height);
+        if (buffer == 0x0) {
+            return STATE_INTERNAL_ERROR;
+        }
+    }
+
+#if !defined(USE_OPENGL_API)
+    frame = (const uint32_t *) buffer;
 #endif
 
     if(window_data->buffer_width != width || window_data->buffer_height != height) {
         window_data->buffer_width  = width;
         window_data->buffer_stride = width * 4;
         window_data->buffer_height = height;
-#if !defined(USE_OPENGL_API)
-        different_size = true;
-#endif
     }
 
+#if defined(USE_VULKAN_API)
+    if (window_data_x11->vulkan != 0x0) {
+        if (redraw_VK(window_data, buffer) == false) {
+            return STATE_INTERNAL_ERROR;
+        }
+        record_present(window_data);
+        return STATE_OK;
+    }
+#endif
+
 #if !defined(USE_OPENGL_API)
 
-    if (different_size || window_data->buffer_width != window_data->dst_width || window_data->buffer_height != window_data->dst_height) {
+    // Nothing to draw into (a window resized to nothing)
+    if (width == 0 || height == 0 || window_data->dst_width == 0 || window_data->dst_height == 0) {
+        record_present(window_data);
+        return STATE_OK;
+    }
+
+    if (scale_here) {
         if (window_data_x11->image_scaler_width != window_data->dst_width || window_data_x11->image_scaler_height != window_data->dst_height) {
-            if (window_data_x11->image_scaler != 0x0) {
-                window_data_x11->image_scaler->data = 0x0;
-                XDestroyImage(window_data_x11->image_scaler);
-            }
-            if (window_data_x11->image_buffer != 0x0) {
-                free(window_data_x11->image_buffer);
-                window_data_x11->image_buffer = 0x0;
-            }
-            int depth = DefaultDepth(window_data_x11->display, window_data_x11->screen);
-            window_data_x11->image_buffer = malloc(window_data->dst_width * window_data->dst_height * 4);
+            free(window_data_x11->image_buffer);
+            window_data_x11->image_buffer = malloc((size_t) window_data->dst_width * window_data->dst_height * 4);
             if(window_data_x11->image_buffer == 0x0) {
+                window_data_x11->image_scaler_width  = 0;
+                window_data_x11->image_scaler_height = 0;
                 return STATE_INTERNAL_ERROR;
             }
             window_data_x11->image_scaler_width  = window_data->dst_width;
             window_data_x11->image_scaler_height = window_data->dst_height;
-            window_data_x11->image_scaler = XCreateImage(window_data_x11->display, CopyFromParent, depth, ZPixmap, 0, 0x0, window_data_x11->image_scaler_width, window_data_x11->image_scaler_height, 32, window_data_x11->image_scaler_width * 4);
         }
+        if (window_data->input_format == FORMAT_RGBA32F) {
+            if (tonemap_stretch_image(window_data, buffer, width, height,
+                                      (uint32_t *) window_data_x11->image_buffer, window_data->dst_width, window_data->dst_height, window_data->dst_width) == false) {
+                return STATE_INTERNAL_ERROR;
+            }
+        }
+        else {
+            stretch_image((uint32_t *) buffer, 0, 0, window_data->buffer_width, window_data->buffer_height, window_data->buffer_width,
+                          (uint32_t *) window_data_x11->image_buffer, 0, 0, window_data->dst_width, window_data->dst_height, window_data->dst_width);
+        }
+        frame        = (const uint32_t *) window_data_x11->image_buffer;
+        frame_width  = window_data->dst_width;
+        frame_height = window_data->dst_height;
     }
 
-    if (window_data_x11->image_scaler != 0x0) {
-        stretch_image((uint32_t *) buffer, 0, 0, window_data->buffer_width, window_data->buffer_height, window_data->buffer_width,
-                      (uint32_t *) window_data_x11->image_buffer, 0, 0, window_data->dst_width, window_data->dst_height, window_data->dst_width);
-        window_data_x11->image_scaler->data = (char *) window_data_x11->image_buffer;
-        XPutImage(window_data_x11->display, window_data_x11->window, window_data_x11->gc, window_data_x11->image_scaler, 0, 0, window_data->dst_offset_x, window_data->dst_offset_y, window_data->dst_width, window_data->dst_height);
-    }
-    else {
-        window_data_x11->image->data = (char *) buffer;
-        XPutImage(window_data_x11->display, window_data_x11->window, window_data_x11->gc, window_data_x11->image, 0, 0, window_data->dst_offset_x, window_data->dst_offset_y, window_data->dst_width, window_data->dst_height);
+    if (upload_back_buffer(window_data_x11, frame, frame_width, frame_height) == false) {
+        return STATE_INTERNAL_ERROR;
     }
+    present_back_buffer(window_data);
     XFlush(window_data_x11->display);
 
 #else
 
+    SWindowData_X11 *window_data_x11 = (SWindowData_X11 *) window_data->specific;
+    if (window_data_x11->resize_pending) {
+        window_data_x11->resize_pending = false;
+        resize_GL(window_data);
+    }
     redraw_GL(window_data, buffer);
 
 #endif
 
-    processEvents(window_data);
+    record_present(window_data);
 
     return STATE_OK;
 }
@@ -504,16 +1921,39 @@ mfb_update_events(struct mfb_window *window) {
 
     SWindowData_X11 *window_data_x11 = (SWindowData_X11 *) window_data->specific;
     XFlush(window_data_x11->display);
-    processEvents(window_data);
+
+    return processEvents(window_data) ? STATE_OK : STATE_EXIT;
+}
+
+//-------------------------------------
+mfb_update_state
+mfb_update_events_all(void) {
+    SWindowData *window_data, *reader = 0x0;
+
+    if (s_connection.windows == 0x0) {
+        return STATE_INVALID_WINDOW;
+    }
+
+    XFlush(s_connection.display);
+    for (window_data = s_connection.windows; window_data != 0x0; window_data = ((SWindowData_X11 *) window_data->specific)->next) {
+        processDeferredEvents(window_data);
+        if (reader == 0x0 && window_data->close == false) {
+            reader = window_data;
+        }
+    }
+    // Closed windows are destroyed by their own update
+    if (reader == 0x0) {
+        return STATE_EXIT;
+    }
+
+    processEventBatch(reader, QueuedAfterFlush, false);
+    destroy_pending_windows(0x0);
 
     return STATE_OK;
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-extern double   g_time_for_frame;
-extern bool     g_use_hardware_sync;
-
 bool
 mfb_wait_sync(struct mfb_window *window) {
     if (window == 0x0) {
@@ -526,31 +1966,36 @@ mfb_wait_sync(struct mfb_window *window) {
         return false;
     }
 
-    if(g_use_hardware_sync) {
+    // There are no swaps to wait on while the window is idle
+    if(window_data->use_hardware_sync && is_window_idle(window_data) == false) {
         return true;
     }
 
     SWindowData_X11 *window_data_x11 = (SWindowData_X11 *) window_data->specific;
     XFlush(window_data_x11->display);
-    XEvent      event;
+    double      time_for_frame = get_time_for_frame(window_data);
     double      current;
     uint32_t    millis = 1;
     while(1) {
         current = mfb_timer_now(window_data_x11->timer);
-        if (current >= g_time_for_frame * 0.96) {
+        if (current >= time_for_frame * 0.96) {
             mfb_timer_reset(window_data_x11->timer);
             return true;
         }
-        else if(current >= g_time_for_frame * 0.8) {
+        else if(current >= time_for_frame * 0.8) {
             millis = 0;
         }
 
         usleep(millis * 1000);
         //sched_yield();
 
-        if(millis == 1 && XEventsQueued(window_data_x11->display, QueuedAlready) > 0) {
-            XNextEvent(window_data_x11->display, &event);
-            processEvent(window_data, &event);
+        if(millis == 1) {
+            if(window_data->input_thread != 0x0) {
+                processDeferredEvents(window_data);
+            }
+            else {
+                processEventBatch(window_data, QueuedAlready, false);
+            }
 
             if(window_data->close) {
                 destroy_window_data(window_data);
@@ -564,27 +2009,60 @@ mfb_wait_sync(struct mfb_window *window) {
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-void
+static void
 destroy_window_data(SWindowData *window_data)  {
     if (window_data != 0x0) {
         if (window_data->specific != 0x0) {
             SWindowData_X11   *window_data_x11 = (SWindowData_X11 *) window_data->specific;
 
+            // From a callback: the batch being dispatched may reach it yet
+            if (is_dispatching()) {
+                window_data_x11->destroy_pending = true;
+                return;
+            }
+
+            stop_input_thread(window_data);
+            stop_async_present(window_data);
+
+            // No more events routed here from now on
+            unregister_window(window_data);
+#if defined(USE_XINPUT2)
+            if (window_data_x11->raw_motion) {
+                setup_raw_motion(window_data, false);
+            }
+#endif
+
 #if defined(USE_OPENGL_API)
             destroy_GL_context(window_data);
 #else
-            if (window_data_x11->image != 0x0) {
-                window_data_x11->image->data = 0x0;
-                XDestroyImage(window_data_x11->image);
-                XDestroyWindow(window_data_x11->display, window_data_x11->window);
-                XCloseDisplay(window_data_x11->display);
+#if defined(USE_VULKAN_API)
+            destroy_VK_context(window_data);
+#endif
+            release_back_buffer(window_data_x11);
+#if defined(USE_XRENDER)
+            if (window_data_x11->window_picture != None) {
+                XRenderFreePicture(window_data_x11->display, window_data_x11->window_picture);
+            }
+#endif
+            free(window_data_x11->image_buffer);
+#endif
+#if defined(USE_XRANDR)
+            if (s_video_mode.window == window_data) {
+                restore_video_mode(window_data_x11->display);
             }
 #endif
+            if (window_data_x11->window != 0) {
+                XDestroyWindow(window_data_x11->display, window_data_x11->window);
+            }
+            release_connection();
 
             mfb_timer_destroy(window_data_x11->timer);
+            mutex_destroy(&window_data_x11->deferred_mutex);
+            free(window_data_x11->deferred_events);
             memset(window_data_x11, 0, sizeof(SWindowData_X11));
             free(window_data_x11);
         }
+        destroy_window_data_common(window_data);
         memset(window_data, 0, sizeof(SWindowData));
         free(window_data);
     }
@@ -758,10 +2236,16 @@ static int translateKeyCodeA(int keySym) {
     return KB_KEY_UNKNOWN;
 }
 
-void
+static void
 init_keycodes(SWindowData_X11 *window_data_x11) {
-    size_t  i;
-    int     keySym;
+    static bool s_initialized = false;
+    size_t      i;
+    int         keySym;
+
+    // Once per process, with the keymap of the first display
+    if (s_initialized)
+        return;
+    s_initialized = true;
 
     // Clear keys
     for (i = 0; i < sizeof(g_keycodes) / sizeof(g_keycodes[0]); ++i)
@@ -781,7 +2265,7 @@ init_keycodes(SWindowData_X11 *window_data_x11) {
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-int
+static int
 translate_key(int scancode) {
     if (scancode < 0 || scancode > 255)
         return KB_KEY_UNKNOWN;
@@ -791,7 +2275,7 @@ translate_key(int scancode) {
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-int
+static int
 translate_mod(int state) {
     int mod_keys = 0;
 
@@ -813,7 +2297,7 @@ translate_mod(int state) {
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-int
+static int
 translate_mod_ex(int key, int state, int is_pressed) {
     int mod_keys = 0;
 
@@ -870,11 +2354,13 @@ mfb_set_viewport(struct mfb_window *window, unsigned offset_x, unsigned offset_y
         return false;
     }
 
+    lock_present(window_data);
     window_data->dst_offset_x = offset_x;
     window_data->dst_offset_y = offset_y;
     window_data->dst_width    = width;
     window_data->dst_height   = height;
     calc_dst_factor(window_data, window_data->window_width, window_data->window_height);
+    unlock_present(window_data);
 
     return true;
 }
@@ -910,3 +2396,25 @@ mfb_get_monitor_scale(struct mfb_window *window, float *scale_x, float *scale_y)
         }
     }
 }
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#if defined(USE_RUNTIME_BACKEND)
+// The frames sent so far are on the screen: the GPU is done with them and the server has processed them
+static void
+finish_frames(struct mfb_window *window) {
+    SWindowData     *window_data     = (SWindowData *) window;
+    SWindowData_X11 *window_data_x11 = (SWindowData_X11 *) window_data->specific;
+
+#if defined(USE_OPENGL_API)
+    finish_GL(window_data);
+#endif
+    XSync(window_data_x11->display, False);
+}
+#endif
+
+#if defined(USE_RUNTIME_BACKEND) && defined(USE_OPENGL_API)
+kBackendExport("x11-gl")
+#elif defined(USE_RUNTIME_BACKEND)
+kBackendExport("x11")
+#endif
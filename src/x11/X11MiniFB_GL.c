@@ -0,0 +1,5 @@
+// USE_RUNTIME_BACKEND builds X11MiniFB.c twice: as it is for the "x11" backend and here for "x11-gl"
+#if defined(USE_RUNTIME_BACKEND)
+    #define USE_OPENGL_API
+    #include "X11MiniFB.c"
+#endif
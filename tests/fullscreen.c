@@ -1,6 +1,7 @@
 #include <MiniFB.h>
 #include <stdio.h>
 #include <stdint.h>
+#include <string.h>
 
 #define kUnused(var)    (void) var
 
@@ -13,11 +14,16 @@ static bool         g_active = true;
 
 
 int
-main()
+main(int argc, char *argv[])
 {
     int noise, carry, seed = 0xbeef;
 
-    struct mfb_window *window = mfb_open_ex("full screen auto", WIDTH, HEIGHT, WF_FULLSCREEN);
+    // --exclusive: changes the video mode to the closest one to the buffer size (X11)
+    unsigned flags = WF_FULLSCREEN;
+    if (argc > 1 && strcmp(argv[1], "--exclusive") == 0)
+        flags |= WF_FULLSCREEN_EXCLUSIVE;
+
+    struct mfb_window *window = mfb_open_ex("full screen auto", WIDTH, HEIGHT, flags);
     if (!window)
         return 0;
 
@@ -23,6 +23,14 @@ public:
         fprintf(stdout, "%s > active: %d\n", window_title, isActive);
     }
 
+    void visibility(struct mfb_window *window, bool isVisible) {
+        const char *window_title = "";
+        if(window) {
+            window_title = (const char *) mfb_get_user_data(window);
+        }
+        fprintf(stdout, "%s > visible: %d\n", window_title, isVisible);
+    }
+
     void resize(struct mfb_window *window, int width, int height) {
         uint32_t x = 0;
         uint32_t y = 0;
@@ -127,6 +135,7 @@ main()
     mfb_set_mouse_button_callback(window, &e, &Events::mouse_button);
     mfb_set_mouse_move_callback(window, &e, &Events::mouse_move);
     mfb_set_mouse_scroll_callback(window, &e, &Events::mouse_scroll);
+    mfb_set_visibility_callback(window, &e, &Events::visibility);
 
 #elif defined(kUseLambdas)
 
@@ -218,6 +227,14 @@ main()
         fprintf(stdout, "%s > mouse_scroll: x: %f, y: %f [key_mod: %x]\n", window_title, deltaX, deltaY, mod);
     }, window);
 
+    mfb_set_visibility_callback([](struct mfb_window *window, bool isVisible) {
+        const char *window_title = "";
+        if(window) {
+            window_title = (const char *) mfb_get_user_data(window);
+        }
+        fprintf(stdout, "%s > visible: %d (lambda)\n", window_title, isVisible);
+    }, window);
+
 #else
 
     using namespace std::placeholders;
@@ -230,6 +247,7 @@ main()
     mfb_set_mouse_button_callback(std::bind(&Events::mouse_button, &e, _1, _2, _3, _4), window);
     mfb_set_mouse_move_callback  (std::bind(&Events::mouse_move,   &e, _1, _2, _3),     window);
     mfb_set_mouse_scroll_callback(std::bind(&Events::mouse_scroll, &e, _1, _2, _3, _4), window);
+    mfb_set_visibility_callback  (std::bind(&Events::visibility,   &e, _1, _2),         window);
 
 #endif
 
@@ -139,75 +139,62 @@ main()
         pallete[64*7 + c] = MFB_ARGB(255, 255-col, 0,       0);
     }
 
-    mfb_set_target_fps(10);
+    // Each window at its own rate, one wait for both
+    mfb_scheduler_add(window_a, 60);
+    mfb_scheduler_add(window_b, 10);
 
     //--
-    float   time = 0;
-    for (;;)
+    float               time = 0;
+    struct mfb_window   *due[2];
+    unsigned            count;
+    while ((count = mfb_scheduler_wait(due, 2)) > 0)
     {
         int      i, x, y;
         float    dx, dy, time_x, time_y;
         int      index;
-        
-        mfb_update_state state_a, state_b;
-
-        if(window_a != 0x0) {
-            for (i = 0; i < WIDTH_A * HEIGHT_A; ++i)
-            {
-                noise = seed;
-                noise >>= 3;
-                noise ^= seed;
-                carry = noise & 1;
-                noise >>= 1;
-                seed >>= 1;
-                seed |= (carry << 30);
-                noise &= 0xFF;
-                g_buffer_a[i] = MFB_ARGB(255, noise, noise, noise);
-            }
 
-            //--
-            state_a = mfb_update(window_a, g_buffer_a);
-            if (state_a != STATE_OK) {
-                window_a = 0x0;
-            }
-        }
+        for (unsigned n = 0; n < count; ++n) {
+            if(due[n] == window_a) {
+                for (i = 0; i < WIDTH_A * HEIGHT_A; ++i)
+                {
+                    noise = seed;
+                    noise >>= 3;
+                    noise ^= seed;
+                    carry = noise & 1;
+                    noise >>= 1;
+                    seed >>= 1;
+                    seed |= (carry << 30);
+                    noise &= 0xFF;
+                    g_buffer_a[i] = MFB_ARGB(255, noise, noise, noise);
+                }
 
-        //--
-        if(window_b != 0x0) {
-            time_x = sinf(time * kPI / 180.0f);
-            time_y = cosf(time * kPI / 180.0f);
-            i = 0;
-            for(y=0; y<HEIGHT_B; ++y) {
-                dy = cosf((y * time_y) * kPI / 180.0f);                // [-1, 1]
-                for(x=0; x<WIDTH_B; ++x) {
-                    dx = sinf((x * time_x) * kPI / 180.0f);            // [-1, 1]
-
-                    index = (int) ((2.0f + dx + dy) * 0.25f * 511.0f);  // [0, 511]
-                    g_buffer_b[i++] = pallete[index];
+                //--
+                // A closed window is released here and leaves the scheduler
+                if (mfb_update(window_a, g_buffer_a) != STATE_OK) {
+                    window_a = 0x0;
                 }
             }
-            time += 0.1f;
 
             //--
-            state_b = mfb_update(window_b, g_buffer_b);
-            if (state_b != STATE_OK) {
-                window_b = 0x0;
-            }
-        }
-
-        if(window_a == 0x0 && window_b == 0x0) {
-            break;
-        }
+            else if(due[n] == window_b) {
+                time_x = sinf(time * kPI / 180.0f);
+                time_y = cosf(time * kPI / 180.0f);
+                i = 0;
+                for(y=0; y<HEIGHT_B; ++y) {
+                    dy = cosf((y * time_y) * kPI / 180.0f);                // [-1, 1]
+                    for(x=0; x<WIDTH_B; ++x) {
+                        dx = sinf((x * time_x) * kPI / 180.0f);            // [-1, 1]
+
+                        index = (int) ((2.0f + dx + dy) * 0.25f * 511.0f);  // [0, 511]
+                        g_buffer_b[i++] = pallete[index];
+                    }
+                }
+                time += 0.1f;
 
-        // Don't need to do this for both windows in the same thread
-        if(window_a != 0x0) {
-            if(mfb_wait_sync(window_a) == false) {
-                window_a = 0x0;
-            }
-        }
-        else if(window_b != 0x0) {
-            if(mfb_wait_sync(window_b) == false) {
-                window_b = 0x0;
+                //--
+                if (mfb_update(window_b, g_buffer_b) != STATE_OK) {
+                    window_b = 0x0;
+                }
             }
         }
     }
@@ -0,0 +1,77 @@
+#include <MiniFB.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+// Time to first frame: from the first mfb_open_ex until every window has presented once.
+// The connection to the display is opened again for each run
+
+#define kWidth          320
+#define kHeight         240
+#define kMaxWindows     32
+
+static uint32_t g_buffer[kWidth * kHeight];
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static double
+time_to_first_frame(unsigned num_windows, double *open_ms) {
+    struct mfb_window   *windows[kMaxWindows] = { 0x0 };
+    struct mfb_timer    *timer = mfb_timer_create();
+    double              time   = -1;
+    unsigned            i;
+    char                title[32];
+
+    mfb_timer_reset(timer);
+    for (i = 0; i < num_windows; ++i) {
+        snprintf(title, sizeof(title), "Startup %u", i + 1);
+        windows[i] = mfb_open_ex(title, kWidth, kHeight, 0);
+        if (windows[i] == 0x0)
+            break;
+    }
+    *open_ms = mfb_timer_now(timer) * 1000.0;
+
+    if (i == num_windows) {
+        for (i = 0; i < num_windows; ++i) {
+            if (mfb_update_ex(windows[i], g_buffer, kWidth, kHeight) != STATE_OK)
+                break;
+        }
+        if (i == num_windows)
+            time = mfb_timer_now(timer) * 1000.0;
+    }
+    mfb_timer_destroy(timer);
+
+    // The windows are destroyed by the next update once closed
+    for (i = 0; i < num_windows; ++i) {
+        if (windows[i] != 0x0) {
+            mfb_close(windows[i]);
+            mfb_update_events(windows[i]);
+        }
+    }
+
+    return time;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int
+main()
+{
+    const unsigned  counts[] = { 1, kMaxWindows };
+    double          open_ms, frame_ms;
+
+    for (uint32_t i = 0; i < kWidth * kHeight; ++i)
+        g_buffer[i] = MFB_RGB(i % kWidth, i / kWidth, 0x80);
+
+    for (size_t i = 0; i < sizeof(counts) / sizeof(counts[0]); ++i) {
+        frame_ms = time_to_first_frame(counts[i], &open_ms);
+        if (frame_ms < 0) {
+            fprintf(stderr, "Cannot open %u windows.\n", counts[i]);
+            return 1;
+        }
+        fprintf(stdout, "%2u window(s): open %8.3f ms, first frame %8.3f ms (%.3f ms per window)\n",
+                counts[i], open_ms, frame_ms, frame_ms / counts[i]);
+    }
+
+    return 0;
+}
@@ -0,0 +1,108 @@
+#include <float.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+// Checks the tone mapping row kernels of src/MiniFB_tonemap.c on values that are valid HDR data
+// but easy to get wrong: Inf, NaN, denormals and exposures that overflow the scale.
+// The kernels are static, so the file is built into the test.
+#include "MiniFB_tonemap.c"
+
+// 8 pixel vectors plus a scalar tail
+#define kWidth      (8 * 4 + 5)
+
+static float    g_src[kWidth * 4];
+static uint32_t g_lut[kGammaLutSize];
+static uint32_t g_scalar[kWidth];
+#if defined(kUseAVX2)
+static uint32_t g_simd[kWidth];
+#endif
+
+static const float g_values[] = {
+    0.0f, -0.0f, 0.5f, 1.0f, 2.0f, -1.0f, 1e-40f, 1e20f, FLT_MAX, -FLT_MAX, INFINITY, -INFINITY, NAN, -NAN,
+};
+
+#define kNumValues  (sizeof(g_values) / sizeof(g_values[0]))
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Every channel of every pixel is in the LUT range: the output is only checked for the alpha and the extremes
+static int
+check_row(const uint32_t *row, const STonemap *tonemap, const char *kernel) {
+    int failures = 0;
+
+    for (uint32_t x = 0; x < kWidth; ++x) {
+        const float *pixel = g_src + x * 4;
+        for (uint32_t i = 0; i < 3; ++i) {
+            float    v        = pixel[i] * tonemap->scale;
+            uint32_t channel  = (row[x] >> (16 - i * 8)) & 0xff;
+            uint32_t expected = ~0u;
+            if (!(v > 0.0f))
+                expected = 0;
+            else if (isinf(v) || (tonemap->reinhard == false && v >= 1.0f))
+                expected = 255;
+            if (expected != ~0u && channel != expected) {
+                fprintf(stderr, "%s: pixel %u channel %u is %u for %g (scale %g, reinhard %d), not %u\n", kernel, x, i, channel, pixel[i], tonemap->scale, tonemap->reinhard, expected);
+                ++failures;
+            }
+        }
+    }
+    return failures;
+}
+
+//-------------------------------------
+int
+main() {
+    const float scales[] = { 1.0f, 1024.0f, 1e30f, INFINITY };
+    STonemap    tonemap;
+    int         failures = 0;
+    int         compared = 0;
+
+    build_gamma_lut(g_lut, kDefaultGamma);
+    tonemap.lut = g_lut;
+
+    // Each channel steps through the values at a different rate, so all of them meet all the others
+    for (uint32_t x = 0; x < kWidth; ++x) {
+        g_src[x * 4 + 0] = g_values[x % kNumValues];
+        g_src[x * 4 + 1] = g_values[(x / 2) % kNumValues];
+        g_src[x * 4 + 2] = g_values[(x / 3 + 5) % kNumValues];
+        g_src[x * 4 + 3] = g_values[(x * 7) % kNumValues];
+    }
+
+    for (int reinhard = 0; reinhard < 2; ++reinhard) {
+        for (size_t s = 0; s < sizeof(scales) / sizeof(scales[0]); ++s) {
+            tonemap.scale    = scales[s];
+            tonemap.reinhard = reinhard != 0;
+
+            memset(g_scalar, 0, sizeof(g_scalar));
+            tonemap_row_scalar(g_src, g_scalar, kWidth, &tonemap);
+            failures += check_row(g_scalar, &tonemap, "scalar");
+
+#if defined(kUseAVX2)
+            if (has_avx2()) {
+                memset(g_simd, 0, sizeof(g_simd));
+                tonemap_row_avx2(g_src, g_simd, kWidth, &tonemap);
+                for (uint32_t x = 0; x < kWidth; ++x) {
+                    if (g_simd[x] != g_scalar[x]) {
+                        fprintf(stderr, "avx2: pixel %u is %08x, scalar %08x (scale %g, reinhard %d)\n", x, g_simd[x], g_scalar[x], tonemap.scale, reinhard);
+                        ++failures;
+                    }
+                }
+                ++compared;
+            }
+#endif
+        }
+    }
+
+    if (failures != 0) {
+        fprintf(stderr, "%d tone mapping mismatches\n", failures);
+        return 1;
+    }
+
+    if (compared != 0)
+        printf("Tone mapping kernels match on Inf, NaN and overflowing exposures\n");
+    else
+        printf("Tone mapping scalar kernel is in range on Inf, NaN and overflowing exposures (no AVX2 to compare)\n");
+    return 0;
+}
@@ -0,0 +1,96 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Checks the SIMD swizzle of src/web/WebSwizzle.h against its scalar loop, byte for byte.
+// Outside of wasm the three intrinsics it uses are replaced by plain C with the same semantics,
+// so the lane table and the 4 pixel loop with its tail are checked on every platform
+
+#if !defined(__wasm_simd128__)
+
+typedef struct {
+    uint8_t bytes[16];
+} v128_t;
+
+static v128_t
+wasm_v128_load(const void *mem) {
+    v128_t v;
+    memcpy(v.bytes, mem, sizeof(v.bytes));
+    return v;
+}
+
+static void
+wasm_v128_store(void *mem, v128_t v) {
+    memcpy(mem, v.bytes, sizeof(v.bytes));
+}
+
+// Lanes 0-15 pick from a, 16-31 from b
+static v128_t
+shuffle_i8x16(v128_t a, v128_t b, const uint8_t lanes[16]) {
+    uint8_t both[32];
+    v128_t  result;
+    int     i;
+
+    memcpy(both, a.bytes, 16);
+    memcpy(both + 16, b.bytes, 16);
+    for (i = 0; i < 16; ++i) {
+        result.bytes[i] = both[lanes[i] & 31];
+    }
+    return result;
+}
+
+#define wasm_i8x16_shuffle(a, b, ...)   shuffle_i8x16((a), (b), (const uint8_t[16]) { __VA_ARGS__ })
+#define kWebSwizzleSIMD
+
+#endif
+
+#include "WebSwizzle.h"
+
+#define kMaxPixels      67
+#define kGuard          16
+
+static uint8_t g_src[kMaxPixels * 4];
+static uint8_t g_simd[kMaxPixels * 4 + kGuard];
+static uint8_t g_scalar[kMaxPixels * 4 + kGuard];
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int
+main() {
+    int32_t num_pixels;
+    int     failures = 0;
+    int     i;
+
+    srand(1234);
+    for (i = 0; i < kMaxPixels * 4; ++i) {
+        g_src[i] = (uint8_t) rand();
+    }
+
+    // Every width from 0 up, so all tails of 1 to 3 pixels come after 0 or more full vectors
+    for (num_pixels = 0; num_pixels <= kMaxPixels; ++num_pixels) {
+        memset(g_simd, 0xcd, sizeof(g_simd));
+        memset(g_scalar, 0xcd, sizeof(g_scalar));
+
+        swizzle_pixels(g_src, g_simd, num_pixels);
+        swizzle_pixels_scalar(g_src, g_scalar, 0, num_pixels);
+
+        // Includes the bytes past the last pixel, which neither path may touch
+        if (memcmp(g_simd, g_scalar, num_pixels * 4 + kGuard) != 0) {
+            fprintf(stderr, "Swizzle mismatch for %d pixels\n", (int) num_pixels);
+            ++failures;
+        }
+        else if (num_pixels > 0 && (g_scalar[0] != g_src[2] || g_scalar[1] != g_src[1] || g_scalar[2] != g_src[0] || g_scalar[3] != g_src[3])) {
+            fprintf(stderr, "Scalar swizzle is not BGRA to RGBA for %d pixels\n", (int) num_pixels);
+            ++failures;
+        }
+    }
+
+    if (failures != 0) {
+        fprintf(stderr, "%d of %d widths failed\n", failures, kMaxPixels + 1);
+        return 1;
+    }
+
+    printf("Swizzle matches for 0 to %d pixels\n", kMaxPixels);
+    return 0;
+}